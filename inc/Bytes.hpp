@@ -0,0 +1,71 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/*
+ * Helpers for the binary formats: program images and snapshots.
+ * Values are written in the layout of the host, since neither format ever leaves the machine that wrote it.
+ */
+
+// Thrown when data ends early, or refers to something that does not exist.
+struct DamagedBytes {};
+
+template <typename V>
+void WriteRaw(std::string& out, V value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// A u32 length, then the bytes.
+inline void WriteString(std::string& out, const std::string& text) {
+    WriteRaw<uint32_t>(out, (uint32_t) text.size());
+    out.append(text);
+}
+
+/*
+ * Reads values out of a buffer in place. Every read is bounds checked, and throws DamagedBytes
+ *  rather than run off the end.
+ */
+class ByteReader {
+public:
+    ByteReader(const char* pData, size_t pLength) : Data(pData), End(pData + pLength) {}
+
+    void Need(size_t length) const {
+        if((size_t) (End - Data) < length) throw DamagedBytes();
+    }
+
+    template <typename V>
+    V Raw() {
+        Need(sizeof(V));
+        V value;
+        memcpy(&value, Data, sizeof(V));
+        Data += sizeof(V);
+        return value;
+    }
+
+    // A count of things can never be larger than the bytes left to hold them.
+    uint32_t Count() {
+        uint32_t count = Raw<uint32_t>();
+        Need(count);
+        return count;
+    }
+
+    std::string String() {
+        uint32_t length = Raw<uint32_t>();
+        Need(length);
+        std::string text(Data, length);
+        Data += length;
+        return text;
+    }
+
+    [[nodiscard]] bool AtEnd() const { return Data == End; }
+
+protected:
+    const char* Data;
+    const char* End;
+};
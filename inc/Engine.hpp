@@ -0,0 +1,128 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Program.hpp>
+#include <Snapshot.hpp>
+#include <interpreter/Interpreter.hpp>
+#include <interpreter/Native.hpp>
+
+/*
+ * An Engine is one independent instance of the Fusco runtime.
+ *
+ * It owns everything a script can touch: the global context, the Interpreter, its output
+ *  sink and its error state. Nothing is shared between Engines, so any number of them may
+ *  run at once, as long as each one is only used by one thread at a time.
+ *
+ * This is the entry point for programs that embed Fusco through libfusco.
+ */
+class Engine {
+public:
+    Engine();
+    explicit Engine(shared_ptr<OutputSink> output);
+
+    // Lets go of the globals, and so of every program only they were keeping alive.
+    ~Engine();
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    /**
+     * Lex, parse, resolve and run a script.
+     * @return false if the script failed to compile. Runtime errors are reported through the output.
+     */
+    bool Run(std::string_view source);
+
+    /**
+     * Run a script file, from its image when there is one that matches its contents.
+     */
+    bool RunFile(const std::string& path);
+
+    /**
+     * Run a compiled script. The program may be shared with any number of other Engines.
+     */
+    bool Execute(const shared_ptr<const CompiledProgram>& program);
+
+    /**
+     * Compile a template and call its render function.
+     */
+    bool Render(std::string_view source);
+
+    /**
+     * Render a template file, from its image when there is one that matches its contents.
+     */
+    bool RenderFile(const std::string& path);
+
+    /**
+     * Call the render function of a compiled template, in a fresh scope inside the globals.
+     * The program may be shared with any number of other Engines.
+     * @return false if the template failed to compile, or the render stopped at a runtime error;
+     *  whatever it wrote before the error has already gone to the output.
+     */
+    bool Render(const shared_ptr<const CompiledProgram>& program);
+
+    /**
+     * Define a global function, implemented by a plain C++ function, such as
+     *  double clamp(double value, double low, double high).
+     * Its arity and argument types are taken from its signature. Numbers, booleans, strings, arrays,
+     *  dictionaries and Objects may be taken and returned; an argument of the wrong type is a runtime error.
+     */
+    template <typename R, typename... Args>
+    void Define(const std::string& name, R (*function)(Args...)) {
+        struct Token token;
+        token.Lexeme = name;
+        Context->define(token, Object::NewCallable(std::make_shared<NativeFunction<R, Args...>>(name, function)));
+    }
+
+    /**
+     * Call a global function.
+     */
+    Object Call(const std::string& name, const std::vector<Object>& arguments = {});
+
+    /**
+     * Capture the globals, once a prelude has run, so that other Engines can start from them.
+     * @return the snapshot, or nullptr if the globals hold something that cannot be captured.
+     */
+    shared_ptr<const Snapshot> TakeSnapshot();
+
+    /**
+     * Start from a snapshot, in place of running the prelude it was taken after.
+     * Any natives the snapshot refers to must be defined first. Only use this on a fresh Engine.
+     */
+    bool Restore(const shared_ptr<const Snapshot>& snapshot);
+
+    /**
+     * Compile every function body still skipped by the pre-parse, in every program this Engine has run
+     *  that is still alive. Call it before forking, so that the children only ever read the trees.
+     */
+    void CompleteAll();
+
+    void SetOutput(shared_ptr<OutputSink> output);
+
+    [[nodiscard]] shared_ptr<Interpreter> GetInterpreter() const { return Runtime; }
+
+    // Print the parsed tree of every script before it runs.
+    bool DumpTree = false;
+
+    // Whether the last Run or Render failed to compile.
+    bool ErrorState = false;
+
+private:
+    shared_ptr<ExecutionContext> Context;
+    shared_ptr<Interpreter> Runtime;
+
+    /*
+     * Every script run or rendered by this Engine that is still alive, once each, for snapshots.
+     * The functions a program declares keep it alive, not the Engine; one that left nothing reachable
+     *  is let go as soon as it has run.
+     */
+    std::vector<std::weak_ptr<const CompiledProgram>> Loaded;
+
+    void Load(const shared_ptr<const CompiledProgram>& program);
+};
@@ -0,0 +1,80 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <interpreter/Interpreter.hpp>
+
+/*
+ * A heap dump is every object reachable from an interpreter's globals and its current environment,
+ *  and the references between them, for finding out what a long running process is holding on to.
+ *
+ * The walk follows what a snapshot does: enclosing contexts and their variables, closures, method
+ *  tables and superclasses, the fields of instances, the elements of arrays and dictionaries, and the
+ *  targets of their bound builtins. Strings are counted as part of whatever holds them.
+ *
+ * The size of an object is an estimate of what it holds itself: the object, its map or vector, and the
+ *  heap buffers of its strings, but not the bookkeeping of the allocator or of shared_ptr. The retained
+ *  size is what would go if the object did; that of every object it dominates, and its own.
+ */
+struct HeapObject {
+    // "context", "function", "bound method", "class", "instance", "array", "dictionary" or "native";
+    //  the first object is the root, of kind "root".
+    std::string Kind;
+    // The class of an instance, or the name of a class or function.
+    std::string Name;
+    uint64_t Size = 0;
+    uint64_t Retained = 0;
+    // The object every path from the root to this one goes through; the root is its own.
+    uint32_t Dominator = 0;
+};
+
+struct HeapEdge {
+    uint32_t From;
+    uint32_t To;
+    // The variable, field, key or index it is held under.
+    std::string Label;
+};
+
+// Every object of one class, or of one kind, for those that are not instances.
+struct HeapGroup {
+    uint64_t Count = 0;
+    uint64_t Size = 0;
+    // Without counting twice what one object of the group retains through another.
+    uint64_t Retained = 0;
+};
+
+struct HeapDump {
+    std::vector<HeapObject> Objects;
+    std::vector<HeapEdge> Edges;
+
+    /**
+     * The objects grouped by FClass::Name for instances, and by kind, in parentheses, for the rest.
+     */
+    [[nodiscard]] std::map<std::string, HeapGroup> Groups() const;
+};
+
+HeapDump CaptureHeap(const Interpreter& interpreter);
+
+/**
+ * As text: a header line, then one tab separated line per object and per edge.
+ */
+void WriteHeapDump(const HeapDump& dump, std::ostream& out);
+
+/**
+ * @return false if the text is not a heap dump; the reason is put in error.
+ */
+bool ReadHeapDump(std::istream& in, HeapDump& dump, std::string& error);
+
+/**
+ * A table of how every group changed from one dump to another, those that grew the most first.
+ */
+void WriteHeapDiff(const HeapDump& before, const HeapDump& after, std::ostream& out);
@@ -0,0 +1,55 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <Program.hpp>
+
+/*
+ * A program image is a compiled program, written to disk so that it never has to be lexed,
+ *  parsed or resolved again.
+ *
+ * An image holds the resolved tree, and every string it refers to in a single table.
+ * A function body that was skipped by the pre-parse is kept as its text, to be compiled when it is first called.
+ * It is only valid for the exact source it was compiled from, and for the exact interpreter
+ *  version that wrote it; anything else is treated as a cache miss, and the source is recompiled.
+ *
+ * By default an image is kept next to its source, as <source>.fsc.
+ * FUSCO_CACHE_DIR moves every image into one directory, and FUSCO_NO_CACHE turns images off.
+ */
+
+// Bumped whenever the layout of an image, or the meaning of what it holds, changes.
+#define IMAGE_FORMAT 3
+
+/**
+ * Serialize a compiled program.
+ * @return the image, or an empty string if the program holds something that cannot be written.
+ */
+std::string EncodeImage(const CompiledProgram& program);
+
+/**
+ * Rebuild a compiled program from an image.
+ * @return the program, or nullptr if the image is damaged, or was not compiled from this source by this version.
+ */
+shared_ptr<const CompiledProgram> DecodeImage(const char* data, size_t length, const std::string& path, uint64_t sourceHash, bool isTemplate);
+
+/**
+ * Where the image for the source at this path is kept.
+ * @return the image path, or an empty string if images are turned off.
+ */
+std::string ImagePath(const std::string& sourcePath);
+
+/**
+ * Map the image for this source into memory, and decode it.
+ * @return the program, or nullptr if there is no valid image for this exact source.
+ */
+shared_ptr<const CompiledProgram> LoadImage(const std::string& sourcePath, uint64_t sourceHash, bool isTemplate);
+
+/**
+ * Write the image for a program compiled from a file. Failing to write an image is never an error.
+ */
+bool SaveImage(const CompiledProgram& program);
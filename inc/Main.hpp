@@ -8,11 +8,10 @@
 #include <iostream>
 #include <memory>
 #include <fstream>
+#include <interpreter/Output.hpp>
 #include <interpreter/Types.hpp>
 #include <utility>
 
-extern bool ErrorState;
-
 using std::shared_ptr;
 
 #define EXPR shared_ptr<Expression<Object>>
@@ -21,6 +20,11 @@ using std::shared_ptr;
 
 class Common {
 public:
+    virtual ~Common() = default;
+
+    // Set once this stage has reported an error.
+    bool ErrorState = false;
+
     void Error(const Token& Cause, const std::string& Message) {
         Report(Cause.Line, "", Message);
         ErrorState = true;
@@ -36,8 +40,24 @@ public:
         ErrorState = true;
         return error;
     }
-private:
-    void Report(size_t Line, const std::string& Where, const std::string& Message) {
-        std::cout << "[line " << Line << "] Error" << Where << ": " << Message << std::endl;
+
+    /*
+     * The output of the script running on this thread, if any; set by the Interpreter for as long as
+     *  it runs. Every report flushes it first, whichever stage the error came from, so that errors
+     *  come after what the script printed before them.
+     */
+    inline static thread_local OutputSink* RunningOutput = nullptr;
+
+    /*
+     * Where every stage writes its reports; the console by default. Template mode sends them to stderr,
+     *  so that the page on stdout holds nothing but what was rendered.
+     */
+    inline static std::ostream* Reports = &std::cout;
+
+protected:
+    virtual void Report(size_t Line, const std::string& Where, const std::string& Message) {
+        if(RunningOutput != nullptr)
+            RunningOutput->Flush();
+        *Reports << "[line " << Line << "] Error" << Where << ": " << Message << std::endl;
     }
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Parse.hpp>
+#include <Program.hpp>
+
+/*
+ * Parses the top-level declarations of a large script on several threads at once, and gives the
+ *  same statements, in the same order, as a single Parser would.
+ *
+ * Tokens are read on this thread, and cut into ranges just before a 'func', 'class' or 'var' that is
+ *  outside of any parentheses, brackets or braces. Those can only begin a declaration, so every
+ *  range is a run of whole declarations that a Parser can take on its own.
+ *
+ * Workers parse the ranges, each into an Arena of its own, spawned from the program's. The ranges are
+ *  merged back in order, and only a few are read ahead of the merge, so the tokens held stay bounded.
+ * Workers report nothing. Once a range fails, it and everything after it is parsed again on this
+ *  thread, by a Parser that reports, so the errors are exactly those of a single Parser.
+ */
+class ParallelParser : public Common {
+public:
+    // No range is cut shorter than this many tokens.
+    static constexpr size_t RangeTokens = 16 * 1024;
+
+    /**
+     * @param pSource: Where the tokens are pulled from. It must outlive the ParallelParser.
+     * @param pNodes: Where to allocate the tree. Each worker allocates from an Arena spawned from it.
+     * @param pDeferred: Where function bodies are recorded, as for a Parser.
+     * @param Threads: How many workers to parse with; by default, one per hardware thread.
+     */
+    ParallelParser(TokenSource& pSource, shared_ptr<Arena> pNodes, DeferredSource* pDeferred, size_t Threads = 0);
+    ~ParallelParser() override;
+
+    ParallelParser(const ParallelParser&) = delete;
+    ParallelParser& operator=(const ParallelParser&) = delete;
+
+    std::vector<shared_ptr<Statement>> parse();
+
+    // How many ranges the script was cut into.
+    [[nodiscard]] size_t RangeCount() const { return Merged + Ranges.size(); }
+
+    // How many tokens have been read from the source.
+    [[nodiscard]] size_t TokenCount() const { return Tokens; }
+
+private:
+    struct Range {
+        std::vector<struct Token> Tokens;
+        // Where the first token is, and how many lines there are before it.
+        size_t Offset = 0;
+        size_t Lines = 0;
+
+        std::vector<shared_ptr<Statement>> Statements;
+        bool Parsed = false;
+        bool Failed = false;
+    };
+
+    TokenSource& source;
+    shared_ptr<Arena> Nodes;
+    DeferredSource* Deferred;
+
+    // The ranges that are not merged yet. Merged and Claimed count every range, including merged ones.
+    std::deque<Range> Ranges;
+    size_t Merged = 0;
+    size_t Claimed = 0;
+    size_t Tokens = 0;
+    size_t Window;
+    bool Stopping = false;
+
+    std::mutex Lock;
+    std::condition_variable Progress;
+    std::vector<std::thread> Workers;
+
+    void Work(const shared_ptr<Arena>& nodes);
+    void ParseRange(Range& range, const shared_ptr<Arena>& nodes);
+    // Wait for the first range, and take its statements. False if it failed.
+    bool MergeFront(std::vector<shared_ptr<Statement>>& statements);
+    void Stop();
+};
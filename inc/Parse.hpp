@@ -5,6 +5,7 @@
 
 #pragma once
 #include <lexer/Lex.hpp>
+#include <ast/Arena.hpp>
 #include <ast/Statement.hpp>
 #include <Main.hpp>
 #include <stdexcept>
@@ -12,14 +13,68 @@
 
 class Parser : public Common {
 public:
-    explicit Parser(std::vector<struct Token> pTokens)
-        : tokens(std::move(pTokens)), currentToken(0) {}
+    /**
+     * @param pSource: Where the tokens are pulled from, as they are needed. It must outlive the Parser.
+     * @param pNodes: Where to allocate the tree. Without one, every node is allocated on the heap.
+     * @param pDeferred: If given, function bodies are only pre-parsed: their braces are matched, and the
+     *  text between them is recorded here, to be parsed on the first call. The tokens must have been
+     *  lexed from its Text, which must outlive the parse.
+     */
+    explicit Parser(TokenSource& pSource, shared_ptr<Arena> pNodes = nullptr, DeferredSource* pDeferred = nullptr)
+        : source(pSource), currentToken(0), pulledTokens(0), Nodes(std::move(pNodes)), Deferred(pDeferred) {}
 
     std::vector<shared_ptr<Statement>> parse();
 
+    /**
+     * For a Parser that starts part way through the deferred text: its first token is at the offset,
+     *  and there are this many lines before it.
+     */
+    void CountLinesFrom(size_t offset, size_t lines) {
+        CountedOffset = offset;
+        CountedLines = lines;
+    }
+
+    /**
+     * Parse a template into a single render function, with the given name.
+     * The tokens must come from a Lexer in template mode.
+     */
+    std::vector<shared_ptr<Statement>> parseTemplate(const std::string& name);
+
+    // How many tokens have been read from the source.
+    [[nodiscard]] size_t TokenCount() const { return pulledTokens; }
+
 private:
-    std::vector<struct Token> tokens;
+    /*
+     * The parser only ever looks at the current token and the one before it, so only the last few
+     *  tokens are kept, in a ring. currentToken and pulledTokens count every token seen so far.
+     */
+    static constexpr size_t Lookahead = 4;
+
+    TokenSource& source;
+    struct Token tokens[Lookahead];
     size_t currentToken;
+    size_t pulledTokens;
+    shared_ptr<Arena> Nodes;
+
+    DeferredSource* Deferred;
+    // How many lines there are before an offset into the deferred text; bodies are found in order.
+    size_t CountedOffset = 0;
+    size_t CountedLines = 0;
+
+    /**
+     * Make a node in the tree, starting on the given line.
+     * The line is only kept in instrumented builds, for their counts; see NodeCounts.
+     */
+    template <typename T, typename... A>
+    shared_ptr<T> node(size_t line, A&&... args) {
+        shared_ptr<T> made = MakeNode<T>(Nodes, std::forward<A>(args)...);
+#ifdef FUSCO_INSTRUMENT
+        made->Counts.Line = line;
+#else
+        UNUSED(line);
+#endif
+        return made;
+    }
 
     /** Token Manipulation **/
     template <class... T>
@@ -27,7 +82,7 @@ private:
     bool check(Lexeme type);
     struct Token advance();
     struct Token previous();
-    struct Token peek();
+    const struct Token& peek();
     bool endOfStream();
 
     /** Statement Parsing **/
@@ -37,6 +92,7 @@ private:
     shared_ptr<Statement> statement();
     shared_ptr<Statement> returnStatement();
     shared_ptr<Statement> printStatement();
+    shared_ptr<Statement> emitStatement();
     shared_ptr<Statement> ifStatement();
     shared_ptr<Statement> whileStatement();
     shared_ptr<Statement> forStatement();
@@ -44,6 +100,7 @@ private:
     
     shared_ptr<ClassStatement> classDeclaration();
     shared_ptr<FuncStatement> function(std::string type);
+    shared_ptr<FuncStatement> deferFunction(const Token& name, const std::vector<Token>& parameters, const Token& brace);
 
     EXPR expression();
     EXPR assignment();
@@ -0,0 +1,131 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <ast/Arena.hpp>
+#include <ast/Statement.hpp>
+
+/*
+ * The function bodies of a program that were only pre-parsed, and what it takes to compile them later.
+ */
+struct DeferredSource {
+    // The source the bodies are taken from, only while the program is parsed. Every DeferredBody
+    //  copies its own range out of it, so the source is never copied as a whole.
+    std::string_view Text;
+    std::deque<DeferredBody> Bodies;
+
+    // Where the bodies are allocated, once they are parsed. The same Arena as the rest of the program.
+    shared_ptr<Arena> Nodes;
+
+    // Held while a body is compiled, since compiling allocates from the program's Arena,
+    //  and while a body is recorded, since several parsers may be recording them at once.
+    std::mutex Lock;
+};
+
+/*
+ * The result of lexing, parsing and resolving a source file.
+ *
+ * A compiled program is never modified once it has been built: the tree carries its own
+ *  resolution data and constants, so any number of interpreters may execute it at once.
+ * It is always handed around as a shared_ptr to const, and lives as long as anything uses it.
+ *
+ * The only exception is a function body that was skipped by the pre-parse. It is compiled on the
+ *  first call of its function, under the lock of its DeferredSource, and is never changed after.
+ */
+struct CompiledProgram {
+    std::string Path;
+    uint64_t SourceHash = 0;
+    bool Template = false;
+
+    // Where every node of the tree was allocated. Declared first, so that it is destroyed last.
+    shared_ptr<Arena> Nodes;
+
+    // The bodies that were skipped, or nullptr if every body was parsed up front.
+    std::unique_ptr<DeferredSource> Deferred;
+
+    std::vector<shared_ptr<Statement>> Statements;
+
+    /**
+     * For templates, the render function. It is called directly by Engine::Render,
+     *  so it never needs to be defined in the globals.
+     */
+    [[nodiscard]] FuncStatement* RenderFunction() const;
+};
+
+/**
+ * Compile a script, or a template.
+ * If the source came from a file, its image is used in place of compiling when it matches, and is
+ *  written when it does not. See Image.hpp.
+ * @param path: The file the source was read from, or empty.
+ * @return the program, or nullptr if it failed to compile. Errors have already been reported.
+ */
+shared_ptr<const CompiledProgram> CompileProgram(std::string_view source, const std::string& path, bool isTemplate);
+
+uint64_t HashSource(std::string_view source);
+
+/**
+ * Make sure a function's body has been parsed and resolved, doing so now if it was skipped by the pre-parse.
+ * Safe to call from any number of threads at once.
+ * @throws RuntimeError if the body does not compile. Its errors have already been reported.
+ */
+void CompleteDeferred(FuncStatement& function);
+
+inline void CompleteFunction(FuncStatement& function) {
+    if(function.Deferred.load(std::memory_order_acquire) != nullptr)
+        CompleteDeferred(function);
+}
+
+/**
+ * Compile every body of a program that the pre-parse skipped, now rather than on first call; before
+ *  forking, so that no process allocates into the shared Arena afterwards.
+ * Bodies that do not compile are reported now, and throw when their function is called.
+ */
+void CompleteProgram(const CompiledProgram& program);
+
+/*
+ * A cache of compiled programs, shared between threads, and keyed by path and content hash.
+ *
+ * Lookups only take a shared lock, so they never wait on each other. Compiling happens outside
+ *  of any lock; if two threads compile the same source at once, the first to finish wins.
+ * Replacing or removing a program never disturbs a render that is using it, because the render
+ *  holds its own reference.
+ */
+class ProgramCache {
+public:
+    /**
+     * Find a compiled program by path, without touching the disk.
+     * @return the program, or nullptr if it has never been compiled or was invalidated.
+     */
+    shared_ptr<const CompiledProgram> Find(const std::string& path) const;
+
+    /**
+     * Find the program compiled from this exact source, or compile it.
+     * @return the program, or nullptr if it failed to compile.
+     */
+    shared_ptr<const CompiledProgram> Get(const std::string& path, std::string_view source, bool isTemplate);
+
+    /**
+     * Read the file at the path, and return the program compiled from its current contents.
+     */
+    shared_ptr<const CompiledProgram> Load(const std::string& path, bool isTemplate);
+
+    void Invalidate(const std::string& path);
+    void Clear();
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    mutable std::shared_mutex Lock;
+    std::unordered_map<std::string, shared_ptr<const CompiledProgram>> Programs;
+};
@@ -0,0 +1,47 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <Program.hpp>
+#include <interpreter/Interpreter.hpp>
+
+/*
+ * A snapshot is the state of an interpreter's globals, taken once a prelude has run, so that
+ *  any number of new interpreters can start from that state without running the prelude again.
+ *
+ * The blob holds every object reachable from the globals: the contexts and closures, classes
+ *  and their method tables, instances, arrays and dictionaries. Functions are not copied; they
+ *  refer to their declaration by index into the programs that were run, which the snapshot keeps
+ *  alive and shares with every interpreter restored from it.
+ *
+ * Natives cannot be serialized, so they are recorded by the global name they were defined under,
+ *  and bound again to whatever the restoring interpreter has defined under that name.
+ */
+struct Snapshot {
+    std::vector<shared_ptr<const CompiledProgram>> Programs;
+
+    // Every function declaration in the programs, in the order the blob numbers them, and the program of each.
+    std::vector<shared_ptr<FuncStatement>> Functions;
+    std::vector<shared_ptr<const CompiledProgram>> FunctionPrograms;
+
+    std::string Blob;
+};
+
+/**
+ * Take a snapshot of the globals of an interpreter that has run these programs.
+ * @return the snapshot, or nullptr if something reachable cannot be serialized; the reason is put in error.
+ */
+shared_ptr<const Snapshot> CaptureSnapshot(const std::vector<shared_ptr<const CompiledProgram>>& programs,
+                                           const shared_ptr<Interpreter>& interpreter, std::string& error);
+
+/**
+ * Rebuild the globals of a snapshot into a fresh interpreter, replacing any global of the same name.
+ * @return false if the blob is damaged, or refers to a native this interpreter does not define.
+ *  The interpreter may then hold part of the snapshot, and should be thrown away.
+ */
+bool RestoreSnapshot(const Snapshot& snapshot, const shared_ptr<Interpreter>& interpreter);
@@ -0,0 +1,48 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <string>
+#include <string_view>
+
+/*
+ * The text of a source, held for as long as it is being compiled.
+ *
+ * A regular file is mapped into memory read-only, so it is never copied, and every process
+ *  reading the same file shares the pages of the page cache. Anything that cannot be mapped - a
+ *  pipe, stdin, an empty file - is read into memory instead. So is a source that was built in memory.
+ *
+ * A mapping shows whatever is in the file now, so nothing that outlives the compile may keep a view into it.
+ */
+class SourceText {
+public:
+    SourceText() = default;
+    explicit SourceText(std::string text);
+    ~SourceText();
+
+    SourceText(SourceText&& other) noexcept;
+    SourceText& operator=(SourceText&& other) noexcept;
+    SourceText(const SourceText&) = delete;
+    SourceText& operator=(const SourceText&) = delete;
+
+    /**
+     * Map the file at the path, or read it if it cannot be mapped.
+     * @return false if the file could not be opened or read.
+     */
+    bool Load(const std::string& path);
+
+    [[nodiscard]] std::string_view View() const { return { Data, Length }; }
+
+    // Whether the text is a mapping of the file, rather than a copy.
+    [[nodiscard]] bool IsMapped() const { return Mapped; }
+
+private:
+    std::string Owned;
+    const char* Data = "";
+    size_t Length = 0;
+    bool Mapped = false;
+
+    void Release();
+};
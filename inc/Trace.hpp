@@ -0,0 +1,123 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * One span of a trace: what ran, on which thread, from when and for how long, and what it counted.
+ * Each argument is kept as the JSON of its value.
+ */
+struct TraceEvent {
+    std::string Name;
+    const char* Category = "";
+    std::chrono::steady_clock::time_point Start;
+    std::chrono::steady_clock::duration Duration {};
+    std::thread::id Thread;
+    std::vector<std::pair<const char*, std::string>> Arguments;
+};
+
+/*
+ * Records where a program's time went, as the Chrome trace_event format that Perfetto and
+ *  chrome://tracing open.
+ *
+ * Every stage of compiling and running a program is a span: lexing and parsing - which happen
+ *  together, as the parser pulls its tokens - resolving, loading and saving images, printing the tree,
+ *  running and rendering. Each counts what it made: tokens, nodes, and heap allocations, if the
+ *  program counts those. Calls of script functions are spans too, if asked for.
+ *
+ * Only one TraceLog records at a time. While none does, a span costs the load of a pointer.
+ */
+class TraceLog {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TraceLog(bool pCalls = false) : Calls(pCalls) {}
+    ~TraceLog();
+
+    TraceLog(const TraceLog&) = delete;
+    TraceLog& operator=(const TraceLog&) = delete;
+
+    // False if another TraceLog is recording.
+    bool Start();
+    void Stop();
+
+    // The TraceLog that is recording, if any.
+    static TraceLog* Active() { return ActiveLog.load(std::memory_order_acquire); }
+
+    /**
+     * Count heap allocations with a counter the program keeps; see Main.cpp.
+     * The library does not replace operator new itself, so that embedding programs keep their own.
+     */
+    void CountAllocationsWith(const std::atomic<uint64_t>* counter) { AllocationCounter = counter; }
+    [[nodiscard]] bool CountsAllocations() const { return AllocationCounter != nullptr; }
+    [[nodiscard]] uint64_t Allocations() const {
+        return AllocationCounter == nullptr ? 0 : AllocationCounter->load(std::memory_order_relaxed);
+    }
+
+    void Record(TraceEvent event);
+
+    // {"traceEvents": [...]}, with every span as a complete ("X") event, in microseconds from Start.
+    void WriteJSON(std::ostream& out);
+
+    // Whether calls of script functions are recorded too.
+    const bool Calls;
+
+private:
+    static std::atomic<TraceLog*> ActiveLog;
+
+    Clock::time_point Origin;
+    const std::atomic<uint64_t>* AllocationCounter = nullptr;
+
+    // Spans may end on any thread, such as the parallel parser's.
+    std::mutex Lock;
+    std::vector<TraceEvent> Events;
+};
+
+/*
+ * A span of the active TraceLog, from its construction to its destruction, however that comes.
+ * Without an active TraceLog, it does nothing. The TraceLog must outlive every span begun in it.
+ */
+class TraceSpan {
+public:
+    // A stage of the pipeline, which also counts the allocations made during it.
+    TraceSpan(const char* name, const char* category = "stage") {
+        if(TraceLog* log = TraceLog::Active())
+            Begin(log, name, category, true);
+    }
+
+    // A call of a function, if calls are being traced.
+    explicit TraceSpan(const std::string& function) {
+        if(TraceLog* log = TraceLog::Active(); log != nullptr && log->Calls)
+            Begin(log, function, "call", false);
+    }
+
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    [[nodiscard]] bool Recording() const { return Event.has_value(); }
+
+    void Argument(const char* name, uint64_t value);
+    void Argument(const char* name, const std::string& value);
+
+private:
+    TraceLog* Log = nullptr;
+    std::optional<TraceEvent> Event;
+    bool CountAllocations = false;
+    uint64_t AllocationsBefore = 0;
+
+    void Begin(TraceLog* log, std::string name, const char* category, bool countAllocations);
+};
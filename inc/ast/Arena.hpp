@@ -0,0 +1,98 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <interpreter/Memory.hpp>
+
+using std::shared_ptr;
+
+/*
+ * A bump allocator for the nodes of one compiled program.
+ *
+ * Nodes are never freed one at a time; the Arena destroys them all, and gives back the memory, when
+ *  it goes. Blocks are whole pages of their own, so nothing that changes at runtime ever shares a page
+ *  with the tree. The pointers to a node own nothing, so there are no reference counts in the blocks
+ *  either. After a fork, the pages of a tree stay shared between every process that runs it, as long
+ *  as nothing writes to the nodes, or allocates more of them.
+ */
+class Arena {
+public:
+    explicit Arena(size_t pBlockSize = 64 * 1024) : BlockSize(pBlockSize) {}
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+
+    // Construct an object in the Arena, to be destroyed along with it.
+    template <typename T, typename... A>
+    T* Make(A&&... args) {
+        T* made = new (Allocate(sizeof(T), alignof(T))) T(std::forward<A>(args)...);
+        if constexpr(!std::is_trivially_destructible_v<T>)
+            Destructors.push_back({ made, [](void* object) { static_cast<T*>(object)->~T(); } });
+        return made;
+    }
+
+    /**
+     * An Arena for another thread to allocate from, freed along with this one.
+     * Only the thread that owns this Arena may make them.
+     */
+    shared_ptr<Arena> Spawn();
+
+    // Bytes reserved from the system, and bytes handed out, including those of spawned Arenas.
+    [[nodiscard]] size_t Reserved() const;
+    [[nodiscard]] size_t Used() const;
+
+    // How many allocations were made, including from spawned Arenas; one for every node.
+    [[nodiscard]] size_t Allocations() const;
+
+    // Every block handed out from, including those of spawned Arenas, as [begin, end).
+    [[nodiscard]] std::vector<std::pair<const char*, const char*>> Extents() const;
+
+private:
+    struct Block {
+        char* Memory;
+        size_t Size;
+    };
+
+    struct Destructor {
+        void* Object;
+        void (*Destroy)(void* object);
+    };
+
+    size_t BlockSize;
+    std::vector<Block> Blocks;
+    // Of everything made that needs destroying, run newest first when the Arena goes.
+    std::vector<Destructor> Destructors;
+    std::vector<shared_ptr<Arena>> Children;
+    char* Next = nullptr;
+    char* Limit = nullptr;
+    size_t ReservedBytes = 0;
+    size_t UsedBytes = 0;
+    size_t AllocationCount = 0;
+};
+
+/**
+ * Construct a node in the arena, or on the heap if there is no arena.
+ * A node in an arena is not owned by the pointers to it: they share no control block, so copying one
+ *  writes nothing. Whatever holds them must keep the Arena alive; a CompiledProgram declares its Arena
+ *  before its tree, and a Function holds its program.
+ */
+template <typename T, typename... A>
+shared_ptr<T> MakeNode(const shared_ptr<Arena>& arena, A&&... args) {
+    shared_ptr<T> made = arena == nullptr ? std::make_shared<T>(std::forward<A>(args)...)
+                                          : shared_ptr<T>(shared_ptr<T>(), arena->Make<T>(std::forward<A>(args)...));
+#ifdef FUSCO_INSTRUMENT
+    made->Accounted.Recount(MEM_NODES, sizeof(T));
+#endif
+    return made;
+}
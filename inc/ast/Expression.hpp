@@ -6,6 +6,17 @@
 #include <lexer/Lex.hpp>
 #include <utility>
 
+#ifdef FUSCO_INSTRUMENT
+/*
+ * What an instrumented build keeps on every node: the line it starts on, to count its runs against.
+ * Set by the Parser, and never written after; the counts are kept by each Interpreter, in its HeatMap,
+ *  so that running a tree leaves its pages as they were.
+ */
+struct NodeCounts {
+    size_t Line = 0;
+};
+#endif
+
 template <typename T>
 class BinaryExpression;
 
@@ -39,6 +50,14 @@ class SetExpression;
 template <typename T>
 class ThisExpression;
 
+template <typename T>
+class ArrayExpression;
+
+template <typename T>
+class IndexExpression;
+
+template <typename T>
+class IndexSetExpression;
 
 template <typename T>
 class ExpressionVisitor {
@@ -57,10 +76,13 @@ public:
     virtual T visitGetExpression(GetExpression<T> &expr) = 0;
     virtual T visitSetExpression(SetExpression<T> &expr) = 0;
     virtual T visitThisExpression(ThisExpression<T> &expr) = 0;
+    virtual T visitArrayExpression(ArrayExpression<T> &expr) = 0;
+    virtual T visitIndexExpression(IndexExpression<T> &expr) = 0;
+    virtual T visitIndexSetExpression(IndexSetExpression<T> &expr) = 0;
 };
 
 template <typename T>
-class Expression : std::enable_shared_from_this<Expression<T>> {
+class Expression {
 public:
     Expression() = default;
     Expression(const Expression&) = delete;
@@ -69,6 +91,17 @@ public:
     virtual T accept(shared_ptr<ExpressionVisitor<T>> visitor) {
         return visitor->dummy();
     };
+
+    // Set by the Resolver, on expressions that name a variable: how many scopes out from the
+    //  current one the variable lives. -1 means it is a global.
+    // Keeping this in the tree, rather than in the Interpreter, lets one resolved tree be shared.
+    int Depth = -1;
+
+#ifdef FUSCO_INSTRUMENT
+    NodeCounts Counts;
+    // Resized to the whole node by MakeNode.
+    Counted Accounted { MEM_NODES, sizeof(Expression) };
+#endif
 };
 
 template <typename T>
@@ -220,4 +253,49 @@ public:
     }
 
     Token Name;
+};
+
+template <typename T>
+class ArrayExpression : public Expression<T> {
+public:
+    explicit ArrayExpression(Token pBracket, std::vector<shared_ptr<Expression<T>>> pElements)
+        : Bracket(std::move(pBracket)), Elements(std::move(pElements)) {}
+
+    T accept(shared_ptr<ExpressionVisitor<T>> visitor) override {
+        return visitor->visitArrayExpression(*this);
+    }
+
+    Token Bracket;
+    std::vector<shared_ptr<Expression<T>>> Elements;
+};
+
+template <typename T>
+class IndexExpression : public Expression<T> {
+public:
+    explicit IndexExpression(shared_ptr<Expression<T>> pObject, Token pBracket, shared_ptr<Expression<T>> pIndex)
+        : Obj(pObject), Bracket(std::move(pBracket)), Index(pIndex) {}
+
+    T accept(shared_ptr<ExpressionVisitor<T>> visitor) override {
+        return visitor->visitIndexExpression(*this);
+    }
+
+    shared_ptr<Expression<T>> Obj;
+    Token Bracket;
+    shared_ptr<Expression<T>> Index;
+};
+
+template <typename T>
+class IndexSetExpression : public Expression<T> {
+public:
+    explicit IndexSetExpression(shared_ptr<Expression<T>> pObject, Token pBracket, shared_ptr<Expression<T>> pIndex, shared_ptr<Expression<T>> pValue)
+        : Obj(pObject), Bracket(std::move(pBracket)), Index(pIndex), Value(pValue) {}
+
+    T accept(shared_ptr<ExpressionVisitor<T>> visitor) override {
+        return visitor->visitIndexSetExpression(*this);
+    }
+
+    shared_ptr<Expression<T>> Obj;
+    Token Bracket;
+    shared_ptr<Expression<T>> Index;
+    shared_ptr<Expression<T>> Value;
 };
\ No newline at end of file
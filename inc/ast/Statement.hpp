@@ -5,6 +5,8 @@
 #pragma once
 #include <lexer/Lex.hpp>
 #include <ast/Expression.hpp>
+#include <atomic>
+#include <map>
 #include <utility>
 
 class ExpressionStatement;
@@ -16,6 +18,8 @@ class WhileStatement;
 class FuncStatement;
 class ClassStatement;
 class ReturnStatement;
+class TextStatement;
+class EmitStatement;
 
 class StatementVisitor {
     public:
@@ -30,12 +34,20 @@ class StatementVisitor {
     virtual void visitFunc(FuncStatement &Func) = 0;
     virtual void visitClass(ClassStatement &Class) = 0;
     virtual void visitReturn(ReturnStatement &Return) = 0;
+    virtual void visitText(TextStatement &Text) = 0;
+    virtual void visitEmit(EmitStatement &Emit) = 0;
 };
 
-class Statement : public std::enable_shared_from_this<Statement> {
+class Statement {
     public:
     virtual void accept(shared_ptr<StatementVisitor> visitor) = 0;
     virtual ~Statement() = default;
+
+#ifdef FUSCO_INSTRUMENT
+    NodeCounts Counts;
+    // Resized to the whole node by MakeNode.
+    Counted Accounted { MEM_NODES, sizeof(Statement) };
+#endif
 };
 
 class ExpressionStatement : public Statement {
@@ -106,10 +118,38 @@ class WhileStatement : public Statement {
     shared_ptr<Statement> Body;
 };
 
+struct DeferredSource;
+
+/*
+ * A function body that has only been pre-parsed: its braces were matched, and nothing more.
+ * It is parsed and resolved when its function is first called; see CompleteFunction in Program.hpp.
+ */
+struct DeferredBody {
+    DeferredSource* Source;
+    // The function whose body it is; set when the function is made.
+    class FuncStatement* Function = nullptr;
+
+    // The text between the braces, copied out of the source, and the line it starts on.
+    //  The text is released once the body has compiled.
+    std::string Text;
+    size_t Line;
+
+    // Filled in by the Resolver: the scopes the function was declared in, and what kind of function it is.
+    std::vector<std::map<std::string, bool>> Scopes;
+    ClassType Class = C_NONE;
+    FunctionType Type = FUNCTION;
+
+    // Set once the body has failed to compile, so that the errors are only reported once.
+    bool Failed = false;
+};
+
 class FuncStatement : public Statement {
     public:
-    explicit FuncStatement(Token pName, std::vector<Token> pParams, std::vector<shared_ptr<Statement>> pBody)
-        : Name(std::move(pName)), Params(std::move(pParams)), Body(std::move(pBody)) {}
+    explicit FuncStatement(Token pName, std::vector<Token> pParams, std::vector<shared_ptr<Statement>> pBody, DeferredBody* pDeferred = nullptr)
+        : Name(std::move(pName)), Params(std::move(pParams)), Body(std::move(pBody)), Deferred(pDeferred) {
+        if(pDeferred != nullptr)
+            pDeferred->Function = this;
+    }
 
     void accept(shared_ptr<StatementVisitor> visitor) override {
         visitor->visitFunc(*this);
@@ -118,6 +158,9 @@ class FuncStatement : public Statement {
     Token Name;
     std::vector<Token> Params;
     std::vector<shared_ptr<Statement>> Body;
+
+    // Set while the body has not been parsed. Cleared once Body is complete, and never set again.
+    std::atomic<DeferredBody*> Deferred;
 };
 
 class ClassStatement : public Statement {
@@ -145,4 +188,34 @@ class ReturnStatement : public Statement {
 
     Token Keyword;
     EXPR Value;
+};
+
+/*
+ * A run of static markup in a template.
+ * The text is fixed at parse time, and is written to the output as-is.
+ */
+class TextStatement : public Statement {
+    public:
+    explicit TextStatement(std::string pText) : Text(std::move(pText)) {}
+
+    void accept(shared_ptr<StatementVisitor> visitor) override {
+        visitor->visitText(*this);
+    }
+
+    std::string Text;
+};
+
+/*
+ * A <%= expression %> island in a template.
+ * Unlike print, the value is written with no prefix or line break.
+ */
+class EmitStatement : public Statement {
+    public:
+    explicit EmitStatement(EXPR pExpr) : Expr(std::move(pExpr)) {}
+
+    void accept(shared_ptr<StatementVisitor> visitor) override {
+        visitor->visitEmit(*this);
+    }
+
+    EXPR Expr;
 };
\ No newline at end of file
@@ -0,0 +1,68 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+#pragma once
+#include <string>
+#include <vector>
+#include <interpreter/Types.hpp>
+
+/*
+ * A native, contiguous array.
+ *
+ * Arrays start out with packed storage: a flat vector of doubles, with no per-element
+ *  Object overhead. This is the common case for tables of numbers.
+ * The first time a non-number is stored, the array is converted to boxed storage,
+ *  a flat vector of Objects. It never converts back.
+ */
+class Array {
+public:
+    Array() = default;
+    explicit Array(std::vector<Object> elements);
+
+    [[nodiscard]] size_t length() const {
+        return Packed ? Numbers.size() : Elements.size();
+    }
+
+    [[nodiscard]] bool isPacked() const { return Packed; }
+
+    Object at(size_t index) const;
+    void set(size_t index, const Object& value);
+    void push(const Object& value);
+    Object pop();
+
+    std::string ToString() const;
+
+private:
+    bool Packed = true;
+    std::vector<double> Numbers;
+    std::vector<Object> Elements;
+
+    void Box();
+};
+
+/*
+ * The builtin members of an Array, bound to a specific Array.
+ * These are returned by a property access like `list.push`, and are dispatched natively
+ *  without going through the Instance property lookup.
+ */
+class ArrayMethod : public Callable {
+public:
+    enum Kind {
+        PUSH,
+        POP
+    };
+
+    ArrayMethod(shared_ptr<Array> pTarget, Kind pKind) : Target(std::move(pTarget)), Method(pKind) {}
+    ~ArrayMethod() override = default;
+
+    size_t arguments() override { return Method == PUSH ? 1 : 0; }
+
+    Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) override;
+
+private:
+    friend class HeapWalker;
+
+    shared_ptr<Array> Target;
+    Kind Method;
+};
@@ -0,0 +1,148 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <interpreter/Types.hpp>
+
+/*
+ * An interned string.
+ * Every distinct key string is stored once per Interpreter, with its hash precomputed,
+ *  so that dictionary probes compare pointers rather than string contents.
+ */
+struct InternedString {
+    std::string Text;
+    uint64_t Hash;
+};
+
+uint64_t HashBytes(const char* data, size_t length);
+uint64_t HashNumber(double number);
+
+/*
+ * The set of all interned strings known to an Interpreter.
+ * Lookups that do not need to create a new string (dictionary reads, deletes) use Find,
+ *  which never grows the pool.
+ *
+ * The pool only holds on to a string for as long as some key does: it keeps weak references, and
+ *  the slots of strings that have gone are reused, or dropped when the table is next rebuilt. A long
+ *  running Interpreter that sees many distinct keys keeps only those still in use.
+ */
+class StringPool {
+public:
+    shared_ptr<const InternedString> Intern(const std::string& text);
+    shared_ptr<const InternedString> Find(const std::string& text) const;
+
+    // The strings still in use.
+    [[nodiscard]] size_t size() const;
+
+    // The slots of the table, which shrinks along with the strings in use when it is rebuilt.
+    [[nodiscard]] size_t capacity() const { return Slots.size(); }
+
+private:
+    struct Slot {
+        std::weak_ptr<const InternedString> String;
+        uint64_t Hash = 0;
+        // Whether the slot was ever filled; a slot whose string has gone still continues a probe.
+        bool Used = false;
+    };
+
+    std::vector<Slot> Slots;
+    size_t Used = 0;
+
+    size_t Probe(const std::string& text, uint64_t hash, shared_ptr<const InternedString>& found) const;
+    void Rebuild();
+};
+
+/*
+ * A dictionary key: either an interned string, or a number.
+ */
+struct DictKey {
+    shared_ptr<const InternedString> Str;
+    double Num = 0;
+    uint64_t Hash = 0;
+
+    [[nodiscard]] bool isString() const { return Str != nullptr; }
+
+    bool operator==(const DictKey& other) const;
+
+    [[nodiscard]] Object ToObject() const;
+};
+
+/*
+ * A native hash map, with open addressing in the style of the Swiss table.
+ *
+ * The index is an array of one-byte control words, grouped into 16-byte groups, and a parallel
+ *  array of slots. A control word is either empty, deleted, or the low 7 bits of the hash of
+ *  the entry in that slot. A probe hashes the key once, then compares the whole group of control
+ *  words at a time, and only touches the entries whose 7 bits matched.
+ *
+ * The slots refer into a dense vector of entries, kept in insertion order, which is what
+ *  iteration walks. Deleting an entry leaves a hole that is squeezed out on the next rehash.
+ */
+class Dictionary {
+public:
+    Dictionary();
+
+    [[nodiscard]] size_t size() const { return Live; }
+
+    bool get(const DictKey& key, Object& value) const;
+    void set(const DictKey& key, const Object& value);
+    bool remove(const DictKey& key);
+
+    [[nodiscard]] std::vector<Object> keys() const;
+    [[nodiscard]] std::vector<Object> values() const;
+
+    std::string ToString() const;
+
+private:
+    struct Entry {
+        DictKey Key;
+        Object Value;
+        bool Alive;
+    };
+
+    static constexpr size_t GroupWidth = 16;
+
+    std::vector<int8_t> Control;
+    std::vector<uint32_t> Slots;
+    std::vector<Entry> Entries;
+
+    size_t Live = 0;
+    size_t Used = 0; // Control words that are not empty, including deletion markers.
+
+    size_t Find(const DictKey& key) const;
+    void Rehash(size_t capacity);
+    void Place(uint64_t hash, uint32_t entry);
+};
+
+/*
+ * The builtin members of a Dictionary, bound to a specific Dictionary.
+ */
+class DictionaryMethod : public Callable {
+public:
+    enum Kind {
+        GET,
+        SET,
+        HAS,
+        DELETE,
+        KEYS,
+        VALUES
+    };
+
+    DictionaryMethod(shared_ptr<Dictionary> pTarget, Kind pKind) : Target(std::move(pTarget)), Method(pKind) {}
+    ~DictionaryMethod() override = default;
+
+    size_t arguments() override;
+
+    Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) override;
+
+private:
+    friend class HeapWalker;
+
+    shared_ptr<Dictionary> Target;
+    Kind Method;
+};
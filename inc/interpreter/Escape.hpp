@@ -0,0 +1,25 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstddef>
+#include <interpreter/Output.hpp>
+
+/*
+ * Escapes text for the places templates put it, writing straight into a sink.
+ *
+ * Each finds the next byte that must be escaped with SSE2 or AVX2, as the lexer's scanners do, and
+ *  writes the clean run before it in one piece. FUSCO_SCAN=scalar or sse2 applies here too.
+ */
+using EscapeKernel = void (*)(const char* text, size_t length, OutputSink& out);
+
+// For text between tags, and quoted attribute values: & < > " '
+void EscapeHtml(const char* text, size_t length, OutputSink& out);
+
+// For attribute values, quoted or not: as EscapeHtml, and also whitespace, = and `
+void EscapeAttr(const char* text, size_t length, OutputSink& out);
+
+// For URL components: everything but letters, digits and - . _ ~ becomes %XX, byte by byte.
+void UrlEncode(const char* text, size_t length, OutputSink& out);
@@ -7,6 +7,8 @@
 #include <chrono>
 #include <vector>
 #include <interpreter/Types.hpp>
+#include <interpreter/Dictionary.hpp>
+#include <interpreter/Escape.hpp>
 
 class Interpreter;
 
@@ -16,9 +18,87 @@ public:
 
     size_t arguments() override { return 0; }
 
+    const std::string& name() override {
+        static const std::string Name = "getTime";
+        return Name;
+    }
+
     Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) override {
         UNUSED(interpreter); UNUSED(arguments);
         double time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
         return Object::NewNum(time);
     }
-};
\ No newline at end of file
+};
+
+class NewDictionary : public Callable {
+public:
+    ~NewDictionary() override = default;
+
+    size_t arguments() override { return 0; }
+
+    const std::string& name() override {
+        static const std::string Name = "Dict";
+        return Name;
+    }
+
+    Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) override {
+        UNUSED(interpreter); UNUSED(arguments);
+        return Object::NewDictionary(std::make_shared<Dictionary>());
+    }
+};
+
+/*
+ * escapeHtml, escapeAttr and urlEncode. Each takes any value, and gives its text escaped.
+ * A template that emits the call directly, as in <%= escapeHtml(name) %>, has it escaped straight
+ *  into the output instead, without the escaped string ever being made.
+ */
+class Escaper : public Callable {
+public:
+    Escaper(std::string pName, EscapeKernel pKernel) : Name(std::move(pName)), Kernel(pKernel) {}
+    ~Escaper() override = default;
+
+    size_t arguments() override { return 1; }
+
+    const std::string& name() override { return Name; }
+
+    Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) override {
+        UNUSED(interpreter);
+        BufferSink escaped;
+        Write(arguments[0], escaped);
+        return Object::NewStr(escaped.Take());
+    }
+
+    void Write(Object& value, OutputSink& out) {
+        if(value.Type == Object::StrType) {
+            Kernel(value.StrData.data(), value.StrData.size(), out);
+            return;
+        }
+
+        std::string text = value.ToString();
+        Kernel(text.data(), text.size(), out);
+    }
+
+private:
+    std::string Name;
+    EscapeKernel Kernel;
+};
+
+#ifdef FUSCO_INSTRUMENT
+/*
+ * memoryStats(): a dictionary of every memory category, each a dictionary of live, peak and total,
+ *  in objects and in bytes. See Memory.hpp.
+ */
+class MemoryStats : public Callable {
+public:
+    ~MemoryStats() override = default;
+
+    size_t arguments() override { return 0; }
+
+    const std::string& name() override {
+        static const std::string Name = "memoryStats";
+        return Name;
+    }
+
+    Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) override;
+};
+#endif
@@ -0,0 +1,91 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <ast/Expression.hpp>
+
+/*
+ * How often each line of each script ran, and for how long; kept by instrumented builds.
+ *
+ * Every statement and expression the Interpreter runs is counted against the script it is in, by path,
+ *  and the line it starts on. The time of a line is inclusive - it counts what its calls did - and only
+ *  the outermost of its nodes running at any moment is timed, so a line is not counted twice for its
+ *  subexpressions, nor for recursion. Lines are numbered as errors report them; a script compiled from
+ *  a string has an empty path.
+ * The counts are the Interpreter's own, not the tree's, so running a tree never writes to it.
+ */
+class HeatMap {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct LineHeat {
+        uint64_t Count = 0;
+        uint64_t Nanoseconds = 0;
+        // How many of the line's nodes are running now; its time is counted from when the first began.
+        size_t Active = 0;
+        Clock::time_point Since;
+    };
+    using FileHeat = std::vector<LineHeat>;
+
+    // The lines of the script at path. Nodes run mostly one script at a time, so the last is kept at hand.
+    FileHeat& File(const std::string& path) {
+        if(Last == nullptr || Last->first != path)
+            Last = &*Files.try_emplace(path).first;
+        return Last->second;
+    }
+
+    static void Enter(FileHeat& file, size_t line) {
+        if(line >= file.size())
+            file.resize(line + 1);
+
+        LineHeat& heat = file[line];
+        heat.Count++;
+        if(heat.Active++ == 0)
+            heat.Since = Clock::now();
+    }
+
+    static void Leave(FileHeat& file, size_t line) {
+        LineHeat& heat = file[line];
+        if(--heat.Active == 0)
+            heat.Nanoseconds += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - heat.Since).count();
+    }
+
+    // {"lines": [{"path": P, "line": N, "count": N, "inclusive_ns": N}, ...]}, for every line that ran,
+    //  by path and then by line.
+    void WriteJSON(std::ostream& out) const;
+
+private:
+    std::map<std::string, FileHeat> Files;
+    std::pair<const std::string, FileHeat>* Last = nullptr;
+};
+
+#ifdef FUSCO_INSTRUMENT
+/*
+ * Counts a node as run, for as long as it is in scope, however it ends.
+ */
+class HeatScope {
+public:
+    HeatScope(HeatMap& pHeat, const std::string& path, const NodeCounts& counts)
+        : File(pHeat.File(path)), Line(counts.Line) {
+        HeatMap::Enter(File, Line);
+    }
+
+    ~HeatScope() { HeatMap::Leave(File, Line); }
+
+    HeatScope(const HeatScope&) = delete;
+    HeatScope& operator=(const HeatScope&) = delete;
+
+private:
+    HeatMap::FileHeat& File;
+    size_t Line;
+};
+#endif
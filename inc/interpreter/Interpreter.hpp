@@ -11,6 +11,9 @@
 #include <string>
 #include <ast/Statement.hpp>
 #include <interpreter/Globals.hpp>
+#include <interpreter/Heat.hpp>
+#include <interpreter/Output.hpp>
+#include <interpreter/Profiler.hpp>
 #include <utility>
 
 using std::shared_ptr;
@@ -73,9 +76,39 @@ class ExecutionContext : Common, public std::enable_shared_from_this<ExecutionCo
         }
     }
 
+    // Drop every variable, and with them the cycles between a context and the closures defined in it.
+    void clear() {
+        ObjectMap.clear();
+    }
+
     private:
+    // Snapshots read and rebuild contexts directly, and heap dumps read them.
+    friend class SnapshotWriter;
+    friend class SnapshotReader;
+    friend class HeapWalker;
+
     shared_ptr<ExecutionContext> Enclosing;
     std::map<std::string, Object> ObjectMap;
+
+#ifdef FUSCO_INSTRUMENT
+    Counted Accounted { MEM_CONTEXTS, sizeof(ExecutionContext) };
+#endif
+};
+
+/*
+ * Makes a sink the one flushed before every error reported on this thread, for as long as it is in
+ *  scope; see Common::RunningOutput. Scopes nest, as calls from C++ into scripts and back do.
+ */
+class RunningScope {
+public:
+    explicit RunningScope(OutputSink* output) : Outer(Common::RunningOutput) { Common::RunningOutput = output; }
+    ~RunningScope() { Common::RunningOutput = Outer; }
+
+    RunningScope(const RunningScope&) = delete;
+    RunningScope& operator=(const RunningScope&) = delete;
+
+private:
+    OutputSink* Outer;
 };
 
 class Interpreter : public ExpressionVisitor<Object>,
@@ -90,16 +123,59 @@ public:
         Token getTimeName;
         getTimeName.Lexeme = "getTime";
         Globals->define(getTimeName, Object::NewCallable(std::make_shared<GetTime>()));
+        Token dictName;
+        dictName.Lexeme = "Dict";
+        Globals->define(dictName, Object::NewCallable(std::make_shared<NewDictionary>()));
+        Token escapeHtmlName;
+        escapeHtmlName.Lexeme = "escapeHtml";
+        Globals->define(escapeHtmlName, Object::NewCallable(std::make_shared<Escaper>(escapeHtmlName.Lexeme, EscapeHtml)));
+        Token escapeAttrName;
+        escapeAttrName.Lexeme = "escapeAttr";
+        Globals->define(escapeAttrName, Object::NewCallable(std::make_shared<Escaper>(escapeAttrName.Lexeme, EscapeAttr)));
+        Token urlEncodeName;
+        urlEncodeName.Lexeme = "urlEncode";
+        Globals->define(urlEncodeName, Object::NewCallable(std::make_shared<Escaper>(urlEncodeName.Lexeme, UrlEncode)));
+#ifdef FUSCO_INSTRUMENT
+        Token memoryStatsName;
+        memoryStatsName.Lexeme = "memoryStats";
+        Globals->define(memoryStatsName, Object::NewCallable(std::make_shared<MemoryStats>()));
+#endif
 
         Environment = Globals;
+        Output = std::make_shared<FdSink>(1);
     }
 
     shared_ptr<ExecutionContext> Globals;
 
-    void resolve(Expression<Object>* expr, int depth);
+    // Where print statements and templates write to. Flushed at the end of every Interpret and Invoke.
+    shared_ptr<OutputSink> Output;
+
+    // Written before and after the value of every print statement.
+    std::string PrintPrefix = "% ";
+    std::string PrintSuffix = "\n";
+
+    // The calls being run, for the profiler.
+    ShadowStack Stack;
+
+    // The program whose code is running, which every function declared keeps alive; see ProgramScope.
+    const shared_ptr<const CompiledProgram>* RunningProgram = nullptr;
+
+#ifdef FUSCO_INSTRUMENT
+    // How often, and for how long, each line has run.
+    HeatMap Heat;
+#endif
+
+    // Every string used as a dictionary key by this interpreter.
+    StringPool Strings;
+
+    bool DictionaryKey(const struct Token& cause, const Object& key, DictKey& out, bool create);
 
     void Interpret(const std::vector<shared_ptr<Statement>>& expr);
 
+    Object Invoke(const std::string& name, const std::vector<Object>& arguments);
+
+    Object Invoke(const shared_ptr<Callable>& function, const std::vector<Object>& arguments);
+
     void ExecuteBlock(const std::vector<shared_ptr<Statement>>& statements, shared_ptr<ExecutionContext> environment);
 
     Object dummy() override { return Object::Null; }
@@ -124,6 +200,10 @@ public:
 
     void visitReturn(ReturnStatement &stmt) override;
 
+    void visitText(TextStatement &stmt) override;
+
+    void visitEmit(EmitStatement &stmt) override;
+
     Object visitBinaryExpression(BinaryExpression<Object> &expr) override;
 
     Object visitGroupingExpression(GroupingExpression<Object> &expr) override;
@@ -145,18 +225,32 @@ public:
     Object visitSetExpression(SetExpression<Object> &expr) override;
 
     Object visitThisExpression(ThisExpression<Object> &expr) override;
+
+    Object visitArrayExpression(ArrayExpression<Object> &expr) override;
+
+    Object visitIndexExpression(IndexExpression<Object> &expr) override;
+
+    Object visitIndexSetExpression(IndexSetExpression<Object> &expr) override;
 private:
+    // Heap dumps start from the environment too.
+    friend class HeapWalker;
 
     shared_ptr<ExecutionContext> Environment;
 
-    std::map<Expression<Object>*, int> Locals;
-
     void Execute(const shared_ptr<Statement>& stmt);
 
+    // Call what the callee of expr evaluated to, with the arguments of expr.
+    Object Call(const Object& callee, CallExpression<Object>& expr);
+
+    // The property of obj named by expr, which obj was evaluated from.
+    Object GetProperty(const Object& obj, GetExpression<Object>& expr);
+
     Object Evaluate(const shared_ptr<Expression<Object>>& expr);
 
     std::string Stringify(Object obj);
 
+    size_t CheckIndex(const struct Token& bracket, const Object& index, size_t length);
+
     bool Truthy(const Object& obj);
     bool IsEqual(const Object& a, const Object& b);
 
@@ -165,6 +259,31 @@ private:
 
     Object lookupVariable(Token name, Expression<Object>* expr);
 
+#ifdef FUSCO_INSTRUMENT
+    // The path of the running program, for the HeatMap; empty if it has none.
+    const std::string& RunningPath() const;
+#endif
+
+};
+
+/*
+ * Makes a program the one running in an Interpreter for as long as it is in scope, so that functions
+ *  declared meanwhile keep it alive. The program is borrowed, and must outlive the scope.
+ */
+class ProgramScope {
+public:
+    ProgramScope(Interpreter& pInterpreter, const shared_ptr<const CompiledProgram>& program)
+        : Runtime(pInterpreter), Outer(pInterpreter.RunningProgram) {
+        Runtime.RunningProgram = &program;
+    }
+    ~ProgramScope() { Runtime.RunningProgram = Outer; }
+
+    ProgramScope(const ProgramScope&) = delete;
+    ProgramScope& operator=(const ProgramScope&) = delete;
+
+private:
+    Interpreter& Runtime;
+    const shared_ptr<const CompiledProgram>* Outer;
 };
 
 class Resolver : public ExpressionVisitor<Object>,
@@ -172,9 +291,8 @@ class Resolver : public ExpressionVisitor<Object>,
                  public Common,
                  public std::enable_shared_from_this<Resolver> {
 public:
-    explicit Resolver(std::shared_ptr<Interpreter> interp) {
+    Resolver() {
         scopes = std::vector<std::map<std::string, bool>>();
-        interpreter = std::move(interp);
         currentFunction = FunctionType::F_NONE;
         currentClass = ClassType::C_NONE;
     }
@@ -191,6 +309,12 @@ public:
 
     void resolveAll(const std::vector<std::shared_ptr<Statement>>& statements);
 
+    /**
+     * Resolve the body of a function that was skipped by the pre-parse, now that it has been parsed.
+     * This must be a fresh Resolver; it takes on the scopes the function was declared in.
+     */
+    void resolveDeferred(FuncStatement &stmt, const std::vector<std::shared_ptr<Statement>>& body, const DeferredBody& deferred);
+
     void visitExpression(ExpressionStatement &stmt) override;
 
     void visitPrint(PrintStatement &stmt) override;
@@ -209,6 +333,10 @@ public:
 
     void visitReturn(ReturnStatement &stmt) override;
 
+    void visitText(TextStatement &stmt) override;
+
+    void visitEmit(EmitStatement &stmt) override;
+
     Object visitBinaryExpression(BinaryExpression<Object> &expr) override;
 
     Object visitGroupingExpression(GroupingExpression<Object> &expr) override;
@@ -231,11 +359,16 @@ public:
 
     Object visitThisExpression(ThisExpression<Object> &expr) override;
 
+    Object visitArrayExpression(ArrayExpression<Object> &expr) override;
+
+    Object visitIndexExpression(IndexExpression<Object> &expr) override;
+
+    Object visitIndexSetExpression(IndexSetExpression<Object> &expr) override;
+
 private:
     std::vector<std::map<std::string, bool>> scopes;
     FunctionType currentFunction;
     ClassType  currentClass;
-    std::shared_ptr<Interpreter> interpreter;
 
     void beginScope();
     void endScope();
@@ -244,6 +377,7 @@ private:
     void define(Token name);
 
     void resolveFunction(FuncStatement &stmt, FunctionType type);
+    void resolveBody(const std::vector<Token>& params, const std::vector<std::shared_ptr<Statement>>& body, FunctionType type);
 };
 
 class TreePrinter : public ExpressionVisitor<Object>,
@@ -274,6 +408,10 @@ public:
 
     void visitReturn(ReturnStatement &stmt) override;
 
+    void visitText(TextStatement &stmt) override;
+
+    void visitEmit(EmitStatement &stmt) override;
+
     Object visitBinaryExpression(BinaryExpression<Object> &expr) override;
 
     Object visitGroupingExpression(GroupingExpression<Object> &expr) override;
@@ -295,7 +433,17 @@ public:
     Object visitSetExpression(SetExpression<Object> &expr) override;
 
     Object visitThisExpression(ThisExpression<Object> &expr) override;
+
+    Object visitArrayExpression(ArrayExpression<Object> &expr) override;
+
+    Object visitIndexExpression(IndexExpression<Object> &expr) override;
+
+    Object visitIndexSetExpression(IndexSetExpression<Object> &expr) override;
 private:
+    size_t NestLevel = 0;
+
+    std::string nest(const std::string& input);
+
     template <class ... Args>
     std::string parenthesize(const std::string& Header, Args ... args);
 };
\ No newline at end of file
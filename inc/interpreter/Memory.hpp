@@ -0,0 +1,151 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+
+/*
+ * What the runtime holds in memory, by category; kept by instrumented builds.
+ *
+ * Every object of a counted kind carries a Counted, which adds it to its category when it is made
+ *  or copied, and takes it away when it is destroyed. Each category knows how many are alive, the
+ *  most that ever were at once, and how many were ever made, in objects and in bytes.
+ * The counts are for the whole process, whichever thread or Engine made the objects.
+ */
+enum MemoryCategory {
+    MEM_STRINGS,        // The heap buffers of string values; short strings kept inside an Object are free.
+    MEM_CONTEXTS,       // ExecutionContexts: one for every call and block run, and for every method bound.
+    MEM_FUNCTIONS,      // Functions made by declarations.
+    MEM_BOUND,          // Functions made by Function::bind, for every method looked up on an instance.
+    MEM_INSTANCES,
+    MEM_CLASSES,
+    MEM_NODES,          // Statements and expressions, with the size of their node.
+    MEM_TOKENS,
+    MEM_CATEGORIES
+};
+
+struct MemoryCounter {
+    std::atomic<uint64_t> Live { 0 };
+    std::atomic<uint64_t> Peak { 0 };
+    std::atomic<uint64_t> Total { 0 };
+    std::atomic<uint64_t> LiveBytes { 0 };
+    std::atomic<uint64_t> PeakBytes { 0 };
+    std::atomic<uint64_t> TotalBytes { 0 };
+
+    void Add(size_t bytes) {
+        Raise(Peak, Live.fetch_add(1, std::memory_order_relaxed) + 1);
+        Raise(PeakBytes, LiveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+        Total.fetch_add(1, std::memory_order_relaxed);
+        TotalBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void Remove(size_t bytes) {
+        Live.fetch_sub(1, std::memory_order_relaxed);
+        LiveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    // Take back an Add, as if the object had never been counted here.
+    void Retract(size_t bytes) {
+        Remove(bytes);
+        Total.fetch_sub(1, std::memory_order_relaxed);
+        TotalBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+private:
+    static void Raise(std::atomic<uint64_t>& peak, uint64_t value) {
+        uint64_t seen = peak.load(std::memory_order_relaxed);
+        while(seen < value && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+};
+
+extern MemoryCounter MemoryCounters[MEM_CATEGORIES];
+
+// What a category is called, in memoryStats() and the report: "strings", "contexts" and so on.
+const char* MemoryCategoryName(MemoryCategory category);
+
+// A table of every category, live, peak and total, for the report at exit.
+void WriteMemoryTable(std::ostream& out);
+
+/*
+ * Counts the object it is a member of, for as long as that lives.
+ * A copy is counted as a new object of the same size. Assigning one changes nothing, since the
+ *  object assigned to is still the same object.
+ */
+class Counted {
+public:
+    Counted(MemoryCategory pCategory, size_t pBytes) : Category(pCategory), Bytes(pBytes) {
+        MemoryCounters[Category].Add(Bytes);
+    }
+
+    Counted(const Counted& other) : Counted(other.Category, other.Bytes) {}
+    Counted& operator=(const Counted& other) { (void) other; return *this; }
+
+    ~Counted() { MemoryCounters[Category].Remove(Bytes); }
+
+    // Count the object in another category, or with another size, instead.
+    void Recount(MemoryCategory category, size_t bytes) {
+        MemoryCounters[Category].Retract(Bytes);
+        Category = category;
+        Bytes = bytes;
+        MemoryCounters[Category].Add(Bytes);
+    }
+
+    [[nodiscard]] size_t size() const { return Bytes; }
+
+private:
+    MemoryCategory Category;
+    size_t Bytes;
+};
+
+/*
+ * A string that counts its heap buffer under MEM_STRINGS, for string values.
+ * What is counted is measured when the string is made or assigned, and the same amount is taken
+ *  away when it goes; a string grown in place in between is only counted from its next assignment.
+ */
+class CountedString : public std::string {
+public:
+    CountedString() = default;
+    CountedString(const CountedString& other) : std::string(other) { Count(); }
+    CountedString(CountedString&& other) noexcept : std::string(std::move(other)) { other.Recount(); Count(); }
+    ~CountedString() { Uncount(); }
+
+    CountedString& operator=(const CountedString& other) { std::string::operator=(other); Recount(); return *this; }
+    CountedString& operator=(CountedString&& other) noexcept {
+        std::string::operator=(std::move(other));
+        other.Recount();
+        Recount();
+        return *this;
+    }
+    CountedString& operator=(const std::string& other) { std::string::operator=(other); Recount(); return *this; }
+    CountedString& operator=(std::string&& other) noexcept { std::string::operator=(std::move(other)); Recount(); return *this; }
+
+private:
+    // The bytes counted for this string; none while it fits in the string itself.
+    size_t CountedBytes = 0;
+
+    void Count() {
+        static const size_t Inline = std::string().capacity();
+        if(capacity() > Inline) {
+            CountedBytes = capacity() + 1;
+            MemoryCounters[MEM_STRINGS].Add(CountedBytes);
+        }
+    }
+
+    void Uncount() {
+        if(CountedBytes != 0)
+            MemoryCounters[MEM_STRINGS].Remove(CountedBytes);
+        CountedBytes = 0;
+    }
+
+    void Recount() {
+        Uncount();
+        Count();
+    }
+};
@@ -0,0 +1,163 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <interpreter/Interpreter.hpp>
+
+/*
+ * A native function, called with its arguments in place.
+ *
+ * A call from a script with at most InlineArguments arguments evaluates them into an array on the
+ *  stack and calls invoke directly, so no vector is made for it. Calls from the embedding program,
+ *  through Invoke, still pass a vector; call unwraps it.
+ */
+class Native : public Callable {
+public:
+    static constexpr size_t InlineArguments = 4;
+
+    explicit Native(std::string pName) : Name(std::move(pName)) {}
+    ~Native() override = default;
+
+    /**
+     * @param interpreter: The Interpreter the call is made in. Errors are reported through it.
+     * @param cause: The token to blame errors on.
+     * @param arguments: Exactly arguments() values.
+     */
+    virtual Object invoke(Interpreter& interpreter, const struct Token& cause, Object* arguments) = 0;
+
+    Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) override {
+        struct Token cause;
+        cause.Type = LI_IDENTIFIER;
+        cause.Line = 0;
+        cause.Lexeme = Name;
+        return invoke(*interpreter, cause, arguments.data());
+    }
+
+    const std::string& name() override { return Name; }
+
+    // The name the function was defined under, for errors.
+    const std::string Name;
+};
+
+/*
+ * How a C++ type is taken from an Object, and made into one.
+ * Is checks the type of an argument, From unboxes it, To boxes a result; Kind names the type for errors.
+ */
+template <typename T, typename Enable = void>
+struct NativeValue;
+
+template <typename T>
+struct NativeValue<T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>> {
+    static constexpr const char* Kind = "a number";
+    static bool Is(const Object& value) { return value.Type == Object::NumType; }
+    static T From(const Object& value) { return static_cast<T>(value.NumData); }
+    static Object To(T value) { return Object::NewNum(static_cast<double>(value)); }
+};
+
+template <>
+struct NativeValue<bool> {
+    static constexpr const char* Kind = "a boolean";
+    static bool Is(const Object& value) { return value.Type == Object::BoolType; }
+    static bool From(const Object& value) { return value.BoolData; }
+    static Object To(bool value) { return Object::NewBool(value); }
+};
+
+template <>
+struct NativeValue<std::string> {
+    static constexpr const char* Kind = "a string";
+    static bool Is(const Object& value) { return value.Type == Object::StrType; }
+    static const std::string& From(const Object& value) { return value.StrData; }
+    static Object To(std::string value) { return Object::NewStr(std::move(value)); }
+};
+
+template <>
+struct NativeValue<std::string_view> {
+    static constexpr const char* Kind = "a string";
+    static bool Is(const Object& value) { return value.Type == Object::StrType; }
+    static std::string_view From(const Object& value) { return value.StrData; }
+    static Object To(std::string_view value) { return Object::NewStr(std::string(value)); }
+};
+
+template <>
+struct NativeValue<const char*> {
+    static constexpr const char* Kind = "a string";
+    static bool Is(const Object& value) { return value.Type == Object::StrType; }
+    static const char* From(const Object& value) { return value.StrData.c_str(); }
+    static Object To(const char* value) { return Object::NewStr(value); }
+};
+
+template <>
+struct NativeValue<shared_ptr<Array>> {
+    static constexpr const char* Kind = "an array";
+    static bool Is(const Object& value) { return value.Type == Object::ArrayType; }
+    static const shared_ptr<Array>& From(const Object& value) { return value.ArrayData; }
+    static Object To(shared_ptr<Array> value) { return Object::NewArray(std::move(value)); }
+};
+
+template <>
+struct NativeValue<shared_ptr<Dictionary>> {
+    static constexpr const char* Kind = "a dictionary";
+    static bool Is(const Object& value) { return value.Type == Object::DictType; }
+    static const shared_ptr<Dictionary>& From(const Object& value) { return value.DictData; }
+    static Object To(shared_ptr<Dictionary> value) { return Object::NewDictionary(std::move(value)); }
+};
+
+// Any value at all, as it is.
+template <>
+struct NativeValue<Object> {
+    static constexpr const char* Kind = "a value";
+    static bool Is(const Object& value) { UNUSED(value); return true; }
+    static const Object& From(const Object& value) { return value; }
+    static Object To(Object value) { return value; }
+};
+
+/*
+ * A plain C++ function, bound with its signature known at compile time: the arity, the checks and
+ *  the unboxing of every argument, and the boxing of the result are all generated for it.
+ */
+template <typename R, typename... Args>
+class NativeFunction : public Native {
+public:
+    using Pointer = R (*)(Args...);
+
+    NativeFunction(std::string pName, Pointer pFunction) : Native(std::move(pName)), Function(pFunction) {}
+    ~NativeFunction() override = default;
+
+    size_t arguments() override { return sizeof...(Args); }
+
+    Object invoke(Interpreter& interpreter, const struct Token& cause, Object* arguments) override {
+        return Invoke(interpreter, cause, arguments, std::index_sequence_for<Args...>());
+    }
+
+private:
+    Pointer Function;
+
+    template <typename T>
+    using Value = NativeValue<std::remove_cv_t<std::remove_reference_t<T>>>;
+
+    template <size_t... I>
+    Object Invoke(Interpreter& interpreter, const struct Token& cause, Object* arguments, std::index_sequence<I...>) {
+        UNUSED(interpreter); UNUSED(cause); UNUSED(arguments);
+        (Check<Args>(interpreter, cause, arguments[I], I), ...);
+
+        if constexpr(std::is_void_v<R>) {
+            Function(Value<Args>::From(arguments[I])...);
+            return Object::Null;
+        } else {
+            return Value<R>::To(Function(Value<Args>::From(arguments[I])...));
+        }
+    }
+
+    template <typename T>
+    void Check(Interpreter& interpreter, const struct Token& cause, const Object& value, size_t index) {
+        if(!Value<T>::Is(value))
+            throw interpreter.Error(RuntimeError(cause, std::string("Expected ") + Value<T>::Kind + " for argument "
+                                                            + std::to_string(index + 1) + " of " + Name + "."));
+    }
+};
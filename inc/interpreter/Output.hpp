@@ -0,0 +1,96 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Where the output of a script goes.
+ * print statements, template text and template expressions all write here.
+ *
+ * Sinks may buffer as much as they like; the Interpreter flushes at the end of every
+ *  Interpret and Invoke call.
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    virtual void Write(const char* data, size_t length) = 0;
+    virtual void Flush() {}
+
+    void Write(const std::string& text) {
+        Write(text.data(), text.size());
+    }
+};
+
+/*
+ * Collects all output in memory.
+ */
+class BufferSink : public OutputSink {
+public:
+    void Write(const char* data, size_t length) override {
+        Buffer.append(data, length);
+    }
+
+    [[nodiscard]] const std::string& Contents() const { return Buffer; }
+
+    std::string Take() {
+        std::string contents = std::move(Buffer);
+        Buffer.clear();
+        return contents;
+    }
+
+private:
+    std::string Buffer;
+};
+
+/*
+ * Writes to a file descriptor, through a large buffer.
+ *
+ * Small writes are copied into the buffer, which is written out when it fills.
+ * A write too large to be worth copying is sent in the same writev call as the
+ *  buffered data in front of it.
+ */
+class FdSink : public OutputSink {
+public:
+    explicit FdSink(int pFd, size_t pCapacity = 64 * 1024);
+    ~FdSink() override;
+
+    void Write(const char* data, size_t length) override;
+    void Flush() override;
+
+private:
+    int Fd;
+    size_t Capacity;
+    std::vector<char> Buffer;
+    size_t Used;
+
+    void WriteOut(const char* data, size_t length);
+};
+
+/*
+ * Hands output to the embedding program, in buffer-sized pieces.
+ */
+class CallbackSink : public OutputSink {
+public:
+    using Callback = std::function<void(const char* data, size_t length)>;
+
+    explicit CallbackSink(Callback pCallback, size_t pCapacity = 16 * 1024)
+        : Target(std::move(pCallback)), Capacity(pCapacity) {
+        Buffer.reserve(Capacity);
+    }
+
+    ~CallbackSink() override { Flush(); }
+
+    void Write(const char* data, size_t length) override;
+    void Flush() override;
+
+private:
+    Callback Target;
+    size_t Capacity;
+    std::string Buffer;
+};
@@ -0,0 +1,112 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+
+/*
+ * A call being run: the name of the function, and the line it was called from.
+ * The name is borrowed from the function. Declarations live as long as their program, which lives as
+ *  long as anything it declared is reachable; a profile must be written before the functions it
+ *  sampled are let go.
+ */
+struct ScriptFrame {
+    const std::string* Name;
+    size_t Line;
+};
+
+/*
+ * The calls an Interpreter is inside of, outermost first.
+ *
+ * It is kept on every call, so it is as cheap as it can be: a fixed array of frames, and a depth that
+ *  a signal handler may read at any moment. Frames past Capacity are counted, but not recorded.
+ */
+class ShadowStack {
+public:
+    static constexpr size_t Capacity = 512;
+
+    void Push(const std::string& name, size_t line) {
+        size_t depth = Depth.load(std::memory_order_relaxed);
+        if(depth < Capacity)
+            Frames[depth] = { &name, line };
+        Depth.store(depth + 1, std::memory_order_release);
+    }
+
+    void Pop() {
+        Depth.store(Depth.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+    }
+
+    std::atomic<size_t> Depth { 0 };
+    ScriptFrame Frames[Capacity];
+};
+
+/*
+ * Holds a frame on a ShadowStack for as long as it is in scope, however the call ends.
+ */
+class ShadowFrame {
+public:
+    ShadowFrame(ShadowStack& pStack, const std::string& name, size_t line) : Stack(pStack) {
+        Stack.Push(name, line);
+    }
+
+    ~ShadowFrame() { Stack.Pop(); }
+
+    ShadowFrame(const ShadowFrame&) = delete;
+    ShadowFrame& operator=(const ShadowFrame&) = delete;
+
+private:
+    ShadowStack& Stack;
+};
+
+/*
+ * Samples a ShadowStack on SIGPROF, every Interval microseconds of CPU time.
+ *
+ * The signal handler only copies the frames into a buffer allocated up front; everything else is
+ *  done once sampling stops. Samples that land on other threads, such as the parallel parser's, are
+ *  ignored. Only one Profiler may run at a time, and only where setitimer is available.
+ */
+class Profiler {
+public:
+    explicit Profiler(const ShadowStack& pStack, size_t pInterval = 1000, size_t pBufferFrames = 1 << 20)
+        : Stack(pStack), Interval(pInterval), BufferFrames(pBufferFrames) {}
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // False if sampling is not supported here, or another Profiler is running.
+    bool Start();
+    void Stop();
+
+    // One line per distinct stack, outermost first, then the number of samples; what flamegraph.pl reads.
+    void WriteCollapsed(std::ostream& out) const;
+
+    // The samples and time spent in each function, itself (self) and with what it called (total).
+    void WriteTable(std::ostream& out) const;
+
+    [[nodiscard]] size_t Samples() const { return SampleCount.load(); }
+
+private:
+    const ShadowStack& Stack;
+    size_t Interval;
+
+    // Each sample is a header frame, with no name and the depth as its line, then that many frames.
+    std::unique_ptr<ScriptFrame[]> Buffer;
+    size_t BufferFrames;
+    std::atomic<size_t> Used { 0 };
+    std::atomic<size_t> SampleCount { 0 };
+    std::atomic<size_t> Dropped { 0 };
+    bool Running = false;
+
+    static void OnSignal(int signal);
+    void Record();
+
+    template <typename F>
+    void ForEachSample(F&& visit) const;
+};
@@ -9,6 +9,7 @@
 #include <map>
 #include <utility>
 #include <vector>
+#include <interpreter/Memory.hpp>
 
 #define UNUSED(x) (void)(x)
 
@@ -21,30 +22,48 @@ class FClass;
 class Instance;
 class ExecutionContext;
 class Object;
+class Array;
+class Dictionary;
+struct CompiledProgram;
 
 class Callable {
 public:
     virtual ~Callable() = 0;
     virtual size_t arguments() = 0;
     virtual Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) = 0;
+    // What the function is called, in stacks and profiles.
+    virtual const std::string& name();
 };
 
+/*
+ * A function value. The declaration is not owned: it belongs to the tree of a program, which the
+ *  function keeps alive instead, so a program lasts as long as anything it declared is reachable.
+ *  Holding the declaration raw keeps calls from writing to the tree.
+ */
 class Function : public Callable {
 public:
-    Function(shared_ptr<FuncStatement> pDeclaration, shared_ptr<ExecutionContext> pClosure, bool constr);
+    Function(FuncStatement* pDeclaration, shared_ptr<ExecutionContext> pClosure, bool constr,
+             shared_ptr<const CompiledProgram> pProgram = nullptr);
     Object call(shared_ptr<Interpreter> interpreter, std::vector<Object> params) override;
     size_t arguments() override;
+    const std::string& name() override;
     shared_ptr<Function> bind(shared_ptr<Instance> instance);
 
-    shared_ptr<FuncStatement> Declaration;
+    FuncStatement* Declaration;
     shared_ptr<ExecutionContext> Closure;
+    // The program the declaration is in, or nullptr if whoever made the tree keeps it alive.
+    shared_ptr<const CompiledProgram> Program;
     bool constructor; // Flag that shows whether this func is a constructor.
+
+#ifdef FUSCO_INSTRUMENT
+    Counted Accounted { MEM_FUNCTIONS, sizeof(Function) };
+#endif
 };
 
 class Object {
 public:
     Object() {
-        Null.Type = NullType;
+        Type = NullType;
         NumData = 0;
         BoolData = false;
     }
@@ -62,17 +81,25 @@ public:
         CallableType,
         MethodType,
         ClassType,
-        InstanceType /*,
+        InstanceType,
+        ArrayType,
+        DictType /*,
         UnknownType*/
     } ObjectTypes;
 
     ObjectTypes Type;
+#ifdef FUSCO_INSTRUMENT
+    CountedString StrData;
+#else
     std::string StrData;
+#endif
     double NumData;
     bool BoolData;
     shared_ptr<Callable> CallableData;
     shared_ptr<FClass> ClassData;
     shared_ptr<Instance> InstanceData;
+    shared_ptr<Array> ArrayData;
+    shared_ptr<Dictionary> DictData;
 
     std::string ToString();
 
@@ -83,14 +110,22 @@ public:
     static Object NewFunction(shared_ptr<Function> method);
     static Object NewClassDefinition(shared_ptr<FClass> fclass);
     static Object NewInstance(const shared_ptr<FClass>& classToInstantiate);
-    static Object Null;
+    static Object NewArray(shared_ptr<Array> array);
+    static Object NewDictionary(shared_ptr<Dictionary> dictionary);
+    static const Object Null;
 };
 
 struct Token {
     int Type;
     size_t Line;
+    // Where the token begins in the source.
+    size_t Offset = 0;
     std::string Lexeme;
     Object Value;
+
+#ifdef FUSCO_INSTRUMENT
+    Counted Accounted { MEM_TOKENS, sizeof(Token) };
+#endif
 };
 
 class RuntimeError: public std::exception {
@@ -131,9 +166,9 @@ class FClass : public Callable, public std::enable_shared_from_this<FClass> {
     ~FClass() override = default;
 
     size_t arguments() override {
-        Object constructor = findMethod(Name);
-        if (!(constructor.isNull())) {
-            return constructor.CallableData->arguments();
+        Function* constructor = findMethod(Name);
+        if (constructor != nullptr) {
+            return constructor->arguments();
         }
 
         return 0;
@@ -143,27 +178,35 @@ class FClass : public Callable, public std::enable_shared_from_this<FClass> {
         Object inst = Object::NewInstance(shared_from_this());
 
         // Call constructor, if it exists.
-        Object constructor = findMethod(Name);
-        if (!(constructor.isNull())) {
-            std::static_pointer_cast<Function>(constructor.CallableData)->bind(inst.InstanceData)->call(interpreter, params);
+        Function* constructor = findMethod(Name);
+        if (constructor != nullptr) {
+            constructor->bind(inst.InstanceData)->call(interpreter, params);
         }
 
         return inst;
     }
 
-    Object findMethod(const std::string& name) {
-        if (Methods.find(name) != Methods.end()) 
-            return Object::NewFunction(Methods.at(name));
+    const std::string& name() override { return Name; }
+
+    // Only borrowed: a lookup never touches the reference count of the method table.
+    Function* findMethod(const std::string& name) const {
+        auto it = Methods.find(name);
+        if (it != Methods.end())
+            return it->second.get();
 
         if (superclass != nullptr)
             return superclass->findMethod(name);
         
-        return Object::Null;
+        return nullptr;
     }
 
     std::string Name;
     std::shared_ptr<FClass> superclass;
     std::map<std::string, shared_ptr<Function>> Methods;
+
+#ifdef FUSCO_INSTRUMENT
+    Counted Accounted { MEM_CLASSES, sizeof(FClass) };
+#endif
 };
 
 class Instance : public std::enable_shared_from_this<Instance> {
@@ -176,17 +219,21 @@ class Instance : public std::enable_shared_from_this<Instance> {
         if (fields.find(name.Lexeme) != fields.end())
             return fields.at(name.Lexeme);
 
-        Object method = fclass->findMethod(name.Lexeme);
-        if (!method.isNull())
-            return Object::NewFunction(std::reinterpret_pointer_cast<Function>(method.CallableData)->bind(shared_from_this()));
+        Function* method = fclass->findMethod(name.Lexeme);
+        if (method != nullptr)
+            return Object::NewFunction(method->bind(shared_from_this()));
         
         throw RuntimeError(name, "No such property " + name.Lexeme);
     }
 
-    void set(Token name, Object value) {
-        fields.emplace(name.Lexeme, value);
+    void set(const Token& name, Object value) {
+        fields[name.Lexeme] = std::move(value);
     }
 
     shared_ptr<FClass> fclass;
     std::map<std::string, Object> fields;
+
+#ifdef FUSCO_INSTRUMENT
+    Counted Accounted { MEM_INSTANCES, sizeof(Instance) };
+#endif
 };
\ No newline at end of file
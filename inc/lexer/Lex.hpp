@@ -6,6 +6,7 @@
 #pragma once
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <Main.hpp>
@@ -81,27 +82,62 @@ enum Lexeme {
 
     KW_PRINT, // print
 
+    TPL_TEXT,     // Static markup in a template
+    TPL_EMIT,     // <%=
+    TPL_EMIT_END, // %> closing an expression island
+
     LI_EOF // EOF trigger, no textual representation
 };
 
-class Lexer : public Common {
+/*
+ * Anything the Parser can pull tokens from, one at a time.
+ */
+class TokenSource : public Common {
+public:
+    virtual ~TokenSource() = default;
+
+    // The next token. Once LI_EOF has been given, it is given again on every call.
+    virtual void Next(struct Token& out) = 0;
+};
+
+class Lexer : public TokenSource {
 public:
-    explicit Lexer(std::string Prompt) {
-        SrcText = std::move(Prompt);
-        Line = Overread = SrcOffset = 0;
+    /**
+     * @param Prompt: The source to lex. It is read in place, so it must outlive the Lexer.
+     * @param Template: Whether the source is a template; markup with <% code %> and <%= expression %> islands.
+     * @param FirstLine: The line the source starts on, when it is a part of a larger file.
+     */
+    explicit Lexer(std::string_view Prompt, bool Template = false, int FirstLine = 0) {
+        SrcText = Prompt;
+        Overread = SrcOffset = 0;
+        Line = FirstLine;
+        TemplateMode = InMarkup = Template;
+        InEmit = PendingEmit = Unrecognized = false;
     }
 
     void Advance();
 
+    // Lex only as far as the next token, so that nothing more than the current token is ever held.
+    void Next(struct Token& out) override {
+        Advance();
+        // The lexeme is swapped, not copied, so that neither side allocates; the next token clears it anyway.
+        out.Type = CurrentToken.Type;
+        out.Line = CurrentToken.Line;
+        out.Offset = CurrentToken.Offset;
+        out.Lexeme.swap(CurrentToken.Lexeme);
+        if(out.Value.Type != Object::NullType || CurrentToken.Value.Type != Object::NullType)
+            out.Value = CurrentToken.Value;
+    }
+
     std::vector<Token> GetTokens() {
         return TokenList;
     };
 
     void ConsumeAllInput() {
-        while(CurrentToken.Type != LI_EOF) {
+        do {
             Advance();
             TokenList.emplace_back(CurrentToken);
-        }
+        } while(CurrentToken.Type != LI_EOF);
     }
 
     std::vector<Token> ConsumeAllAndReturn() {
@@ -114,26 +150,36 @@ private:
     int Line;
     int Overread;
 
-    std::string SrcText;
+    std::string_view SrcText;
     size_t SrcOffset;
 
     std::vector<Token> TokenList;
 
+    // Template state
+    bool TemplateMode;
+    bool InMarkup;    // Outside of a code island
+    bool InEmit;      // Inside a <%= expression island
+    bool PendingEmit; // A <%= was read along with the markup before it
+
     struct Token CurrentToken;
-    std::string CurrentIdentifier;
+    bool Unrecognized; // The character just read starts no token, and was skipped
+
+    // Read one token, or skip one character that starts none.
+    void Scan();
 
     // Character reading & decoding
     void ReturnCharToStream(int Char);
     int NextChar();
     int FindChar();
-    int FindDigitFromPos(std::string String, char Char);
 
     // Bulk reading
-    double ReadNumber(int Char);
+    int ReadNumber(int Char);
     int ReadCharLiteral();
-    std::string ReadIdentifier(int Char, int Limit);
-    std::string ReadStringLiteral();
-    int ReadKeyword(std::string Str);
+    std::string_view ReadIdentifier(int Char, int Limit);
+    void ReadStringLiteral(std::string& Buffer);
+    int ReadKeyword(std::string_view Str);
+    bool ReadMarkup();
+    void SetNumber(int Number);
 
     // Error reporting
     void VerifyToken(int Type, std::string TokenExpected);
@@ -0,0 +1,80 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <lexer/Lex.hpp>
+
+/*
+ * Lexes a large script on several threads at once, and hands the tokens over in order, exactly as
+ *  a single Lexer over the whole script would.
+ *
+ * A quick pre-scan splits the script into chunks just after a ';', '{' or '}' that is outside of any
+ *  string or character literal. None of those tokens reads ahead, so a Lexer started at a split,
+ *  on the line the split is on, is in the same state as one that lexed everything before it.
+ *
+ * Workers lex chunks into token arrays while the Parser reads from the front. Only a few chunks past
+ *  the one being read are lexed ahead of time, so memory use stays bounded however large the script is.
+ * A chunk with a lexing error is lexed again when it is reached, so that its errors are reported
+ *  in order, exactly once.
+ *
+ * Templates are never split; their markup would need a different pre-scan.
+ */
+class ParallelLexer : public TokenSource {
+public:
+    // Scripts smaller than this are not worth splitting.
+    static constexpr size_t MinimumSize = 1024 * 1024;
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    /**
+     * @param Source: The script to lex. It is read in place, so it must outlive the lexer.
+     * @param Threads: How many workers to lex with; by default, one per hardware thread.
+     */
+    explicit ParallelLexer(std::string_view Source, size_t Threads = 0);
+    ~ParallelLexer() override;
+
+    ParallelLexer(const ParallelLexer&) = delete;
+    ParallelLexer& operator=(const ParallelLexer&) = delete;
+
+    void Next(struct Token& out) override;
+
+    [[nodiscard]] size_t ChunkCount() const { return Chunks.size(); }
+
+private:
+    struct Chunk {
+        size_t Begin;
+        size_t End;
+        int Line;
+
+        std::vector<struct Token> Tokens;
+        bool Lexed = false;
+        bool Failed = false;
+    };
+
+    std::string_view SrcText;
+    std::deque<Chunk> Chunks;
+
+    // The chunk being read, and the next token in it.
+    size_t Reading = 0;
+    size_t Position = 0;
+
+    // The next chunk a worker will take.
+    size_t Claimed = 0;
+    size_t Window;
+    bool Stopping = false;
+
+    std::mutex Lock;
+    std::condition_variable Progress;
+    std::vector<std::thread> Workers;
+
+    void Split();
+    void Work();
+    void LexChunk(Chunk& chunk, bool report);
+};
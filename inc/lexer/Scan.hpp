@@ -0,0 +1,35 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstddef>
+
+/*
+ * The loops the Lexer spends most of its time in, run over many bytes at once.
+ *
+ * Every kernel reads text[from] up to text[length - 1], and returns the offset of the first byte
+ *  that ends the run, or length if none does. Those that may pass newlines add them to lines.
+ *
+ * There is a plain version of each, and on x86-64 an SSE2 and an AVX2 version. The best the CPU
+ *  can run is chosen the first time they are needed; set FUSCO_SCAN to scalar or sse2 to use a plainer one.
+ */
+struct ScanKernels {
+    const char* Name;
+
+    // Skip spaces, tabs, carriage returns and newlines.
+    size_t (*SkipWhitespace)(const char* text, size_t from, size_t length, int& lines);
+
+    // Skip letters, digits and underscores.
+    size_t (*SkipIdentifier)(const char* text, size_t from, size_t length);
+
+    // Find the next quote or backslash in a string literal.
+    size_t (*FindStringEnd)(const char* text, size_t from, size_t length, int& lines);
+
+    // Count the newlines from text[from] to text[length - 1].
+    int (*CountLines)(const char* text, size_t from, size_t length);
+
+    // The kernels in use.
+    static const ScanKernels& Active();
+};
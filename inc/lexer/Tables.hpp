@@ -0,0 +1,175 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <lexer/Lex.hpp>
+
+/*
+ * The tables the Lexer dispatches on, all built at compile time.
+ *
+ * Every character falls into one class, which picks how the token it starts is read.
+ * Operators are a small DFA: the first character picks an operator, and the next character may move
+ *  it on to a two-character operator. None of them is longer.
+ * Keywords are found with a perfect hash, so a name is compared with at most one keyword.
+ */
+namespace LexTables {
+
+    enum CharClass : uint8_t {
+        CC_OTHER,      // Starts no token
+        CC_SPACE,      // ' ', '\t', '\r', '\n'
+        CC_DIGIT,      // 0-9
+        CC_NAME,       // Letters and _
+        CC_OPERATOR,   // Punctuation and operators
+        CC_QUOTE,      // " starts a string
+        CC_APOSTROPHE, // ' starts a character
+        CC_PERCENT,    // % may end a template island
+    };
+
+    struct Operator {
+        std::string_view Spelling;
+        int Type;
+        std::string_view Lexeme;
+        // Whether some longer operator starts with this one, so the character after it must be read.
+        bool Extends;
+    };
+
+    // Entry 0 is no operator at all. The single character lexemes that are numbers are kept as they always were.
+    constexpr std::array<Operator, 24> Operators = []() {
+        std::array<Operator, 24> operators = {{
+            { "",   LI_EOF,          "",    false },
+            { ".",  LI_PERIOD,       "46",  false },
+            { "+",  AR_PLUS,         "+",   false },
+            { "++", PPMM_PLUS,       "++",  false },
+            { "-",  AR_MINUS,        "-",   false },
+            { "--", PPMM_MINUS,      "--",  false },
+            { "*",  AR_ASTERISK,     "42",  false },
+            { "/",  AR_RSLASH,       "47",  false },
+            { ",",  LI_COMMA,        "44",  false },
+            { "=",  LI_EQUAL,        "=",   false },
+            { "=?", CMP_EQUAL,       "=?",  false },
+            { "=>", CMP_GREAT_EQUAL, "=>",  false },
+            { "!",  BOOL_EXCLAIM,    "!",   false },
+            { "!=", CMP_INEQ,        "!=",  false },
+            { "<",  CMP_LESS,        "<",   false },
+            { "<=", CMP_LESS_EQUAL,  "<=",  false },
+            { ">",  CMP_GREATER,     "62",  false },
+            { ";",  LI_SEMICOLON,    "59",  false },
+            { "(",  LI_LPAREN,       "40",  false },
+            { ")",  LI_RPAREN,       "41",  false },
+            { "{",  LI_LBRACE,       "123", false },
+            { "}",  LI_RBRACE,       "125", false },
+            { "[",  LI_LBRAS,        "91",  false },
+            { "]",  LI_RBRAS,        "93",  false },
+        }};
+
+        for(Operator& longer : operators)
+            if(longer.Spelling.size() == 2)
+                for(Operator& shorter : operators)
+                    if(shorter.Spelling.size() == 1 && shorter.Spelling[0] == longer.Spelling[0])
+                        shorter.Extends = true;
+        return operators;
+    }();
+
+    // The operator each character starts, or 0.
+    constexpr std::array<uint8_t, 256> Starts = []() {
+        std::array<uint8_t, 256> starts {};
+        for(uint8_t i = 1; i < Operators.size(); i++)
+            if(Operators[i].Spelling.size() == 1)
+                starts[(uint8_t) Operators[i].Spelling[0]] = i;
+        return starts;
+    }();
+
+    // The operator that the next character turns each operator into, or 0 if it ends the operator.
+    constexpr std::array<std::array<uint8_t, 256>, Operators.size()> Transitions = []() {
+        std::array<std::array<uint8_t, 256>, Operators.size()> transitions {};
+        for(uint8_t i = 1; i < Operators.size(); i++)
+            if(Operators[i].Spelling.size() == 2)
+                transitions[Starts[(uint8_t) Operators[i].Spelling[0]]][(uint8_t) Operators[i].Spelling[1]] = i;
+        return transitions;
+    }();
+
+    constexpr std::array<uint8_t, 256> Classes = []() {
+        std::array<uint8_t, 256> classes {};
+        for(int c = 'a'; c <= 'z'; c++) classes[c] = CC_NAME;
+        for(int c = 'A'; c <= 'Z'; c++) classes[c] = CC_NAME;
+        for(int c = '0'; c <= '9'; c++) classes[c] = CC_DIGIT;
+        for(int c = 0; c < 256; c++) if(Starts[c] != 0) classes[c] = CC_OPERATOR;
+        classes['_'] = CC_NAME;
+        classes[' '] = classes['\t'] = classes['\r'] = classes['\n'] = CC_SPACE;
+        classes['"'] = CC_QUOTE;
+        classes['\''] = CC_APOSTROPHE;
+        classes['%'] = CC_PERCENT;
+        return classes;
+    }();
+
+    constexpr uint8_t ClassOf(int Char) {
+        return Classes[(uint8_t) Char];
+    }
+
+    /* * * * * * * * * * * * * * * * * * * * *
+     * * * *      K E Y W O R D S      * * * *
+     * * * * * * * * * * * * * * * * * * * * */
+
+    struct Keyword {
+        std::string_view Name;
+        int Type;
+    };
+
+    // null is not among them; it is read as a name.
+    constexpr std::array<Keyword, 16> Keywords = {{
+        { "and", KW_AND }, { "class", KW_CLASS }, { "else", KW_ELSE }, { "extends", KW_EXTENDS },
+        { "for", KW_FOR }, { "false", KW_FALSE }, { "func", KW_FUNC }, { "if", KW_IF },
+        { "or", KW_OR }, { "print", KW_PRINT }, { "return", KW_RETURN }, { "super", KW_SUPER },
+        { "this", KW_THIS }, { "true", KW_TRUE }, { "var", KW_VAR }, { "while", KW_WHILE },
+    }};
+
+    constexpr size_t KeywordBits = 5;
+    constexpr size_t ShortestKeyword = 2;
+    constexpr size_t LongestKeyword = 7;
+
+    // Mixes the first two characters, the last and the length, and keeps the top bits of the product.
+    constexpr uint32_t KeywordHash(std::string_view Name, uint32_t Seed) {
+        uint32_t key = (uint32_t) (uint8_t) Name[0] | (uint32_t) (uint8_t) Name[1] << 8
+                     | (uint32_t) (uint8_t) Name[Name.size() - 1] << 16 | (uint32_t) Name.size() << 24;
+        return (key * Seed) >> (32 - KeywordBits);
+    }
+
+    // The first odd seed that gives every keyword a slot of its own.
+    constexpr uint32_t KeywordSeed = []() {
+        for(uint32_t seed = 1; seed < 1u << 20; seed += 2) {
+            bool taken[1 << KeywordBits] {};
+            bool collides = false;
+            for(const Keyword& keyword : Keywords) {
+                uint32_t slot = KeywordHash(keyword.Name, seed);
+                collides = collides || taken[slot];
+                taken[slot] = true;
+            }
+            if(!collides)
+                return seed;
+        }
+        return 0u;
+    }();
+    static_assert(KeywordSeed != 0, "No seed hashes every keyword to a slot of its own");
+
+    constexpr std::array<Keyword, 1 << KeywordBits> KeywordSlots = []() {
+        std::array<Keyword, 1 << KeywordBits> slots {};
+        for(const Keyword& keyword : Keywords)
+            slots[KeywordHash(keyword.Name, KeywordSeed)] = keyword;
+        return slots;
+    }();
+
+    // The keyword the name is, or 0 if it is not one.
+    constexpr int FindKeyword(std::string_view Name) {
+        if(Name.size() < ShortestKeyword || Name.size() > LongestKeyword)
+            return 0;
+        const Keyword& slot = KeywordSlots[KeywordHash(Name, KeywordSeed)];
+        return slot.Name == Name ? slot.Type : 0;
+    }
+
+    static_assert(FindKeyword("extends") == KW_EXTENDS && FindKeyword("null") == 0 && FindKeyword("x") == 0);
+}
@@ -0,0 +1,136 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Program.hpp>
+#include <Snapshot.hpp>
+
+class ConnectionPool;
+
+/*
+ * A latency histogram, with log-linear buckets.
+ * Every power of two is split into 16 buckets, so any recorded value is accurate to about 6%.
+ * Recording is a single relaxed atomic increment, so a histogram may be read while it is written.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SubBuckets = 16;
+    static constexpr size_t Buckets = 64 * SubBuckets;
+
+    void Record(uint64_t micros);
+    void Merge(const LatencyHistogram& other);
+
+    [[nodiscard]] uint64_t Count() const;
+    [[nodiscard]] uint64_t Percentile(double percent) const;
+    [[nodiscard]] uint64_t Max() const { return Maximum.load(std::memory_order_relaxed); }
+
+    std::string Summary() const;
+
+private:
+    std::atomic<uint64_t> Counts[Buckets] {};
+    std::atomic<uint64_t> Maximum { 0 };
+
+    static size_t IndexOf(uint64_t value);
+    static uint64_t ValueOf(size_t index);
+};
+
+struct ServerOptions {
+    std::string Root = ".";       // Every .html file under the root is a route.
+    std::string Prelude;          // A script to run in every worker before the first request.
+    uint16_t Port = 8080;
+    size_t Threads = std::thread::hardware_concurrency();
+    size_t Prefork = 0;           // If set, serve from this many forked processes instead of threads.
+};
+
+/*
+ * What one worker has served. Only ever updated with relaxed atomics, so that it can live in memory
+ *  shared between processes.
+ */
+struct WorkerStats {
+    LatencyHistogram Latency;
+    std::atomic<uint64_t> Requests { 0 };
+    std::atomic<uint64_t> Bytes { 0 };
+};
+
+/*
+ * A multi-threaded HTTP server that renders templates.
+ *
+ * The server only listens on the loopback interface. Every route is compiled once, into a ProgramCache
+ *  shared by all workers. Every worker thread owns an Engine, restored from a snapshot taken after running
+ *  the prelude once, before the first request is accepted. A request then costs only the call to the render function, with the
+ *  output streamed back to the client in chunks as the sink fills.
+ *
+ * Reloads are manual: a request for a route already compiled never touches the disk, so an edited
+ *  template is served as it was until SIGHUP. That empties the cache; each route is then recompiled from
+ *  disk by the first request that wants it, while renders already in flight finish on the program they
+ *  started with. The old program goes once the last of those has.
+ *
+ * A worker serves one request at a time, from whichever connection has one. Between requests, a
+ *  keep-alive connection waits in a pool that every worker of the process shares, so that any number
+ *  of connections are served by however many workers there are.
+ *
+ * With Prefork set, the workers are processes instead. The parent compiles the routes and runs the
+ *  prelude, and compiles the bodies it only pre-parsed, then forks; every child serves from the same
+ *  Engine, inherited copy-on-write. The trees live in arenas that are never written at runtime, so
+ *  their pages stay shared between every child; test/SharedPages.cpp checks that they do.
+ *  A child that dies is replaced.
+ */
+class RenderServer {
+public:
+    explicit RenderServer(ServerOptions pOptions) : Options(std::move(pOptions)) {}
+
+    /**
+     * Compile the routes, then serve until Stop is called, or SIGINT or SIGTERM arrives.
+     * @return the process exit code.
+     */
+    int Serve();
+
+    void Stop() { Stopping = true; }
+
+    // The route table, URL path to template file.
+    std::map<std::string, std::string> Routes;
+
+    ProgramCache Programs;
+
+private:
+    struct Worker;
+
+    ServerOptions Options;
+    int Listener = -1;
+    std::atomic<bool> Stopping { false };
+    std::atomic<bool> Reloading { false };
+
+    bool FindRoutes();
+    bool Listen();
+    int ServeThreads(const shared_ptr<const Snapshot>& snapshot, const std::string& prelude);
+    int ServeForks(Worker& prototype);
+    void Work(Worker& worker, ConnectionPool& connections);
+    bool ServeConnection(Worker& worker, int client);
+    void Report(const std::vector<const WorkerStats*>& stats, double seconds);
+};
+
+struct LoadTestOptions {
+    std::string Host = "127.0.0.1";
+    uint16_t Port = 8080;
+    std::string Path = "/";
+    size_t Connections = 8;
+    double Seconds = 10;
+    double Timeout = 2;           // How long a request may wait for all of its response, in seconds.
+};
+
+/*
+ * Hammer a server with keep-alive GET requests from many connections, and report throughput and latency.
+ * A request that gets no whole response within the timeout is counted as timed out, not as an error, and
+ *  a connection that never got a response at all is reported as stalled.
+ * @return the process exit code.
+ */
+int RunLoadTest(const LoadTestOptions& options);
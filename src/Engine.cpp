@@ -0,0 +1,145 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Engine.hpp>
+#include <Source.hpp>
+#include <Trace.hpp>
+#include <algorithm>
+#include <utility>
+
+/*
+ * Compile a file, letting go of its text before the program runs.
+ * @return false if the file could not be read.
+ */
+static bool CompileFile(const std::string& path, bool isTemplate, shared_ptr<const CompiledProgram>& program) {
+    SourceText source;
+    if(!source.Load(path))
+        return false;
+
+    program = CompileProgram(source.View(), path, isTemplate);
+    return true;
+}
+
+Engine::Engine() {
+    Context = std::make_shared<ExecutionContext>();
+    Runtime = std::make_shared<Interpreter>(Context);
+}
+
+Engine::Engine(shared_ptr<OutputSink> output) : Engine() {
+    SetOutput(std::move(output));
+}
+
+Engine::~Engine() {
+    Context->clear();
+}
+
+void Engine::SetOutput(shared_ptr<OutputSink> output) {
+    Runtime->Output->Flush();
+    Runtime->Output = std::move(output);
+}
+
+bool Engine::Run(std::string_view source) {
+    return Execute(CompileProgram(source, "", false));
+}
+
+bool Engine::RunFile(const std::string& path) {
+    shared_ptr<const CompiledProgram> program;
+    if(!CompileFile(path, false, program)) {
+        *Common::Reports << "Unable to read " << path << std::endl;
+        ErrorState = true;
+        return false;
+    }
+
+    return Execute(program);
+}
+
+bool Engine::Execute(const shared_ptr<const CompiledProgram>& program) {
+    ErrorState = program == nullptr;
+    if (ErrorState) return false;
+
+    if (DumpTree) {
+        TraceSpan span("print tree");
+        std::shared_ptr<TreePrinter> printer = std::make_shared<TreePrinter>();
+        printer->print(program->Statements);
+    }
+
+    Load(program);
+    TraceSpan span("interpret");
+    ProgramScope running(*Runtime, program);
+    Runtime->Interpret(program->Statements);
+    return true;
+}
+
+bool Engine::Render(std::string_view source) {
+    return Render(CompileProgram(source, "", true));
+}
+
+bool Engine::RenderFile(const std::string& path) {
+    shared_ptr<const CompiledProgram> program;
+    if(!CompileFile(path, true, program)) {
+        *Common::Reports << "Unable to read " << path << std::endl;
+        ErrorState = true;
+        return false;
+    }
+
+    return Render(program);
+}
+
+bool Engine::Render(const shared_ptr<const CompiledProgram>& program) {
+    ErrorState = program == nullptr || !program->Template;
+    if (ErrorState) return false;
+
+    Load(program);
+
+    shared_ptr<Function> render = std::make_shared<Function>(program->RenderFunction(), Runtime->Globals, false, program);
+    TraceSpan span("render");
+    Runtime->ErrorState = false;
+    Runtime->Invoke(render, {});
+    return !Runtime->ErrorState;
+}
+
+void Engine::Load(const shared_ptr<const CompiledProgram>& program) {
+    Loaded.erase(std::remove_if(Loaded.begin(), Loaded.end(), [](const auto& loaded) { return loaded.expired(); }),
+                 Loaded.end());
+
+    for (const auto& loaded : Loaded)
+        if (loaded.lock() == program)
+            return;
+
+    Loaded.emplace_back(program);
+}
+
+void Engine::CompleteAll() {
+    for (const auto& loaded : Loaded)
+        if (shared_ptr<const CompiledProgram> program = loaded.lock())
+            CompleteProgram(*program);
+}
+
+shared_ptr<const Snapshot> Engine::TakeSnapshot() {
+    std::vector<shared_ptr<const CompiledProgram>> programs;
+    for (const auto& loaded : Loaded)
+        if (shared_ptr<const CompiledProgram> program = loaded.lock())
+            programs.emplace_back(std::move(program));
+
+    std::string error;
+    shared_ptr<const Snapshot> snapshot = CaptureSnapshot(programs, Runtime, error);
+    if(snapshot == nullptr)
+        *Common::Reports << "Unable to take snapshot: " << error << std::endl;
+
+    return snapshot;
+}
+
+bool Engine::Restore(const shared_ptr<const Snapshot>& snapshot) {
+    ErrorState = !RestoreSnapshot(*snapshot, Runtime);
+    if(ErrorState)
+        return false;
+
+    Loaded.assign(snapshot->Programs.begin(), snapshot->Programs.end());
+    return true;
+}
+
+Object Engine::Call(const std::string& name, const std::vector<Object>& arguments) {
+    return Runtime->Invoke(name, arguments);
+}
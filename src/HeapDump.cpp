@@ -0,0 +1,427 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <HeapDump.hpp>
+#include <interpreter/Array.hpp>
+#include <interpreter/Dictionary.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+static const char HeapHeader[] = "fusco heap 1";
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *        C A P T U R E      * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+// The heap buffer of a string, if it has outgrown the string itself.
+static uint64_t StringBytes(const std::string& text) {
+    static const size_t Inline = std::string().capacity();
+    return text.capacity() > Inline ? text.capacity() + 1 : 0;
+}
+
+// A std::map of names: a node of three pointers and a colour for every entry, then the entry, then its name.
+template <typename V>
+static uint64_t MapBytes(const std::map<std::string, V>& map) {
+    uint64_t bytes = map.size() * (4 * sizeof(void*) + sizeof(std::pair<const std::string, V>));
+    for(const auto& entry : map)
+        bytes += StringBytes(entry.first);
+    return bytes;
+}
+
+class HeapWalker {
+public:
+    explicit HeapWalker(HeapDump& pDump) : Dump(pDump) {
+        Dump.Objects.push_back({ "root", "", 0, 0, 0 });
+    }
+
+    void Walk(const Interpreter& interpreter) {
+        Edge(0, Reference(CONTEXT, interpreter.Globals.get(), ""), "globals");
+        if(interpreter.Environment != interpreter.Globals)
+            Edge(0, Reference(CONTEXT, interpreter.Environment.get(), ""), "environment");
+
+        // Objects found while visiting one are appended to the queue, and visited in turn.
+        for(size_t i = 0; i < Queue.size(); i++)
+            Visit((uint32_t) i + 1, Queue[i]);
+    }
+
+private:
+    enum Kind { CONTEXT, FUNCTION, BOUND, CLASS, INSTANCE, ARRAY, DICTIONARY, NATIVE };
+
+    struct Pending {
+        Kind Type;
+        void* Pointer;
+    };
+
+    HeapDump& Dump;
+    std::unordered_map<const void*, uint32_t> Ids;
+    std::vector<Pending> Queue;
+
+    uint32_t Reference(Kind kind, void* pointer, const std::string& name) {
+        auto it = Ids.find(pointer);
+        if(it != Ids.end())
+            return it->second;
+
+        static const char* const Kinds[] = { "context", "function", "bound method", "class", "instance", "array", "dictionary", "native" };
+
+        uint32_t id = (uint32_t) Dump.Objects.size();
+        Ids.emplace(pointer, id);
+        Queue.push_back({ kind, pointer });
+        Dump.Objects.push_back({ Kinds[kind], name, 0, 0, 0 });
+        return id;
+    }
+
+    void Edge(uint32_t from, uint32_t to, std::string label) {
+        Dump.Edges.push_back({ from, to, std::move(label) });
+    }
+
+    uint32_t ReferenceCallable(Callable* callable) {
+        if(auto function = dynamic_cast<Function*>(callable)) {
+            // A method bound to an instance is the only function whose closure holds nothing but this.
+            const auto& closure = function->Closure->ObjectMap;
+            bool bound = closure.size() == 1 && closure.begin()->first == "this";
+            return Reference(bound ? BOUND : FUNCTION, function, function->name());
+        }
+        if(auto fclass = dynamic_cast<FClass*>(callable))
+            return Reference(CLASS, fclass, fclass->Name);
+
+        return Reference(NATIVE, callable, callable->name());
+    }
+
+    // The bytes a value holds itself; anything it refers to is an edge.
+    uint64_t Value(uint32_t from, const Object& value, const std::string& label) {
+        switch(value.Type) {
+            case Object::StrType: return StringBytes(value.StrData);
+            case Object::CallableType:
+            case Object::MethodType: Edge(from, ReferenceCallable(value.CallableData.get()), label); break;
+            case Object::ClassType: Edge(from, Reference(CLASS, value.ClassData.get(), value.ClassData->Name), label); break;
+            case Object::InstanceType:
+                Edge(from, Reference(INSTANCE, value.InstanceData.get(), value.InstanceData->fclass->Name), label);
+                break;
+            case Object::ArrayType: Edge(from, Reference(ARRAY, value.ArrayData.get(), ""), label); break;
+            case Object::DictType: Edge(from, Reference(DICTIONARY, value.DictData.get(), ""), label); break;
+            default: break;
+        }
+        return 0;
+    }
+
+    uint64_t Fields(uint32_t from, const std::map<std::string, Object>& fields) {
+        uint64_t bytes = MapBytes(fields);
+        for(const auto& field : fields)
+            bytes += Value(from, field.second, field.first);
+        return bytes;
+    }
+
+    void Visit(uint32_t id, const Pending& pending) {
+        uint64_t size = 0;
+
+        switch(pending.Type) {
+            case CONTEXT: {
+                auto context = static_cast<ExecutionContext*>(pending.Pointer);
+                size = sizeof(ExecutionContext) + Fields(id, context->ObjectMap);
+                if(context->Enclosing != nullptr)
+                    Edge(id, Reference(CONTEXT, context->Enclosing.get(), ""), "(enclosing)");
+                break;
+            }
+            case FUNCTION:
+            case BOUND: {
+                auto function = static_cast<Function*>(pending.Pointer);
+                size = sizeof(Function);
+                Edge(id, Reference(CONTEXT, function->Closure.get(), ""), "(closure)");
+                break;
+            }
+            case CLASS: {
+                auto fclass = static_cast<FClass*>(pending.Pointer);
+                size = sizeof(FClass) + StringBytes(fclass->Name) + MapBytes(fclass->Methods);
+                if(fclass->superclass != nullptr)
+                    Edge(id, Reference(CLASS, fclass->superclass.get(), fclass->superclass->Name), "(superclass)");
+                for(const auto& method : fclass->Methods)
+                    Edge(id, Reference(FUNCTION, method.second.get(), method.first), method.first);
+                break;
+            }
+            case INSTANCE: {
+                auto instance = static_cast<Instance*>(pending.Pointer);
+                size = sizeof(Instance) + Fields(id, instance->fields);
+                Edge(id, Reference(CLASS, instance->fclass.get(), instance->fclass->Name), "(class)");
+                break;
+            }
+            case ARRAY: {
+                auto array = static_cast<Array*>(pending.Pointer);
+                size = sizeof(Array) + array->length() * (array->isPacked() ? sizeof(double) : sizeof(Object));
+                if(!array->isPacked())
+                    for(size_t i = 0; i < array->length(); i++)
+                        size += Value(id, array->at(i), "[" + std::to_string(i) + "]");
+                break;
+            }
+            case DICTIONARY: {
+                auto dictionary = static_cast<Dictionary*>(pending.Pointer);
+                std::vector<Object> keys = dictionary->keys();
+                std::vector<Object> values = dictionary->values();
+                // An entry, its slot and its control byte. Key strings are interned, and shared.
+                size = sizeof(Dictionary) + keys.size() * (sizeof(DictKey) + sizeof(Object) + sizeof(uint32_t) + 2);
+                for(size_t i = 0; i < keys.size(); i++)
+                    size += Value(id, values[i], "[" + keys[i].ToString() + "]");
+                break;
+            }
+            case NATIVE: {
+                auto native = static_cast<Callable*>(pending.Pointer);
+                size = sizeof(void*);
+                if(auto method = dynamic_cast<ArrayMethod*>(native))
+                    Edge(id, Reference(ARRAY, method->Target.get(), ""), "(target)");
+                else if(auto method = dynamic_cast<DictionaryMethod*>(native))
+                    Edge(id, Reference(DICTIONARY, method->Target.get(), ""), "(target)");
+                break;
+            }
+        }
+
+        Dump.Objects[id].Size = size;
+    }
+};
+
+/*
+ * Find the dominator of every object, as Cooper, Harvey and Kennedy do, then add up what each retains.
+ * Every object was found from the root, so every one is reached.
+ */
+static void Dominate(HeapDump& dump) {
+    size_t count = dump.Objects.size();
+    std::vector<std::vector<uint32_t>> successors(count);
+    std::vector<std::vector<uint32_t>> predecessors(count);
+    for(const HeapEdge& edge : dump.Edges) {
+        successors[edge.From].push_back(edge.To);
+        predecessors[edge.To].push_back(edge.From);
+    }
+
+    // Reverse postorder, from the root.
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> position(count, UINT32_MAX);
+    std::vector<bool> seen(count, false);
+    std::vector<std::pair<uint32_t, size_t>> stack = { { 0, 0 } };
+    seen[0] = true;
+    while(!stack.empty()) {
+        auto& [object, next] = stack.back();
+        if(next < successors[object].size()) {
+            uint32_t successor = successors[object][next++];
+            if(!seen[successor]) {
+                seen[successor] = true;
+                stack.emplace_back(successor, 0);
+            }
+        } else {
+            order.push_back(object);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    for(size_t i = 0; i < order.size(); i++)
+        position[order[i]] = (uint32_t) i;
+
+    std::vector<uint32_t> dominator(count, UINT32_MAX);
+    dominator[0] = 0;
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while(a != b) {
+            while(position[a] > position[b]) a = dominator[a];
+            while(position[b] > position[a]) b = dominator[b];
+        }
+        return a;
+    };
+
+    for(bool changed = true; changed;) {
+        changed = false;
+        for(size_t i = 1; i < order.size(); i++) {
+            uint32_t object = order[i];
+            uint32_t found = UINT32_MAX;
+            for(uint32_t predecessor : predecessors[object]) {
+                if(dominator[predecessor] == UINT32_MAX)
+                    continue;
+                found = found == UINT32_MAX ? predecessor : intersect(predecessor, found);
+            }
+            if(found != dominator[object]) {
+                dominator[object] = found;
+                changed = true;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        dump.Objects[i].Dominator = dominator[i];
+        dump.Objects[i].Retained = dump.Objects[i].Size;
+    }
+    for(size_t i = order.size() - 1; i > 0; i--)
+        dump.Objects[dominator[order[i]]].Retained += dump.Objects[order[i]].Retained;
+}
+
+HeapDump CaptureHeap(const Interpreter& interpreter) {
+    HeapDump dump;
+    HeapWalker walker(dump);
+    walker.Walk(interpreter);
+    Dominate(dump);
+    return dump;
+}
+
+std::map<std::string, HeapGroup> HeapDump::Groups() const {
+    std::map<std::string, HeapGroup> groups;
+    std::vector<HeapGroup*> groupOf(Objects.size(), nullptr);
+    std::vector<std::vector<uint32_t>> dominated(Objects.size());
+
+    for(size_t i = 1; i < Objects.size(); i++) {
+        const HeapObject& object = Objects[i];
+        HeapGroup& group = groups[object.Kind == "instance" ? object.Name : "(" + object.Kind + ")"];
+        group.Count++;
+        group.Size += object.Size;
+        groupOf[i] = &group;
+        dominated[object.Dominator].push_back((uint32_t) i);
+    }
+
+    // Down the dominator tree: an object only adds what it retains if nothing of its group dominates it.
+    std::map<const HeapGroup*, size_t> above;
+    std::vector<std::pair<uint32_t, size_t>> stack = { { 0, 0 } };
+    while(!stack.empty()) {
+        auto& [object, next] = stack.back();
+        if(next < dominated[object].size()) {
+            uint32_t child = dominated[object][next++];
+            if(above[groupOf[child]]++ == 0)
+                groupOf[child]->Retained += Objects[child].Retained;
+            stack.emplace_back(child, 0);
+        } else {
+            if(object != 0)
+                above[groupOf[object]]--;
+            stack.pop_back();
+        }
+    }
+
+    return groups;
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *          F I L E S        * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+static std::string Escape(const std::string& text) {
+    std::string escaped;
+    for(char c : text) {
+        switch(c) {
+            case '\\': escaped.append("\\\\"); break;
+            case '\t': escaped.append("\\t"); break;
+            case '\n': escaped.append("\\n"); break;
+            case '\r': escaped.append("\\r"); break;
+            default: escaped.push_back(c);
+        }
+    }
+    return escaped;
+}
+
+static std::string Unescape(const std::string& text) {
+    std::string plain;
+    for(size_t i = 0; i < text.size(); i++) {
+        if(text[i] != '\\' || i + 1 == text.size()) {
+            plain.push_back(text[i]);
+            continue;
+        }
+        switch(text[++i]) {
+            case 't': plain.push_back('\t'); break;
+            case 'n': plain.push_back('\n'); break;
+            case 'r': plain.push_back('\r'); break;
+            default: plain.push_back(text[i]);
+        }
+    }
+    return plain;
+}
+
+void WriteHeapDump(const HeapDump& dump, std::ostream& out) {
+    out << HeapHeader << "\n";
+    for(const HeapObject& object : dump.Objects)
+        out << "object\t" << object.Kind << "\t" << Escape(object.Name) << "\t" << object.Size << "\t"
+            << object.Retained << "\t" << object.Dominator << "\n";
+    for(const HeapEdge& edge : dump.Edges)
+        out << "edge\t" << edge.From << "\t" << edge.To << "\t" << Escape(edge.Label) << "\n";
+}
+
+bool ReadHeapDump(std::istream& in, HeapDump& dump, std::string& error) {
+    std::string line;
+    if(!std::getline(in, line) || line != HeapHeader) {
+        error = "not a heap dump";
+        return false;
+    }
+
+    for(size_t number = 2; std::getline(in, line); number++) {
+        std::vector<std::string> fields;
+        for(size_t start = 0;;) {
+            size_t tab = line.find('\t', start);
+            fields.emplace_back(line.substr(start, tab - start));
+            if(tab == std::string::npos)
+                break;
+            start = tab + 1;
+        }
+
+        try {
+            if(fields[0] == "object" && fields.size() == 6) {
+                dump.Objects.push_back({ fields[1], Unescape(fields[2]), std::stoull(fields[3]), std::stoull(fields[4]),
+                                         (uint32_t) std::stoul(fields[5]) });
+                continue;
+            }
+            if(fields[0] == "edge" && fields.size() == 4) {
+                dump.Edges.push_back({ (uint32_t) std::stoul(fields[1]), (uint32_t) std::stoul(fields[2]), Unescape(fields[3]) });
+                continue;
+            }
+        } catch (std::exception &) {
+            // Reported below.
+        }
+
+        error = "line " + std::to_string(number) + " is damaged";
+        return false;
+    }
+
+    for(const HeapObject& object : dump.Objects) {
+        if(object.Dominator >= dump.Objects.size()) {
+            error = "an object is dominated by one that is not in the dump";
+            return false;
+        }
+    }
+    return true;
+}
+
+void WriteHeapDiff(const HeapDump& before, const HeapDump& after, std::ostream& out) {
+    struct Change {
+        std::string Name;
+        HeapGroup Before;
+        HeapGroup After;
+        int64_t Retained() const { return (int64_t) After.Retained - (int64_t) Before.Retained; }
+    };
+
+    std::map<std::string, Change> changes;
+    for(const auto& group : before.Groups())
+        changes[group.first].Before = group.second;
+    for(const auto& group : after.Groups())
+        changes[group.first].After = group.second;
+
+    std::vector<Change> rows;
+    for(auto& change : changes) {
+        change.second.Name = change.first;
+        rows.emplace_back(change.second);
+    }
+    std::sort(rows.begin(), rows.end(), [](const Change& a, const Change& b) {
+        return a.Retained() != b.Retained() ? a.Retained() > b.Retained() : a.Name < b.Name;
+    });
+
+    char line[256];
+    snprintf(line, sizeof(line), "%10s %10s %12s %12s %14s %14s  %s\n", "count", "+/-", "size", "+/-", "retained", "+/-", "group");
+    out << line;
+
+    for(const Change& row : rows) {
+        snprintf(line, sizeof(line), "%10llu %+10lld %12llu %+12lld %14llu %+14lld  ",
+                 (unsigned long long) row.After.Count, (long long) row.After.Count - (long long) row.Before.Count,
+                 (unsigned long long) row.After.Size, (long long) row.After.Size - (long long) row.Before.Size,
+                 (unsigned long long) row.After.Retained, (long long) row.Retained());
+        out << line << row.Name << "\n";
+    }
+
+    uint64_t totalBefore = before.Objects.empty() ? 0 : before.Objects[0].Retained;
+    uint64_t totalAfter = after.Objects.empty() ? 0 : after.Objects[0].Retained;
+    snprintf(line, sizeof(line), "%10zu %+10lld %12s %12s %14llu %+14lld  (total)\n",
+             after.Objects.empty() ? (size_t) 0 : after.Objects.size() - 1,
+             (long long) after.Objects.size() - (long long) before.Objects.size(), "", "",
+             (unsigned long long) totalAfter, (long long) totalAfter - (long long) totalBefore);
+    out << line;
+}
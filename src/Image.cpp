@@ -0,0 +1,687 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Image.hpp>
+#include <Bytes.hpp>
+#include <interpreter/Dictionary.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Layout of an image:
+ *
+ *   ImageHeader
+ *   string table: StringCount strings, each a u32 length followed by the bytes
+ *   tree: the top level statements, each written depth-first as a one byte NodeTag and its fields
+ *
+ * Every integer is little-endian, as written by the host; an image is only ever read on the
+ *  machine that wrote it. Tokens refer to their lexeme by index into the string table.
+ */
+struct ImageHeader {
+    char Magic[4];
+    uint32_t Format;
+    char Version[16];
+    uint64_t SourceHash;
+    uint32_t Template;
+    uint32_t StringCount;
+    uint64_t StringBytes;
+    uint64_t TreeBytes;
+};
+
+static const char ImageMagic[4] = { 'F', 'S', 'C', 'I' };
+
+enum NodeTag : uint8_t {
+    NODE_NULL,
+
+    NODE_BINARY,
+    NODE_GROUPING,
+    NODE_LITERAL,
+    NODE_UNARY,
+    NODE_VARIABLE,
+    NODE_ASSIGNMENT,
+    NODE_LOGICAL,
+    NODE_CALL,
+    NODE_GET,
+    NODE_SET,
+    NODE_THIS,
+    NODE_ARRAY,
+    NODE_INDEX,
+    NODE_INDEX_SET,
+
+    NODE_EXPRESSION_STMT,
+    NODE_PRINT,
+    NODE_VAR,
+    NODE_BLOCK,
+    NODE_IF,
+    NODE_WHILE,
+    NODE_FUNC,
+    NODE_CLASS,
+    NODE_RETURN,
+    NODE_TEXT,
+    NODE_EMIT,
+
+    // A function whose body was skipped by the pre-parse: its text, and the scopes it is resolved in.
+    NODE_DEFERRED_FUNC
+};
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *       E N C O D I N G     * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * Walks the tree, and writes every node into the tree stream, interning strings as it goes.
+ */
+class ImageWriter : public ExpressionVisitor<Object>,
+                    public StatementVisitor,
+                    public std::enable_shared_from_this<ImageWriter> {
+public:
+    std::string Strings;
+    uint32_t StringCount = 0;
+    std::string Tree;
+
+    // Set if the tree holds a value that has no representation in an image.
+    bool Unwritable = false;
+
+    Object dummy() override { return Object::Null; }
+
+    void Write(const shared_ptr<Statement>& stmt) {
+        if(stmt == nullptr) return Tag(NODE_NULL);
+        stmt->accept(shared_from_this());
+    }
+
+    void Write(const shared_ptr<Expression<Object>>& expr) {
+        if(expr == nullptr) return Tag(NODE_NULL);
+        expr->accept(shared_from_this());
+    }
+
+    void Write(const std::vector<shared_ptr<Statement>>& stmts) {
+        U32((uint32_t) stmts.size());
+        for(const auto& stmt : stmts)
+            Write(stmt);
+    }
+
+    void Write(const std::vector<shared_ptr<Expression<Object>>>& exprs) {
+        U32((uint32_t) exprs.size());
+        for(const auto& expr : exprs)
+            Write(expr);
+    }
+
+    void visitExpression(ExpressionStatement &stmt) override {
+        Tag(NODE_EXPRESSION_STMT); Write(stmt.Expr);
+    }
+
+    void visitPrint(PrintStatement &stmt) override {
+        Tag(NODE_PRINT); Write(stmt.Expr);
+    }
+
+    void visitVariable(VariableStatement &stmt) override {
+        Tag(NODE_VAR); WriteToken(stmt.Name); Write(stmt.Expr);
+    }
+
+    void visitBlock(BlockStatement &stmt) override {
+        Tag(NODE_BLOCK); Write(stmt.Statements);
+    }
+
+    void visitIf(IfStatement &stmt) override {
+        Tag(NODE_IF); Write(stmt.Condition); Write(stmt.Then); Write(stmt.Else);
+    }
+
+    void visitWhile(WhileStatement &stmt) override {
+        Tag(NODE_WHILE); Write(stmt.Condition); Write(stmt.Body);
+    }
+
+    void visitFunc(FuncStatement &stmt) override {
+        DeferredBody* deferred = stmt.Deferred.load(std::memory_order_acquire);
+        Tag(deferred == nullptr ? NODE_FUNC : NODE_DEFERRED_FUNC);
+        WriteToken(stmt.Name);
+        U32((uint32_t) stmt.Params.size());
+        for(const Token& param : stmt.Params)
+            WriteToken(param);
+
+        if(deferred == nullptr)
+            return Write(stmt.Body);
+
+        Raw<uint64_t>(deferred->Line);
+        WriteString(Tree, deferred->Text);
+        Raw<uint8_t>(deferred->Class);
+        Raw<uint8_t>(deferred->Type);
+        U32((uint32_t) deferred->Scopes.size());
+        for(const auto& scope : deferred->Scopes) {
+            U32((uint32_t) scope.size());
+            for(const auto& [name, defined] : scope) {
+                String(name);
+                Raw<uint8_t>(defined);
+            }
+        }
+    }
+
+    void visitClass(ClassStatement &stmt) override {
+        Tag(NODE_CLASS);
+        WriteToken(stmt.name);
+        Write(std::static_pointer_cast<Expression<Object>>(stmt.superclass));
+        U32((uint32_t) stmt.functions.size());
+        for(const auto& function : stmt.functions)
+            Write(std::static_pointer_cast<Statement>(function));
+    }
+
+    void visitReturn(ReturnStatement &stmt) override {
+        Tag(NODE_RETURN); WriteToken(stmt.Keyword); Write(stmt.Value);
+    }
+
+    void visitText(TextStatement &stmt) override {
+        Tag(NODE_TEXT); String(stmt.Text);
+    }
+
+    void visitEmit(EmitStatement &stmt) override {
+        Tag(NODE_EMIT); Write(stmt.Expr);
+    }
+
+    Object visitBinaryExpression(BinaryExpression<Object> &expr) override {
+        Begin(NODE_BINARY, expr); Write(expr.left); WriteToken(expr.operatorToken); Write(expr.right);
+        return Object::Null;
+    }
+
+    Object visitGroupingExpression(GroupingExpression<Object> &expr) override {
+        Begin(NODE_GROUPING, expr); Write(expr.expression);
+        return Object::Null;
+    }
+
+    Object visitLiteralExpression(LiteralExpression<Object> &expr) override {
+        Begin(NODE_LITERAL, expr); WriteObject(expr.value);
+        return Object::Null;
+    }
+
+    Object visitUnaryExpression(UnaryExpression<Object> &expr) override {
+        Begin(NODE_UNARY, expr); WriteToken(expr.operatorToken); Write(expr.right);
+        return Object::Null;
+    }
+
+    Object visitVariableExpression(VariableExpression<Object> &expr) override {
+        Begin(NODE_VARIABLE, expr); WriteToken(expr.Name);
+        return Object::Null;
+    }
+
+    Object visitAssignmentExpression(AssignmentExpression<Object> &expr) override {
+        Begin(NODE_ASSIGNMENT, expr); WriteToken(expr.Name); Write(expr.Expr);
+        return Object::Null;
+    }
+
+    Object visitLogicalExpression(LogicalExpression<Object> &expr) override {
+        Begin(NODE_LOGICAL, expr); Write(expr.Left); WriteToken(expr.operatorToken); Write(expr.Right);
+        return Object::Null;
+    }
+
+    Object visitCallExpression(CallExpression<Object> &expr) override {
+        Begin(NODE_CALL, expr); Write(expr.Callee); WriteToken(expr.Parenthesis); Write(expr.Arguments);
+        return Object::Null;
+    }
+
+    Object visitGetExpression(GetExpression<Object> &expr) override {
+        Begin(NODE_GET, expr); Write(expr.Obj); WriteToken(expr.Name);
+        return Object::Null;
+    }
+
+    Object visitSetExpression(SetExpression<Object> &expr) override {
+        Begin(NODE_SET, expr); Write(expr.Obj); WriteToken(expr.Name); Write(expr.Value);
+        return Object::Null;
+    }
+
+    Object visitThisExpression(ThisExpression<Object> &expr) override {
+        Begin(NODE_THIS, expr); WriteToken(expr.Name);
+        return Object::Null;
+    }
+
+    Object visitArrayExpression(ArrayExpression<Object> &expr) override {
+        Begin(NODE_ARRAY, expr); WriteToken(expr.Bracket); Write(expr.Elements);
+        return Object::Null;
+    }
+
+    Object visitIndexExpression(IndexExpression<Object> &expr) override {
+        Begin(NODE_INDEX, expr); Write(expr.Obj); WriteToken(expr.Bracket); Write(expr.Index);
+        return Object::Null;
+    }
+
+    Object visitIndexSetExpression(IndexSetExpression<Object> &expr) override {
+        Begin(NODE_INDEX_SET, expr); Write(expr.Obj); WriteToken(expr.Bracket); Write(expr.Index); Write(expr.Value);
+        return Object::Null;
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> Interned;
+
+    template <typename V>
+    void Raw(V value) { WriteRaw(Tree, value); }
+
+    void Tag(NodeTag tag) { Raw<uint8_t>(tag); }
+    void U32(uint32_t value) { Raw(value); }
+
+    // Every expression starts with its tag and its resolved depth.
+    void Begin(NodeTag tag, const Expression<Object>& expr) {
+        Tag(tag);
+        Raw<int32_t>(expr.Depth);
+    }
+
+    void String(const std::string& text) {
+        auto it = Interned.find(text);
+        if(it == Interned.end()) {
+            it = Interned.emplace(text, StringCount++).first;
+            WriteString(Strings, text);
+        }
+        U32(it->second);
+    }
+
+    // Only the values the parser can produce appear in a tree.
+    void WriteObject(const Object& value) {
+        Raw<uint8_t>(value.Type);
+        switch(value.Type) {
+            case Object::StrType: String(value.StrData); break;
+            case Object::NumType: Raw(value.NumData); break;
+            case Object::BoolType: Raw<uint8_t>(value.BoolData); break;
+            case Object::NullType: break;
+            default: Unwritable = true; break;
+        }
+    }
+
+    void WriteToken(const Token& token) {
+        Raw<int32_t>(token.Type);
+        Raw<uint64_t>(token.Line);
+        String(token.Lexeme);
+        WriteObject(token.Value);
+    }
+};
+
+std::string EncodeImage(const CompiledProgram& program) {
+    std::shared_ptr<ImageWriter> writer = std::make_shared<ImageWriter>();
+    writer->Write(program.Statements);
+    if(writer->Unwritable)
+        return "";
+
+    ImageHeader header {};
+    memcpy(header.Magic, ImageMagic, sizeof(header.Magic));
+    header.Format = IMAGE_FORMAT;
+    strncpy(header.Version, INTERP_VERSION, sizeof(header.Version) - 1);
+    header.SourceHash = program.SourceHash;
+    header.Template = program.Template;
+    header.StringCount = writer->StringCount;
+    header.StringBytes = writer->Strings.size();
+    header.TreeBytes = writer->Tree.size();
+
+    std::string image(reinterpret_cast<const char*>(&header), sizeof(header));
+    image.append(writer->Strings);
+    image.append(writer->Tree);
+    return image;
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *       D E C O D I N G     * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * Rebuilds the tree from an image, reading the mapped bytes in place.
+ * Every read is bounds checked, so a damaged image is rejected rather than trusted.
+ */
+class ImageReader : public ByteReader {
+public:
+    ImageReader(const char* pData, size_t pLength, shared_ptr<Arena> pNodes, DeferredSource* pDeferred)
+        : ByteReader(pData, pLength), Nodes(std::move(pNodes)), Deferred(pDeferred) {}
+
+    void ReadStrings(uint32_t count) {
+        Strings.reserve(count);
+        for(uint32_t i = 0; i < count; i++)
+            Strings.emplace_back(ByteReader::String());
+    }
+
+    std::vector<shared_ptr<Statement>> ReadStatements() {
+        uint32_t count = Count();
+        std::vector<shared_ptr<Statement>> stmts;
+        stmts.reserve(count);
+        for(uint32_t i = 0; i < count; i++)
+            stmts.emplace_back(ReadStatement());
+        return stmts;
+    }
+
+private:
+    std::vector<std::string> Strings;
+    shared_ptr<Arena> Nodes;
+    DeferredSource* Deferred;
+
+    const std::string& String() {
+        uint32_t index = Raw<uint32_t>();
+        if(index >= Strings.size()) throw DamagedBytes();
+        return Strings[index];
+    }
+
+    Object ReadObject() {
+        switch(Raw<uint8_t>()) {
+            case Object::StrType: return Object::NewStr(String());
+            case Object::NumType: return Object::NewNum(Raw<double>());
+            case Object::BoolType: return Object::NewBool(Raw<uint8_t>() != 0);
+            case Object::NullType: return Object::Null;
+            default: throw DamagedBytes();
+        }
+    }
+
+    Token ReadToken() {
+        Token token;
+        token.Type = Raw<int32_t>();
+        token.Line = Raw<uint64_t>();
+        token.Lexeme = String();
+        token.Value = ReadObject();
+        return token;
+    }
+
+    std::vector<shared_ptr<Expression<Object>>> ReadExpressions() {
+        uint32_t count = Count();
+        std::vector<shared_ptr<Expression<Object>>> exprs;
+        exprs.reserve(count);
+        for(uint32_t i = 0; i < count; i++)
+            exprs.emplace_back(ReadExpression());
+        return exprs;
+    }
+
+    shared_ptr<Expression<Object>> ReadExpression() {
+        uint8_t tag = Raw<uint8_t>();
+        if(tag == NODE_NULL)
+            return nullptr;
+
+        int depth = Raw<int32_t>();
+        shared_ptr<Expression<Object>> expr;
+
+        switch(tag) {
+            case NODE_BINARY: {
+                EXPR left = ReadExpression(); Token op = ReadToken(); EXPR right = ReadExpression();
+                expr = MakeNode<BinaryExpression<Object>>(Nodes, left, op, right);
+                break;
+            }
+            case NODE_GROUPING:
+                expr = MakeNode<GroupingExpression<Object>>(Nodes, ReadExpression());
+                break;
+            case NODE_LITERAL:
+                expr = MakeNode<LiteralExpression<Object>>(Nodes, ReadObject());
+                break;
+            case NODE_UNARY: {
+                Token op = ReadToken(); EXPR right = ReadExpression();
+                expr = MakeNode<UnaryExpression<Object>>(Nodes, op, right);
+                break;
+            }
+            case NODE_VARIABLE:
+                expr = MakeNode<VariableExpression<Object>>(Nodes, ReadToken());
+                break;
+            case NODE_ASSIGNMENT: {
+                Token name = ReadToken(); EXPR value = ReadExpression();
+                expr = MakeNode<AssignmentExpression<Object>>(Nodes, name, value);
+                break;
+            }
+            case NODE_LOGICAL: {
+                EXPR left = ReadExpression(); Token op = ReadToken(); EXPR right = ReadExpression();
+                expr = MakeNode<LogicalExpression<Object>>(Nodes, left, op, right);
+                break;
+            }
+            case NODE_CALL: {
+                EXPR callee = ReadExpression(); Token paren = ReadToken();
+                expr = MakeNode<CallExpression<Object>>(Nodes, callee, paren, ReadExpressions());
+                break;
+            }
+            case NODE_GET: {
+                EXPR object = ReadExpression(); Token name = ReadToken();
+                expr = MakeNode<GetExpression<Object>>(Nodes, object, name);
+                break;
+            }
+            case NODE_SET: {
+                EXPR object = ReadExpression(); Token name = ReadToken(); EXPR value = ReadExpression();
+                expr = MakeNode<SetExpression<Object>>(Nodes, object, name, value);
+                break;
+            }
+            case NODE_THIS:
+                expr = MakeNode<ThisExpression<Object>>(Nodes, ReadToken());
+                break;
+            case NODE_ARRAY: {
+                Token bracket = ReadToken();
+                expr = MakeNode<ArrayExpression<Object>>(Nodes, bracket, ReadExpressions());
+                break;
+            }
+            case NODE_INDEX: {
+                EXPR object = ReadExpression(); Token bracket = ReadToken(); EXPR index = ReadExpression();
+                expr = MakeNode<IndexExpression<Object>>(Nodes, object, bracket, index);
+                break;
+            }
+            case NODE_INDEX_SET: {
+                EXPR object = ReadExpression(); Token bracket = ReadToken();
+                EXPR index = ReadExpression(); EXPR value = ReadExpression();
+                expr = MakeNode<IndexSetExpression<Object>>(Nodes, object, bracket, index, value);
+                break;
+            }
+            default:
+                throw DamagedBytes();
+        }
+
+        expr->Depth = depth;
+        return expr;
+    }
+
+    shared_ptr<FuncStatement> ReadFunction(uint8_t tag) {
+        Token name = ReadToken();
+        uint32_t count = Count();
+        std::vector<Token> params;
+        params.reserve(count);
+        for(uint32_t i = 0; i < count; i++)
+            params.emplace_back(ReadToken());
+
+        if(tag == NODE_FUNC)
+            return MakeNode<FuncStatement>(Nodes, name, params, ReadStatements());
+
+        // Every skipped body is copied out, since the image is unmapped once it has been read.
+        DeferredBody& body = Deferred->Bodies.emplace_back();
+        body.Source = Deferred;
+        body.Line = Raw<uint64_t>();
+        body.Text = ByteReader::String();
+
+        body.Class = (ClassType) Raw<uint8_t>();
+        body.Type = (FunctionType) Raw<uint8_t>();
+        uint32_t scopes = Count();
+        body.Scopes.resize(scopes);
+        for(auto& scope : body.Scopes) {
+            uint32_t names = Count();
+            for(uint32_t i = 0; i < names; i++) {
+                std::string scopeName = String();
+                scope[scopeName] = Raw<uint8_t>() != 0;
+            }
+        }
+
+        return MakeNode<FuncStatement>(Nodes, name, params, std::vector<shared_ptr<Statement>>(), &body);
+    }
+
+    shared_ptr<Statement> ReadStatement() {
+        uint8_t tag = Raw<uint8_t>();
+        switch(tag) {
+            case NODE_NULL:
+                return nullptr;
+            case NODE_EXPRESSION_STMT:
+                return MakeNode<ExpressionStatement>(Nodes, ReadExpression());
+            case NODE_PRINT:
+                return MakeNode<PrintStatement>(Nodes, ReadExpression());
+            case NODE_VAR: {
+                Token name = ReadToken();
+                return MakeNode<VariableStatement>(Nodes, name, ReadExpression());
+            }
+            case NODE_BLOCK:
+                return MakeNode<BlockStatement>(Nodes, ReadStatements());
+            case NODE_IF: {
+                EXPR condition = ReadExpression();
+                shared_ptr<Statement> then = ReadStatement();
+                return MakeNode<IfStatement>(Nodes, condition, then, ReadStatement());
+            }
+            case NODE_WHILE: {
+                EXPR condition = ReadExpression();
+                return MakeNode<WhileStatement>(Nodes, condition, ReadStatement());
+            }
+            case NODE_FUNC:
+            case NODE_DEFERRED_FUNC:
+                return ReadFunction(tag);
+            case NODE_CLASS: {
+                Token name = ReadToken();
+                EXPR super = ReadExpression();
+                auto superclass = std::dynamic_pointer_cast<VariableExpression<Object>>(super);
+                if(super != nullptr && superclass == nullptr) throw DamagedBytes();
+
+                uint32_t count = Count();
+                std::vector<shared_ptr<FuncStatement>> functions;
+                for(uint32_t i = 0; i < count; i++) {
+                    uint8_t method = Raw<uint8_t>();
+                    if(method != NODE_FUNC && method != NODE_DEFERRED_FUNC) throw DamagedBytes();
+                    functions.emplace_back(ReadFunction(method));
+                }
+                return MakeNode<ClassStatement>(Nodes, name, functions, superclass);
+            }
+            case NODE_RETURN: {
+                Token keyword = ReadToken();
+                return MakeNode<ReturnStatement>(Nodes, keyword, ReadExpression());
+            }
+            case NODE_TEXT:
+                return MakeNode<TextStatement>(Nodes, String());
+            case NODE_EMIT:
+                return MakeNode<EmitStatement>(Nodes, ReadExpression());
+            default:
+                throw DamagedBytes();
+        }
+    }
+};
+
+shared_ptr<const CompiledProgram> DecodeImage(const char* data, size_t length, const std::string& path, uint64_t sourceHash, bool isTemplate) {
+    ImageHeader header {};
+    if(length < sizeof(header))
+        return nullptr;
+    memcpy(&header, data, sizeof(header));
+
+    char version[sizeof(header.Version)] {};
+    strncpy(version, INTERP_VERSION, sizeof(version) - 1);
+
+    if(memcmp(header.Magic, ImageMagic, sizeof(ImageMagic)) != 0 || header.Format != IMAGE_FORMAT
+       || memcmp(header.Version, version, sizeof(version)) != 0 || header.SourceHash != sourceHash
+       || header.Template != (uint32_t) isTemplate
+       || header.StringBytes + header.TreeBytes != length - sizeof(header))
+        return nullptr;
+
+    auto program = std::make_shared<CompiledProgram>();
+    program->Path = path;
+    program->SourceHash = sourceHash;
+    program->Template = isTemplate;
+    program->Nodes = std::make_shared<Arena>();
+    program->Deferred = std::make_unique<DeferredSource>();
+    program->Deferred->Nodes = program->Nodes;
+
+    try {
+        ImageReader reader(data + sizeof(header), length - sizeof(header), program->Nodes, program->Deferred.get());
+        reader.ReadStrings(header.StringCount);
+        program->Statements = reader.ReadStatements();
+        if(!reader.AtEnd())
+            return nullptr;
+    } catch (DamagedBytes &) {
+        return nullptr;
+    }
+
+    if(program->Deferred->Bodies.empty())
+        program->Deferred = nullptr;
+
+    return program;
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *           F I L E S       * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+std::string ImagePath(const std::string& sourcePath) {
+    if(sourcePath.empty() || getenv("FUSCO_NO_CACHE") != nullptr)
+        return "";
+
+#ifdef FUSCO_INSTRUMENT
+    // Images do not keep the lines of their nodes, which the counts need.
+    return "";
+#endif
+
+    const char* directory = getenv("FUSCO_CACHE_DIR");
+    if(directory == nullptr || *directory == 0)
+        return sourcePath + ".fsc";
+
+    // Every source gets its own name in the shared directory, whatever directory it came from.
+    char name[24];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long) HashBytes(sourcePath.data(), sourcePath.size()));
+    return std::string(directory) + "/" + name + ".fsc";
+}
+
+shared_ptr<const CompiledProgram> LoadImage(const std::string& sourcePath, uint64_t sourceHash, bool isTemplate) {
+    std::string path = ImagePath(sourcePath);
+    if(path.empty())
+        return nullptr;
+
+#ifdef _WIN32
+    std::ifstream File(path, std::ios::binary);
+    if(!File)
+        return nullptr;
+    std::string image((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+    return DecodeImage(image.data(), image.size(), sourcePath, sourceHash, isTemplate);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return nullptr;
+
+    struct stat info {};
+    if(fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(ImageHeader)) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t length = (size_t) info.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+        return nullptr;
+
+    shared_ptr<const CompiledProgram> program = DecodeImage(static_cast<const char*>(mapped), length, sourcePath, sourceHash, isTemplate);
+    munmap(mapped, length);
+    return program;
+#endif
+}
+
+bool SaveImage(const CompiledProgram& program) {
+    std::string path = ImagePath(program.Path);
+    if(path.empty())
+        return false;
+
+    std::string image = EncodeImage(program);
+    if(image.empty())
+        return false;
+
+    // Written aside and renamed into place, so that a reader never sees half an image.
+    std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream File(temporary, std::ios::binary | std::ios::trunc);
+        if(!File)
+            return false;
+        File.write(image.data(), (std::streamsize) image.size());
+        if(!File) {
+            File.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if(std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
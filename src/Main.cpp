@@ -3,61 +3,241 @@
  *   FUSCO*
  **********/
 
-#include <Parse.hpp>
-#include <ast/Expression.hpp>
-#include <interpreter/Interpreter.hpp>
-#include <lexer/Lex.hpp>
+#include <Engine.hpp>
+#include <HeapDump.hpp>
+#include <Trace.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
 #include <utility>
 
-bool ErrorState = false;
+#ifdef FUSCO_SERVER
+#include <server/Server.hpp>
+#endif
 
-static shared_ptr<ExecutionContext> Context =
-    std::make_shared<ExecutionContext>();
-static shared_ptr<Interpreter> Engine = std::make_shared<Interpreter>(Context);
+// Every allocation made with new, for the counts of --trace. The library leaves operator new alone.
+static std::atomic<uint64_t> Allocations { 0 };
 
-Object Object::Null;
+void* operator new(size_t size) {
+    Allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
 
-void lex(std::string text) {
-    Lexer tokenStream(std::move(text));
-    auto tokens = tokenStream.ConsumeAllAndReturn();
+void operator delete[](void* memory) noexcept {
+    free(memory);
+}
 
-    Parser parser(tokens);
-    std::vector<shared_ptr<Statement>> statements = parser.parse();
+void operator delete(void* memory, size_t size) noexcept {
+    UNUSED(size);
+    free(memory);
+}
 
-    if (ErrorState) return;
+void operator delete[](void* memory, size_t size) noexcept {
+    UNUSED(size);
+    free(memory);
+}
 
-    std::shared_ptr<TreePrinter> printer = std::make_shared<TreePrinter>();
-    printer->print(statements);
+#ifdef FUSCO_SERVER
+/*
+ * fusco --serve <root> [--port N] [--threads N | --prefork N] [--prelude file]
+ * fusco --loadtest [--host H] [--port N] [--path P] [--connections N] [--seconds S] [--timeout S]
+ */
+static int serve(int argc, char** argv) {
+    std::string mode = argv[1];
+    ServerOptions server;
+    LoadTestOptions load;
+
+    for (int i = 2; i < argc; i++) {
+        std::string flag = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (flag == "--port" && hasValue) server.Port = load.Port = (uint16_t) std::stoi(argv[++i]);
+        else if (flag == "--threads" && hasValue) server.Threads = std::stoul(argv[++i]);
+        else if (flag == "--prefork" && hasValue) server.Prefork = std::stoul(argv[++i]);
+        else if (flag == "--prelude" && hasValue) server.Prelude = argv[++i];
+        else if (flag == "--host" && hasValue) load.Host = argv[++i];
+        else if (flag == "--path" && hasValue) load.Path = argv[++i];
+        else if (flag == "--connections" && hasValue) load.Connections = std::stoul(argv[++i]);
+        else if (flag == "--seconds" && hasValue) load.Seconds = std::stod(argv[++i]);
+        else if (flag == "--timeout" && hasValue) load.Timeout = std::stod(argv[++i]);
+        else if (mode == "--serve" && flag.rfind("--", 0) != 0) server.Root = flag;
+        else {
+            std::cout << "Unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
 
-    std::shared_ptr<Resolver> resolver = std::make_shared<Resolver>(Engine);
-    resolver->resolveAll(statements);
+    if (mode == "--loadtest")
+        return RunLoadTest(load);
 
-    if (ErrorState) return;
+    RenderServer renderer(server);
+    return renderer.Serve();
+}
+#endif
+
+/*
+ * fusco --heap-diff <before> <after>
+ * Compares two heap dumps, without running anything.
+ */
+static int diffHeaps(const char* beforePath, const char* afterPath) {
+    HeapDump dumps[2];
+    const char* paths[2] = { beforePath, afterPath };
+
+    for (int i = 0; i < 2; i++) {
+        std::ifstream file(paths[i]);
+        std::string error;
+        if (!file) error = "unable to read it";
+        if (!error.empty() || !ReadHeapDump(file, dumps[i], error)) {
+            std::cerr << paths[i] << ": " << error << std::endl;
+            return 1;
+        }
+    }
 
-    Engine->Interpret(statements);
+    WriteHeapDiff(dumps[0], dumps[1], std::cout);
+    return 0;
 }
 
-int main(int argc, char** argv) {
-    Object::Null.Type = Object::NullType;
+/*
+ * fusco [file]
+ * fusco --template <file>
+ */
+static int run(Engine& engine, int argc, char** argv) {
+    if (argc > 2 && std::string(argv[1]) == "--template") {
+        // Nothing else is written to the output, so that it contains only the rendered page.
+        Common::Reports = &std::cerr;
+        return engine.RenderFile(argv[2]) ? 0 : 1;
+    }
 
     std::cout << "Fusco Interpreter, version " << INTERP_VERSION << std::endl;
     std::cout << "20/05/21, Curle" << std::endl << std::endl;
 
+    engine.DumpTree = true;
+
     if (argc < 2) {
         // Emulate a REPL (Read, Evaluate, Print, Loop)
         printf("$ ");
         for (std::string line; std::getline(std::cin, line);) {
-            ErrorState = false;
-            lex(line);
+            engine.Run(line);
             printf("$ ");
         }
     } else {
         // Read and run the given file.
-        std::ifstream File(argv[1]);
+        engine.RunFile(argv[1]);
+    }
 
-        std::string str((std::istreambuf_iterator<char>(File)),
-                        std::istreambuf_iterator<char>());
+    return 0;
+}
 
-        lex(str);
+int main(int argc, char** argv) {
+#ifdef FUSCO_SERVER
+    if (argc > 1 && (std::string(argv[1]) == "--serve" || std::string(argv[1]) == "--loadtest"))
+        return serve(argc, argv);
+#endif
+
+    if (argc == 4 && std::string(argv[1]) == "--heap-diff")
+        return diffHeaps(argv[2], argv[3]);
+
+    // fusco --heap-dump <dump> ... writes everything the globals still hold to <dump> at exit.
+    std::string heapPath;
+    if (argc > 3 && std::string(argv[1]) == "--heap-dump") {
+        heapPath = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
     }
+
+    // fusco --profile <stacks> ... samples the script as it runs, writes its collapsed stacks to <stacks>,
+    //  and a table of the time spent in each function to stderr.
+    std::string profilePath;
+    if (argc > 3 && std::string(argv[1]) == "--profile") {
+        profilePath = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+#ifdef FUSCO_INSTRUMENT
+    // fusco --heat <report> ... writes how often each line ran, and for how long, to <report> as JSON.
+    std::string heatPath;
+    if (argc > 3 && std::string(argv[1]) == "--heat") {
+        heatPath = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    // fusco --memory ... prints what was alive, at most and in all, of each kind of object to stderr at exit.
+    bool memoryReport = false;
+    if (argc > 2 && std::string(argv[1]) == "--memory") {
+        memoryReport = true;
+        argv[1] = argv[0];
+        argv += 1;
+        argc -= 1;
+    }
+#endif
+
+    // fusco --trace <trace> ... writes a Chrome trace of each stage of compiling and running the script;
+    //  --trace-calls <trace> adds every call of a script function.
+    std::string tracePath;
+    bool traceCalls = false;
+    if (argc > 3 && (std::string(argv[1]) == "--trace" || std::string(argv[1]) == "--trace-calls")) {
+        traceCalls = std::string(argv[1]) == "--trace-calls";
+        tracePath = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    TraceLog trace(traceCalls);
+    trace.CountAllocationsWith(&Allocations);
+    if (!tracePath.empty())
+        trace.Start();
+
+    Engine engine;
+    Profiler profiler(engine.GetInterpreter()->Stack);
+    if (!profilePath.empty() && !profiler.Start())
+        std::cerr << "Unable to start the profiler" << std::endl;
+
+    int result = run(engine, argc, argv);
+
+    if (!profilePath.empty()) {
+        profiler.Stop();
+        std::ofstream stacks(profilePath);
+        profiler.WriteCollapsed(stacks);
+        profiler.WriteTable(std::cerr);
+    }
+
+    if (!heapPath.empty()) {
+        std::ofstream dump(heapPath);
+        WriteHeapDump(CaptureHeap(*engine.GetInterpreter()), dump);
+    }
+
+    if (!tracePath.empty()) {
+        trace.Stop();
+        std::ofstream events(tracePath);
+        trace.WriteJSON(events);
+    }
+
+#ifdef FUSCO_INSTRUMENT
+    if (!heatPath.empty()) {
+        std::ofstream report(heatPath);
+        engine.GetInterpreter()->Heat.WriteJSON(report);
+    }
+
+    if (memoryReport)
+        WriteMemoryTable(std::cerr);
+#endif
+
+    return result;
 }
@@ -0,0 +1,239 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Program.hpp>
+#include <Image.hpp>
+#include <Parse.hpp>
+#include <ParallelParse.hpp>
+#include <Source.hpp>
+#include <Trace.hpp>
+#include <interpreter/Interpreter.hpp>
+#include <lexer/Lex.hpp>
+#include <lexer/ParallelLex.hpp>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+uint64_t HashSource(std::string_view source) {
+    return HashBytes(source.data(), source.size());
+}
+
+FuncStatement* CompiledProgram::RenderFunction() const {
+    if(!Template || Statements.empty())
+        return nullptr;
+
+    return static_cast<FuncStatement*>(Statements.front().get());
+}
+
+void CompleteDeferred(FuncStatement& function) {
+    DeferredBody* deferred = function.Deferred.load(std::memory_order_acquire);
+    if(deferred == nullptr)
+        return;
+
+    DeferredSource& source = *deferred->Source;
+    std::lock_guard<std::mutex> guard(source.Lock);
+
+    // Another thread may have compiled it while this one waited.
+    if(function.Deferred.load(std::memory_order_relaxed) == nullptr)
+        return;
+
+    if(!deferred->Failed) {
+        TraceSpan span("compile body");
+        span.Argument("function", function.Name.Lexeme);
+        size_t nodes = source.Nodes->Allocations();
+
+        Lexer tokenStream(deferred->Text, false, (int) deferred->Line);
+        Parser parser(tokenStream, source.Nodes);
+        std::vector<shared_ptr<Statement>> body = parser.parse();
+        span.Argument("tokens", parser.TokenCount());
+        span.Argument("nodes", source.Nodes->Allocations() - nodes);
+
+        bool failed = tokenStream.ErrorState || parser.ErrorState;
+        if(!failed) {
+            std::shared_ptr<Resolver> resolver = std::make_shared<Resolver>();
+            try {
+                resolver->resolveDeferred(function, body, *deferred);
+            } catch (RuntimeError &) {
+                // Already reported by the Resolver.
+            }
+            failed = resolver->ErrorState;
+        }
+
+        if(!failed) {
+            function.Body = std::move(body);
+            // The tree has been built from the text, so it is no longer needed.
+            std::string().swap(deferred->Text);
+            function.Deferred.store(nullptr, std::memory_order_release);
+            return;
+        }
+
+        deferred->Failed = true;
+    }
+
+    throw RuntimeError(function.Name, "The body of " + function.Name.Lexeme + " does not compile.");
+}
+
+void CompleteProgram(const CompiledProgram& program) {
+    if(program.Deferred == nullptr)
+        return;
+
+    // Compiling a body adds none to the list: the bodies of functions inside it are parsed in full.
+    for(DeferredBody& body : program.Deferred->Bodies) {
+        try {
+            CompleteFunction(*body.Function);
+        } catch (RuntimeError &) {
+            // Already reported; the function throws again when it is called.
+        }
+    }
+}
+
+shared_ptr<const CompiledProgram> CompileProgram(std::string_view source, const std::string& path, bool isTemplate) {
+    TraceSpan compile("compile");
+    if(!path.empty())
+        compile.Argument("path", path);
+    compile.Argument("bytes", source.size());
+
+    uint64_t hash = HashSource(source);
+
+    // A file compiled before, by this version, need not be lexed, parsed or resolved again.
+    if(!path.empty()) {
+        TraceSpan loading("load image");
+        shared_ptr<const CompiledProgram> image = LoadImage(path, hash, isTemplate);
+        loading.Argument("found", image != nullptr);
+        if(image != nullptr) {
+            loading.Argument("node bytes", image->Nodes->Used());
+            return image;
+        }
+    }
+
+    auto program = std::make_shared<CompiledProgram>();
+    program->Path = path;
+    program->SourceHash = hash;
+    program->Template = isTemplate;
+    program->Nodes = std::make_shared<Arena>();
+
+    // A script is only pre-parsed; a template's body is its render function, which always runs.
+    if(!isTemplate) {
+        program->Deferred = std::make_unique<DeferredSource>();
+        program->Deferred->Nodes = program->Nodes;
+        // Not a copy: the bodies copy their own text as they are recorded, since the source may be a
+        //  mapping of a file that could change under a running program.
+        program->Deferred->Text = source;
+    }
+
+    // The parser pulls its tokens as it goes, so lexing is timed along with parsing.
+    bool parseFailed;
+    {
+        TraceSpan parsing("lex and parse");
+
+        // A large script is lexed on several threads, while it is being parsed.
+        std::unique_ptr<TokenSource> tokenStream;
+        if(!isTemplate && source.size() >= ParallelLexer::MinimumSize)
+            tokenStream = std::make_unique<ParallelLexer>(source);
+        else
+            tokenStream = std::make_unique<Lexer>(source, isTemplate);
+
+        // And its top-level declarations are parsed on several threads too, if there is more than one.
+        if(!isTemplate && source.size() >= ParallelLexer::MinimumSize && std::thread::hardware_concurrency() > 1) {
+            ParallelParser parser(*tokenStream, program->Nodes, program->Deferred.get());
+            program->Statements = parser.parse();
+            parseFailed = parser.ErrorState;
+            parsing.Argument("tokens", parser.TokenCount());
+            parsing.Argument("ranges", parser.RangeCount());
+        } else {
+            Parser parser(*tokenStream, program->Nodes, program->Deferred.get());
+            program->Statements = isTemplate ? parser.parseTemplate("render") : parser.parse();
+            parseFailed = parser.ErrorState;
+            parsing.Argument("tokens", parser.TokenCount());
+        }
+        parsing.Argument("nodes", program->Nodes->Allocations());
+        parsing.Argument("node bytes", program->Nodes->Used());
+        if(program->Deferred != nullptr)
+            parsing.Argument("deferred bodies", program->Deferred->Bodies.size());
+
+        parseFailed = parseFailed || tokenStream->ErrorState;
+    }
+
+    if(parseFailed)
+        return nullptr;
+
+    if(program->Deferred != nullptr && program->Deferred->Bodies.empty())
+        program->Deferred = nullptr;
+    else if(program->Deferred != nullptr)
+        program->Deferred->Text = std::string_view();
+
+    std::shared_ptr<Resolver> resolver = std::make_shared<Resolver>();
+    {
+        TraceSpan resolving("resolve");
+        try {
+            resolver->resolveAll(program->Statements);
+        } catch (RuntimeError &) {
+            // Already reported by the Resolver.
+        }
+    }
+
+    if(resolver->ErrorState)
+        return nullptr;
+
+    if(!path.empty()) {
+        TraceSpan saving("save image");
+        SaveImage(*program);
+    }
+
+    return program;
+}
+
+shared_ptr<const CompiledProgram> ProgramCache::Find(const std::string& path) const {
+    std::shared_lock<std::shared_mutex> guard(Lock);
+
+    auto it = Programs.find(path);
+    return it == Programs.end() ? nullptr : it->second;
+}
+
+shared_ptr<const CompiledProgram> ProgramCache::Get(const std::string& path, std::string_view source, bool isTemplate) {
+    uint64_t hash = HashSource(source);
+
+    {
+        std::shared_lock<std::shared_mutex> guard(Lock);
+        auto it = Programs.find(path);
+        if(it != Programs.end() && it->second->SourceHash == hash && it->second->Template == isTemplate)
+            return it->second;
+    }
+
+    shared_ptr<const CompiledProgram> program = CompileProgram(source, path, isTemplate);
+    if(program == nullptr)
+        return nullptr;
+
+    std::unique_lock<std::shared_mutex> guard(Lock);
+    auto& slot = Programs[path];
+    if(slot != nullptr && slot->SourceHash == hash && slot->Template == isTemplate)
+        return slot;
+
+    slot = program;
+    return program;
+}
+
+shared_ptr<const CompiledProgram> ProgramCache::Load(const std::string& path, bool isTemplate) {
+    SourceText source;
+    if(!source.Load(path))
+        return nullptr;
+
+    return Get(path, source.View(), isTemplate);
+}
+
+void ProgramCache::Invalidate(const std::string& path) {
+    std::unique_lock<std::shared_mutex> guard(Lock);
+    Programs.erase(path);
+}
+
+void ProgramCache::Clear() {
+    std::unique_lock<std::shared_mutex> guard(Lock);
+    Programs.clear();
+}
+
+size_t ProgramCache::size() const {
+    std::shared_lock<std::shared_mutex> guard(Lock);
+    return Programs.size();
+}
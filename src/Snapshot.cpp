@@ -0,0 +1,465 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Snapshot.hpp>
+#include <Bytes.hpp>
+#include <interpreter/Array.hpp>
+#include <unordered_map>
+
+/*
+ * Layout of a blob:
+ *
+ *   SnapshotHeader
+ *   shells: for every object, its kind and whatever is needed to construct it
+ *   bodies: for every object, in the same order, its contents
+ *
+ * Objects refer to each other by their index in the shell list, so cycles need no special care:
+ *  every shell is constructed before any body is filled in. Object 0 is always the globals.
+ */
+struct SnapshotHeader {
+    char Magic[4];
+    uint32_t Format;
+    uint32_t Objects;
+    uint32_t Functions;
+};
+
+static const char SnapshotMagic[4] = { 'F', 'S', 'N', 'P' };
+static const uint32_t SnapshotFormat = 1;
+
+enum SnapshotKind : uint8_t {
+    SNAP_CONTEXT,
+    SNAP_FUNCTION,
+    SNAP_CLASS,
+    SNAP_INSTANCE,
+    SNAP_ARRAY,
+    SNAP_DICTIONARY,
+    SNAP_NATIVE
+};
+
+/*
+ * Every function declaration in a tree, in a fixed order. Expressions never hold statements,
+ *  so only statements need to be walked.
+ * A body that has not been parsed yet has never run, so nothing can refer to the functions inside it.
+ */
+static void CollectFunctions(const shared_ptr<Statement>& stmt, std::vector<shared_ptr<FuncStatement>>& out) {
+    if(stmt == nullptr)
+        return;
+
+    if(auto func = std::dynamic_pointer_cast<FuncStatement>(stmt)) {
+        out.emplace_back(func);
+        if(func->Deferred.load(std::memory_order_acquire) == nullptr)
+            for(const auto& inner : func->Body) CollectFunctions(inner, out);
+    } else if(auto klass = std::dynamic_pointer_cast<ClassStatement>(stmt)) {
+        for(const auto& method : klass->functions) CollectFunctions(method, out);
+    } else if(auto block = std::dynamic_pointer_cast<BlockStatement>(stmt)) {
+        for(const auto& inner : block->Statements) CollectFunctions(inner, out);
+    } else if(auto branch = std::dynamic_pointer_cast<IfStatement>(stmt)) {
+        CollectFunctions(branch->Then, out);
+        CollectFunctions(branch->Else, out);
+    } else if(auto loop = std::dynamic_pointer_cast<WhileStatement>(stmt)) {
+        CollectFunctions(loop->Body, out);
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *        C A P T U R E      * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+class SnapshotWriter {
+public:
+    SnapshotWriter(const Snapshot& snapshot, const shared_ptr<ExecutionContext>& globals) {
+        for(size_t i = 0; i < snapshot.Functions.size(); i++)
+            FunctionIndex.emplace(snapshot.Functions[i].get(), (uint32_t) i);
+
+        for(const auto& global : globals->ObjectMap)
+            if(global.second.Type == Object::CallableType && dynamic_cast<Function*>(global.second.CallableData.get()) == nullptr)
+                NativeNames.emplace(global.second.CallableData.get(), global.first);
+
+        Reference(SNAP_CONTEXT, globals.get());
+    }
+
+    bool Write(std::string& blob, uint32_t functions) {
+        // Objects found while writing a body are appended to the queue, and written in turn.
+        for(size_t i = 0; i < Queue.size() && Error.empty(); i++)
+            WriteBody(Queue[i]);
+
+        if(!Error.empty())
+            return false;
+
+        SnapshotHeader header {};
+        memcpy(header.Magic, SnapshotMagic, sizeof(header.Magic));
+        header.Format = SnapshotFormat;
+        header.Objects = (uint32_t) Queue.size();
+        header.Functions = functions;
+
+        blob.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+        blob.append(Shells);
+        blob.append(Bodies);
+        return true;
+    }
+
+    // Why the snapshot could not be taken.
+    std::string Error;
+
+private:
+    struct Pending {
+        SnapshotKind Kind;
+        const void* Pointer;
+    };
+
+    std::unordered_map<const FuncStatement*, uint32_t> FunctionIndex;
+    std::unordered_map<const Callable*, std::string> NativeNames;
+    std::unordered_map<const void*, uint32_t> Ids;
+    std::vector<Pending> Queue;
+
+    std::string Shells;
+    std::string Bodies;
+
+    uint32_t Reference(SnapshotKind kind, const void* pointer) {
+        auto it = Ids.find(pointer);
+        if(it != Ids.end())
+            return it->second;
+
+        uint32_t id = (uint32_t) Queue.size();
+        Ids.emplace(pointer, id);
+        Queue.push_back({ kind, pointer });
+
+        WriteRaw<uint8_t>(Shells, kind);
+        switch(kind) {
+            case SNAP_FUNCTION: {
+                auto function = static_cast<const Function*>(pointer);
+                auto index = FunctionIndex.find(function->Declaration);
+                if(index == FunctionIndex.end()) {
+                    Error = "function " + function->Declaration->Name.Lexeme + " was not declared by a program in the snapshot";
+                    index = FunctionIndex.emplace(function->Declaration, 0).first;
+                }
+                WriteRaw<uint32_t>(Shells, index->second);
+                WriteRaw<uint8_t>(Shells, function->constructor);
+                break;
+            }
+            case SNAP_CLASS:
+                WriteString(Shells, static_cast<const FClass*>(pointer)->Name);
+                break;
+            case SNAP_NATIVE:
+                WriteString(Shells, NativeNames.at(static_cast<const Callable*>(pointer)));
+                break;
+            default:
+                break;
+        }
+
+        return id;
+    }
+
+    uint32_t ReferenceCallable(const shared_ptr<Callable>& callable) {
+        if(auto function = dynamic_cast<const Function*>(callable.get()))
+            return Reference(SNAP_FUNCTION, function);
+        if(auto fclass = dynamic_cast<const FClass*>(callable.get()))
+            return Reference(SNAP_CLASS, fclass);
+        if(NativeNames.find(callable.get()) != NativeNames.end())
+            return Reference(SNAP_NATIVE, callable.get());
+
+        // A bound builtin, like list.push. There is nothing to bind it to again by name.
+        Error = "a builtin method cannot be restored";
+        return 0;
+    }
+
+    void WriteValue(const Object& value) {
+        WriteRaw<uint8_t>(Bodies, value.Type);
+        switch(value.Type) {
+            case Object::StrType: WriteString(Bodies, value.StrData); break;
+            case Object::NumType: WriteRaw(Bodies, value.NumData); break;
+            case Object::BoolType: WriteRaw<uint8_t>(Bodies, value.BoolData); break;
+            case Object::NullType: break;
+            case Object::CallableType:
+            case Object::MethodType: WriteRaw(Bodies, ReferenceCallable(value.CallableData)); break;
+            case Object::ClassType: WriteRaw(Bodies, Reference(SNAP_CLASS, value.ClassData.get())); break;
+            case Object::InstanceType: WriteRaw(Bodies, Reference(SNAP_INSTANCE, value.InstanceData.get())); break;
+            case Object::ArrayType: WriteRaw(Bodies, Reference(SNAP_ARRAY, value.ArrayData.get())); break;
+            case Object::DictType: WriteRaw(Bodies, Reference(SNAP_DICTIONARY, value.DictData.get())); break;
+        }
+    }
+
+    void WriteFields(const std::map<std::string, Object>& fields) {
+        WriteRaw<uint32_t>(Bodies, (uint32_t) fields.size());
+        for(const auto& field : fields) {
+            WriteString(Bodies, field.first);
+            WriteValue(field.second);
+        }
+    }
+
+    void WriteBody(const Pending& pending) {
+        switch(pending.Kind) {
+            case SNAP_CONTEXT: {
+                auto context = static_cast<const ExecutionContext*>(pending.Pointer);
+                int32_t enclosing = context->Enclosing == nullptr ? -1 : (int32_t) Reference(SNAP_CONTEXT, context->Enclosing.get());
+                WriteRaw(Bodies, enclosing);
+                WriteFields(context->ObjectMap);
+                break;
+            }
+            case SNAP_FUNCTION: {
+                auto function = static_cast<const Function*>(pending.Pointer);
+                WriteRaw(Bodies, Reference(SNAP_CONTEXT, function->Closure.get()));
+                break;
+            }
+            case SNAP_CLASS: {
+                auto fclass = static_cast<const FClass*>(pending.Pointer);
+                int32_t super = fclass->superclass == nullptr ? -1 : (int32_t) Reference(SNAP_CLASS, fclass->superclass.get());
+                WriteRaw(Bodies, super);
+                WriteRaw<uint32_t>(Bodies, (uint32_t) fclass->Methods.size());
+                for(const auto& method : fclass->Methods) {
+                    WriteString(Bodies, method.first);
+                    WriteRaw(Bodies, Reference(SNAP_FUNCTION, method.second.get()));
+                }
+                break;
+            }
+            case SNAP_INSTANCE: {
+                auto instance = static_cast<const Instance*>(pending.Pointer);
+                WriteRaw(Bodies, Reference(SNAP_CLASS, instance->fclass.get()));
+                WriteFields(instance->fields);
+                break;
+            }
+            case SNAP_ARRAY: {
+                auto array = static_cast<const Array*>(pending.Pointer);
+                WriteRaw<uint32_t>(Bodies, (uint32_t) array->length());
+                for(size_t i = 0; i < array->length(); i++)
+                    WriteValue(array->at(i));
+                break;
+            }
+            case SNAP_DICTIONARY: {
+                auto dictionary = static_cast<const Dictionary*>(pending.Pointer);
+                std::vector<Object> keys = dictionary->keys();
+                std::vector<Object> values = dictionary->values();
+                WriteRaw<uint32_t>(Bodies, (uint32_t) keys.size());
+                for(size_t i = 0; i < keys.size(); i++) {
+                    WriteValue(keys[i]);
+                    WriteValue(values[i]);
+                }
+                break;
+            }
+            case SNAP_NATIVE:
+                break;
+        }
+    }
+};
+
+shared_ptr<const Snapshot> CaptureSnapshot(const std::vector<shared_ptr<const CompiledProgram>>& programs,
+                                           const shared_ptr<Interpreter>& interpreter, std::string& error) {
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->Programs = programs;
+    for(const auto& program : programs) {
+        for(const auto& stmt : program->Statements)
+            CollectFunctions(stmt, snapshot->Functions);
+        snapshot->FunctionPrograms.resize(snapshot->Functions.size(), program);
+    }
+
+    SnapshotWriter writer(*snapshot, interpreter->Globals);
+    if(!writer.Write(snapshot->Blob, (uint32_t) snapshot->Functions.size())) {
+        error = writer.Error;
+        return nullptr;
+    }
+
+    return snapshot;
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *        R E S T O R E      * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+class SnapshotReader : public ByteReader {
+public:
+    SnapshotReader(const char* pData, size_t pLength, const Snapshot& pSnapshot, shared_ptr<Interpreter> pInterpreter)
+        : ByteReader(pData, pLength), Source(pSnapshot), Runtime(std::move(pInterpreter)) {}
+
+    // Construct every object, empty. The globals are the interpreter's own.
+    void ReadShells(uint32_t count) {
+        Objects.resize(count);
+        for(uint32_t i = 0; i < count; i++) {
+            Shell& shell = Objects[i];
+            shell.Kind = Raw<uint8_t>();
+
+            switch(shell.Kind) {
+                case SNAP_CONTEXT:
+                    shell.Context = i == 0 ? Runtime->Globals : std::make_shared<ExecutionContext>();
+                    break;
+                case SNAP_FUNCTION: {
+                    uint32_t index = Raw<uint32_t>();
+                    bool constructor = Raw<uint8_t>() != 0;
+                    if(index >= Source.Functions.size()) throw DamagedBytes();
+                    shell.Func = std::make_shared<Function>(Source.Functions[index].get(), nullptr, constructor,
+                                                            Source.FunctionPrograms[index]);
+                    shell.Call = shell.Func;
+                    break;
+                }
+                case SNAP_CLASS:
+                    shell.Class = std::make_shared<FClass>(String(), std::map<std::string, shared_ptr<Function>>(), nullptr);
+                    shell.Call = shell.Class;
+                    break;
+                case SNAP_INSTANCE:
+                    shell.Inst = std::make_shared<Instance>(nullptr);
+                    break;
+                case SNAP_ARRAY:
+                    shell.Arr = std::make_shared<Array>();
+                    break;
+                case SNAP_DICTIONARY:
+                    shell.Dict = std::make_shared<Dictionary>();
+                    break;
+                case SNAP_NATIVE: {
+                    std::string name = String();
+                    auto native = Runtime->Globals->ObjectMap.find(name);
+                    if(native == Runtime->Globals->ObjectMap.end() || native->second.CallableData == nullptr) {
+                        Missing = name;
+                        throw DamagedBytes();
+                    }
+                    shell.Call = native->second.CallableData;
+                    break;
+                }
+                default:
+                    throw DamagedBytes();
+            }
+        }
+
+        if(count == 0 || Objects[0].Kind != SNAP_CONTEXT)
+            throw DamagedBytes();
+    }
+
+    void ReadBodies() {
+        for(Shell& shell : Objects) {
+            switch(shell.Kind) {
+                case SNAP_CONTEXT: {
+                    int32_t enclosing = Raw<int32_t>();
+                    if(enclosing >= 0) shell.Context->Enclosing = Get(enclosing, SNAP_CONTEXT).Context;
+                    uint32_t count = Count();
+                    for(uint32_t i = 0; i < count; i++) {
+                        std::string name = String();
+                        shell.Context->ObjectMap[name] = ReadValue();
+                    }
+                    break;
+                }
+                case SNAP_FUNCTION:
+                    shell.Func->Closure = Get(Raw<uint32_t>(), SNAP_CONTEXT).Context;
+                    break;
+                case SNAP_CLASS: {
+                    int32_t super = Raw<int32_t>();
+                    if(super >= 0) shell.Class->superclass = Get(super, SNAP_CLASS).Class;
+                    uint32_t count = Count();
+                    for(uint32_t i = 0; i < count; i++) {
+                        std::string name = String();
+                        shell.Class->Methods[name] = Get(Raw<uint32_t>(), SNAP_FUNCTION).Func;
+                    }
+                    break;
+                }
+                case SNAP_INSTANCE: {
+                    shell.Inst->fclass = Get(Raw<uint32_t>(), SNAP_CLASS).Class;
+                    uint32_t count = Count();
+                    for(uint32_t i = 0; i < count; i++) {
+                        std::string name = String();
+                        shell.Inst->fields[name] = ReadValue();
+                    }
+                    break;
+                }
+                case SNAP_ARRAY: {
+                    uint32_t count = Count();
+                    for(uint32_t i = 0; i < count; i++)
+                        shell.Arr->push(ReadValue());
+                    break;
+                }
+                case SNAP_DICTIONARY: {
+                    uint32_t count = Count();
+                    Token cause;
+                    cause.Line = 0;
+                    for(uint32_t i = 0; i < count; i++) {
+                        Object key = ReadValue();
+                        DictKey dictKey;
+                        if(!Runtime->DictionaryKey(cause, key, dictKey, true)) throw DamagedBytes();
+                        shell.Dict->set(dictKey, ReadValue());
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    // The native that the restoring interpreter lacks, if that is why the restore failed.
+    std::string Missing;
+
+private:
+    struct Shell {
+        uint8_t Kind = SNAP_NATIVE;
+        shared_ptr<ExecutionContext> Context;
+        shared_ptr<Callable> Call;
+        shared_ptr<Function> Func;
+        shared_ptr<FClass> Class;
+        shared_ptr<Instance> Inst;
+        shared_ptr<Array> Arr;
+        shared_ptr<Dictionary> Dict;
+    };
+
+    const Snapshot& Source;
+    shared_ptr<Interpreter> Runtime;
+    std::vector<Shell> Objects;
+
+    const Shell& Get(uint32_t id, SnapshotKind kind) const {
+        if(id >= Objects.size() || Objects[id].Kind != kind) throw DamagedBytes();
+        return Objects[id];
+    }
+
+    const Shell& Get(uint32_t id) const {
+        if(id >= Objects.size()) throw DamagedBytes();
+        return Objects[id];
+    }
+
+    Object ReadValue() {
+        uint8_t type = Raw<uint8_t>();
+        switch(type) {
+            case Object::StrType: return Object::NewStr(String());
+            case Object::NumType: return Object::NewNum(Raw<double>());
+            case Object::BoolType: return Object::NewBool(Raw<uint8_t>() != 0);
+            case Object::NullType: return Object::Null;
+            case Object::CallableType:
+            case Object::MethodType: {
+                const Shell& shell = Get(Raw<uint32_t>());
+                if(shell.Call == nullptr) throw DamagedBytes();
+                Object value = Object::NewCallable(shell.Call);
+                value.Type = (Object::ObjectTypes) type;
+                return value;
+            }
+            case Object::ClassType: return Object::NewClassDefinition(Get(Raw<uint32_t>(), SNAP_CLASS).Class);
+            case Object::InstanceType: {
+                Object value;
+                value.Type = Object::InstanceType;
+                value.InstanceData = Get(Raw<uint32_t>(), SNAP_INSTANCE).Inst;
+                return value;
+            }
+            case Object::ArrayType: return Object::NewArray(Get(Raw<uint32_t>(), SNAP_ARRAY).Arr);
+            case Object::DictType: return Object::NewDictionary(Get(Raw<uint32_t>(), SNAP_DICTIONARY).Dict);
+            default: throw DamagedBytes();
+        }
+    }
+};
+
+bool RestoreSnapshot(const Snapshot& snapshot, const shared_ptr<Interpreter>& interpreter) {
+    SnapshotHeader header {};
+    if(snapshot.Blob.size() < sizeof(header))
+        return false;
+    memcpy(&header, snapshot.Blob.data(), sizeof(header));
+
+    if(memcmp(header.Magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 || header.Format != SnapshotFormat
+       || header.Functions != snapshot.Functions.size())
+        return false;
+
+    SnapshotReader reader(snapshot.Blob.data() + sizeof(header), snapshot.Blob.size() - sizeof(header), snapshot, interpreter);
+    try {
+        reader.ReadShells(header.Objects);
+        reader.ReadBodies();
+    } catch (DamagedBytes &) {
+        if(!reader.Missing.empty())
+            std::cout << "Unable to restore snapshot: no native named " << reader.Missing << std::endl;
+        return false;
+    }
+
+    return reader.AtEnd();
+}
@@ -0,0 +1,113 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Source.hpp>
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceText::SourceText(std::string text) : Owned(std::move(text)), Data(Owned.data()), Length(Owned.size()) {}
+
+SourceText::~SourceText() {
+    Release();
+}
+
+SourceText::SourceText(SourceText&& other) noexcept {
+    *this = std::move(other);
+}
+
+SourceText& SourceText::operator=(SourceText&& other) noexcept {
+    if(this == &other)
+        return *this;
+
+    Release();
+    Mapped = other.Mapped;
+    Length = other.Length;
+    Owned = std::move(other.Owned);
+    // A short string lives inside the object, so a copy must be pointed at its new home.
+    Data = Mapped ? other.Data : Owned.data();
+
+    other.Owned.clear();
+    other.Data = "";
+    other.Length = 0;
+    other.Mapped = false;
+    return *this;
+}
+
+void SourceText::Release() {
+#ifndef _WIN32
+    if(Mapped)
+        munmap(const_cast<char*>(Data), Length);
+#endif
+    Owned.clear();
+    Data = "";
+    Length = 0;
+    Mapped = false;
+}
+
+bool SourceText::Load(const std::string& path) {
+    Release();
+
+#ifdef _WIN32
+    std::ifstream File(path, std::ios::binary);
+    if(!File)
+        return false;
+
+    *this = SourceText(std::string(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>()));
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat info {};
+    if(fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    if(S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t length = (size_t) info.st_size;
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped != MAP_FAILED) {
+            close(fd);
+            // The lexer reads from front to back, exactly once.
+            madvise(mapped, length, MADV_SEQUENTIAL);
+            Data = static_cast<const char*>(mapped);
+            Length = length;
+            Mapped = true;
+            return true;
+        }
+    }
+
+    // Pipes and terminals have no size to map; read until they run dry.
+    std::string text;
+    char buffer[64 * 1024];
+    for(;;) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if(count == 0)
+            break;
+        if(count < 0 && errno == EINTR)
+            continue;
+        if(count < 0) {
+            close(fd);
+            return false;
+        }
+        text.append(buffer, (size_t) count);
+    }
+
+    close(fd);
+    *this = SourceText(std::move(text));
+    return true;
+#endif
+}
@@ -0,0 +1,127 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Trace.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+std::atomic<TraceLog*> TraceLog::ActiveLog { nullptr };
+
+TraceLog::~TraceLog() {
+    Stop();
+}
+
+bool TraceLog::Start() {
+    TraceLog* none = nullptr;
+    if(!ActiveLog.compare_exchange_strong(none, this))
+        return false;
+
+    Origin = Clock::now();
+    return true;
+}
+
+void TraceLog::Stop() {
+    TraceLog* self = this;
+    ActiveLog.compare_exchange_strong(self, nullptr);
+}
+
+void TraceLog::Record(TraceEvent event) {
+    std::lock_guard<std::mutex> guard(Lock);
+    Events.emplace_back(std::move(event));
+}
+
+// The text of a JSON string, quotes and all.
+static std::string Quote(const std::string& text) {
+    std::string quoted = "\"";
+    for(char c : text) {
+        if(c == '"' || c == '\\') {
+            quoted.push_back('\\');
+            quoted.push_back(c);
+        } else if((unsigned char) c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned) c);
+            quoted.append(escaped);
+        } else {
+            quoted.push_back(c);
+        }
+    }
+    return quoted.append("\"");
+}
+
+static std::string Microseconds(TraceLog::Clock::duration duration) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.3f", (double) std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1000.0);
+    return text;
+}
+
+void TraceLog::WriteJSON(std::ostream& out) {
+    std::lock_guard<std::mutex> guard(Lock);
+
+    // Threads are numbered in the order their first span began, so the thread that ran the program is 1.
+    std::vector<const TraceEvent*> ordered;
+    for(const TraceEvent& event : Events)
+        ordered.emplace_back(&event);
+    std::stable_sort(ordered.begin(), ordered.end(), [](const TraceEvent* a, const TraceEvent* b) {
+        return a->Start < b->Start;
+    });
+
+    std::map<std::thread::id, size_t> threads;
+    for(const TraceEvent* event : ordered)
+        threads.emplace(event->Thread, threads.size() + 1);
+
+    out << "{\"traceEvents\": [\n";
+    out << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"fusco\"}}";
+
+    for(const TraceEvent* event : ordered) {
+        out << ",\n  {\"name\": " << Quote(event->Name) << ", \"cat\": \"" << event->Category
+            << "\", \"ph\": \"X\", \"ts\": " << Microseconds(event->Start - Origin)
+            << ", \"dur\": " << Microseconds(event->Duration)
+            << ", \"pid\": 1, \"tid\": " << threads[event->Thread];
+
+        if(!event->Arguments.empty()) {
+            out << ", \"args\": {";
+            for(size_t i = 0; i < event->Arguments.size(); i++)
+                out << (i == 0 ? "" : ", ") << "\"" << event->Arguments[i].first << "\": " << event->Arguments[i].second;
+            out << "}";
+        }
+        out << "}";
+    }
+
+    out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+void TraceSpan::Begin(TraceLog* log, std::string name, const char* category, bool countAllocations) {
+    Log = log;
+    CountAllocations = countAllocations && Log->CountsAllocations();
+    Event.emplace();
+    Event->Name = std::move(name);
+    Event->Category = category;
+    Event->Thread = std::this_thread::get_id();
+    if(CountAllocations)
+        AllocationsBefore = Log->Allocations();
+    Event->Start = TraceLog::Clock::now();
+}
+
+TraceSpan::~TraceSpan() {
+    if(!Event)
+        return;
+
+    Event->Duration = TraceLog::Clock::now() - Event->Start;
+    if(CountAllocations)
+        Argument("allocations", Log->Allocations() - AllocationsBefore);
+
+    Log->Record(std::move(*Event));
+}
+
+void TraceSpan::Argument(const char* name, uint64_t value) {
+    if(Event)
+        Event->Arguments.emplace_back(name, std::to_string(value));
+}
+
+void TraceSpan::Argument(const char* name, const std::string& value) {
+    if(Event)
+        Event->Arguments.emplace_back(name, Quote(value));
+}
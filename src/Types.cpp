@@ -5,10 +5,16 @@
 
 #include <lexer/Lex.hpp>
 #include <Parse.hpp>
+#include <Program.hpp>
 #include <ast/Expression.hpp>
 #include <interpreter/Interpreter.hpp>
+#include <interpreter/Array.hpp>
+#include <interpreter/Dictionary.hpp>
 #include <utility>
 
+// Never written after static initialisation, so it is safe to share between threads.
+const Object Object::Null;
+
 std::string Object::ToString() {
     switch(Type) {
         case StrType: return StrData;
@@ -16,9 +22,11 @@ std::string Object::ToString() {
         case NullType: return "null";
         case ClassType: return ClassData->Name;
         case InstanceType: return "Instance of " + InstanceData->fclass->Name;
+        case ArrayType: return ArrayData->ToString();
+        case DictType: return DictData->ToString();
         case NumType: return std::to_string(NumData);
         case CallableType: return "callable";
-        case MethodType: return "method " + std::reinterpret_pointer_cast<std::shared_ptr<Function>>(CallableData)->get()->Declaration->Name.Lexeme;
+        case MethodType: return "method " + std::static_pointer_cast<Function>(CallableData)->Declaration->Name.Lexeme;
     }
     return "unknown";
 }
@@ -72,12 +80,35 @@ Object Object::NewInstance(const shared_ptr<FClass>& fclass) {
     return x;
 }
 
+Object Object::NewArray(shared_ptr<Array> array) {
+    Object x;
+    x.Type = ArrayType;
+    x.ArrayData = std::move(array);
+    return x;
+}
+
+Object Object::NewDictionary(shared_ptr<Dictionary> dictionary) {
+    Object x;
+    x.Type = DictType;
+    x.DictData = std::move(dictionary);
+    return x;
+}
+
 Callable::~Callable() = default;
 
-Function::Function(shared_ptr<FuncStatement> pDeclaration, shared_ptr<ExecutionContext> pClosure, bool constr)
-    : Declaration(std::move(pDeclaration)), Closure(std::move(pClosure)), constructor(constr) {}
+const std::string& Callable::name() {
+    static const std::string Native = "native";
+    return Native;
+}
+
+Function::Function(FuncStatement* pDeclaration, shared_ptr<ExecutionContext> pClosure, bool constr,
+                   shared_ptr<const CompiledProgram> pProgram)
+    : Declaration(pDeclaration), Closure(std::move(pClosure)), Program(std::move(pProgram)), constructor(constr) {}
 
 Object Function::call(shared_ptr<Interpreter> interpreter, std::vector<Object> params)  {
+    CompleteFunction(*Declaration);
+    ProgramScope running(*interpreter, Program);
+
     shared_ptr<ExecutionContext> environment = std::make_shared<ExecutionContext>(Closure);
     for(size_t i = 0; i < Declaration->Params.size(); i++) {
         environment->define(Declaration->Params.at(i),
@@ -90,7 +121,7 @@ Object Function::call(shared_ptr<Interpreter> interpreter, std::vector<Object> p
         return value.Value;
     }
 
-    if (constructor) { return environment->getAt(0, "this"); }
+    if (constructor) { return Closure->getAt(0, "this"); }
     return Object::Null;
 }
 
@@ -98,6 +129,10 @@ size_t Function::arguments()  {
     return Declaration->Params.size();
 }
 
+const std::string& Function::name() {
+    return Declaration->Name.Lexeme;
+}
+
 shared_ptr<Function> Function::bind(shared_ptr<Instance> instance) {
     shared_ptr<ExecutionContext> env = std::make_shared<ExecutionContext>(Closure);
     Object obj;
@@ -105,5 +140,9 @@ shared_ptr<Function> Function::bind(shared_ptr<Instance> instance) {
     Token token;
     token.Lexeme = "this";
     env->define(token, obj);
-    return std::make_shared<Function>(Declaration, env, constructor);
+    shared_ptr<Function> bound = std::make_shared<Function>(Declaration, env, constructor, Program);
+#ifdef FUSCO_INSTRUMENT
+    bound->Accounted.Recount(MEM_BOUND, sizeof(Function));
+#endif
+    return bound;
 }
\ No newline at end of file
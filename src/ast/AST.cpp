@@ -6,9 +6,7 @@
 #include <string>
 #include <interpreter/Interpreter.hpp>
 
-static size_t NestLevel = 0;
-
-static std::string nest(const std::string& input) {
+std::string TreePrinter::nest(const std::string& input) {
     std::string temp;
     for(size_t i = 0; i < NestLevel; i++)
         temp.append(" ");
@@ -69,6 +67,12 @@ void TreePrinter::visitFunc(FuncStatement &stmt) {
 
     std::cout << std::endl << "\tBody:" << std::endl;
 
+    // Printing a body must not compile it, or every body would be compiled as the program is loaded.
+    if(stmt.Deferred.load(std::memory_order_acquire) != nullptr) {
+        std::cout << nest("-> ") << "<deferred body>" << std::endl;
+        return;
+    }
+
     for(const shared_ptr<Statement>& statement : stmt.Body) {
         std::cout << nest("-> ");
         statement->accept(shared_from_this());
@@ -91,6 +95,14 @@ void TreePrinter::visitReturn(ReturnStatement &stmt) {
     std::cout << parenthesize("return", &stmt.Value) << std::endl;
 }
 
+void TreePrinter::visitText(TextStatement &stmt) {
+    std::cout << "Text: " << stmt.Text.size() << " bytes" << std::endl;
+}
+
+void TreePrinter::visitEmit(EmitStatement &stmt) {
+    std::cout << "Input resolves to:\t" << parenthesize("emit", &stmt.Expr) << std::endl;
+}
+
 void TreePrinter::visitBlock(BlockStatement &stmt) {
     std::cout << nest("Block starts:") << std::endl;
 
@@ -158,6 +170,23 @@ Object TreePrinter::visitThisExpression(ThisExpression<Object> &expr) {
     return Object::NewStr("bind of \"this\"");
 }
 
+Object TreePrinter::visitArrayExpression(ArrayExpression<Object> &expr) {
+    std::string builder("(array");
+    for(const auto& element : expr.Elements)
+        builder.append(" ").append(element->accept(shared_from_this()).ToString());
+    builder.append(")");
+
+    return Object::NewStr(builder);
+}
+
+Object TreePrinter::visitIndexExpression(IndexExpression<Object> &expr) {
+    return Object::NewStr(parenthesize("index", &expr.Obj, &expr.Index));
+}
+
+Object TreePrinter::visitIndexSetExpression(IndexSetExpression<Object> &expr) {
+    return Object::NewStr(parenthesize("index set", &expr.Obj, &expr.Index, &expr.Value));
+}
+
 template <class... Args>
 std::string TreePrinter::parenthesize(const std::string& Header, Args... args) {
     std::string builder("(");
@@ -0,0 +1,90 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <ast/Arena.hpp>
+#include <cstdint>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+Arena::~Arena() {
+    for(auto it = Destructors.rbegin(); it != Destructors.rend(); ++it)
+        it->Destroy(it->Object);
+
+    for(const Block& block : Blocks) {
+#ifdef _WIN32
+        ::operator delete(block.Memory);
+#else
+        munmap(block.Memory, block.Size);
+#endif
+    }
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(Next) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+
+    if(Next == nullptr || aligned + size > reinterpret_cast<uintptr_t>(Limit)) {
+        // Anything too big for a block gets a block of its own size.
+        size_t blockSize = size + alignment > BlockSize ? size + alignment : BlockSize;
+
+#ifdef _WIN32
+        char* memory = static_cast<char*>(::operator new(blockSize));
+#else
+        // Mapped directly, rather than from malloc, so that the blocks begin and end on page boundaries.
+        void* mapped = mmap(nullptr, blockSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mapped == MAP_FAILED)
+            throw std::bad_alloc();
+        char* memory = static_cast<char*>(mapped);
+#endif
+
+        Blocks.push_back({ memory, blockSize });
+        ReservedBytes += blockSize;
+        Next = memory;
+        Limit = memory + blockSize;
+        aligned = (reinterpret_cast<uintptr_t>(Next) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+    }
+
+    Next = reinterpret_cast<char*>(aligned + size);
+    UsedBytes += size;
+    AllocationCount++;
+    return reinterpret_cast<void*>(aligned);
+}
+
+shared_ptr<Arena> Arena::Spawn() {
+    return Children.emplace_back(std::make_shared<Arena>(BlockSize));
+}
+
+size_t Arena::Reserved() const {
+    size_t bytes = ReservedBytes;
+    for(const shared_ptr<Arena>& child : Children)
+        bytes += child->Reserved();
+    return bytes;
+}
+
+size_t Arena::Used() const {
+    size_t bytes = UsedBytes;
+    for(const shared_ptr<Arena>& child : Children)
+        bytes += child->Used();
+    return bytes;
+}
+
+size_t Arena::Allocations() const {
+    size_t count = AllocationCount;
+    for(const shared_ptr<Arena>& child : Children)
+        count += child->Allocations();
+    return count;
+}
+
+std::vector<std::pair<const char*, const char*>> Arena::Extents() const {
+    std::vector<std::pair<const char*, const char*>> extents;
+    for(const Block& block : Blocks)
+        extents.emplace_back(block.Memory, block.Memory + block.Size);
+    for(const shared_ptr<Arena>& child : Children)
+        for(const auto& extent : child->Extents())
+            extents.emplace_back(extent);
+    return extents;
+}
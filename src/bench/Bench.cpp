@@ -0,0 +1,508 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <lexer/Lex.hpp>
+#include <interpreter/Interpreter.hpp>
+#include <Parse.hpp>
+#include <Source.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+/*
+ * fusco_bench [--size MB] [--iterations N] [--filter text] [--json file] [file]
+ *
+ * Times each stage of the pipeline on its own - Lexer::ConsumeAllAndReturn, Parser::parse,
+ *  Resolver::resolveAll and Interpreter::Interpret - over a set of synthetic scripts of about the given
+ *  size, or over the given file.
+ *
+ * Every benchmark reports the best of its runs in ns/op, where an op is one run of the stage over the
+ *  whole script, the items it went through per second, and what it allocated per op. The items are
+ *  tokens for the lexer, nodes for the parser and the resolver, and whatever the script does for the
+ *  interpreter: calls, instances or iterations of a loop.
+ *
+ * The size is at least 1 MB, and at most 1024; there is at least one iteration. A benchmark that went
+ *  through no items, as an empty file would, reports no items/s.
+ *
+ * The library is built at -O0 unless the build type says otherwise; for numbers worth comparing,
+ *  configure with -DCMAKE_BUILD_TYPE=Release.
+ */
+
+// Every allocation made with new, and the bytes asked for, for the allocations of each op.
+static std::atomic<uint64_t> Allocations { 0 };
+static std::atomic<uint64_t> AllocatedBytes { 0 };
+
+// Optimized, GCC inlines these deletes into their callers and then takes the free for a mismatch.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t size) {
+    Allocations.fetch_add(1, std::memory_order_relaxed);
+    AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t size) noexcept {
+    UNUSED(size);
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t size) noexcept {
+    UNUSED(size);
+    free(memory);
+}
+
+#pragma GCC diagnostic pop
+
+/*
+ * A script to run every stage over, and what the interpreter does with it: how many of what.
+ */
+struct Workload {
+    std::string Name;
+    std::string Source;
+    size_t Work = 0;
+    const char* Unit = "statements";
+};
+
+/*
+ * Variable declarations of arithmetic nested as deep as the parser is likely to see, alternately
+ *  on the left and on the right, with comparisons and negations in between.
+ */
+static Workload DeepExpressions(size_t bytes) {
+    static const char* Operators[] = { " + ", " * ", " - ", " / " };
+    Workload workload { "expressions", "" };
+    for(size_t i = 0; workload.Source.size() < bytes; i++) {
+        std::string expression = std::to_string(i % 97 + 1);
+        for(size_t depth = 1; depth <= 48; depth++) {
+            std::string operand = std::to_string(depth);
+            const char* op = Operators[depth % 4];
+            if(depth % 8 == 0)
+                expression = "-(" + expression + ")";
+            else if(depth % 2 == 0)
+                expression = "(" + expression + op + operand + ")";
+            else
+                expression = "(" + operand + op + expression + ")";
+        }
+        workload.Source += "var e" + std::to_string(i) + " = " + expression + " > 0 and !false;\n";
+        workload.Work++;
+    }
+    workload.Unit = "expressions";
+    return workload;
+}
+
+/*
+ * Declarations of string literals of a few kilobytes each, some joined to the one before.
+ */
+static Workload LongStrings(size_t bytes) {
+    static const char* Words[] = { "lorem ", "ipsum ", "dolor ", "sit ", "amet, ", "<p class='x'>", "&amp; ", "</p>\n" };
+    Workload workload { "strings", "" };
+    for(size_t i = 0; workload.Source.size() < bytes; i++) {
+        std::string literal;
+        for(size_t word = i; literal.size() < 1024 + (i % 4) * 1024; word = word * 7 + 3)
+            literal += Words[word % 8];
+
+        std::string n = std::to_string(i);
+        workload.Source += "var s" + n + " = \"" + literal + "\";\n";
+        if(i > 0)
+            workload.Source += "var j" + n + " = s" + std::to_string(i - 1) + " + s" + n + ";\n";
+        workload.Work++;
+    }
+    workload.Unit = "literals";
+    return workload;
+}
+
+/*
+ * Many small functions, each called once from the top level as soon as it is declared.
+ */
+static Workload ManyFunctions(size_t bytes) {
+    Workload workload { "functions", "var total = 0;\n" };
+    for(size_t i = 0; workload.Source.size() < bytes; i++) {
+        std::string n = std::to_string(i);
+        workload.Source += "func f" + n + "(a, b) {\n"
+                           "    var c = a * b + " + n + ";\n"
+                           "    if (c > " + n + ") {\n"
+                           "        return c - " + n + ";\n"
+                           "    }\n"
+                           "    return c;\n"
+                           "}\n"
+                           "total = total + f" + n + "(" + std::to_string(i % 13) + ", 2);\n";
+        workload.Work++;
+    }
+    workload.Unit = "calls";
+    return workload;
+}
+
+/*
+ * A base class and many subclasses of it, each instantiated and made to make another instance.
+ */
+static Workload ClassHeavy(size_t bytes) {
+    Workload workload { "classes", "class Shape {\n"
+                                   "    Shape() { this.kind = \"shape\"; }\n"
+                                   "    describe() { return this.kind; }\n"
+                                   "}\n"
+                                   "var total = 0;\n" };
+    for(size_t i = 0; workload.Source.size() < bytes; i++) {
+        std::string n = std::to_string(i);
+        workload.Source += "class Shape" + n + " extends Shape {\n"
+                           "    Shape" + n + "(w, h) {\n"
+                           "        this.w = w;\n"
+                           "        this.h = h;\n"
+                           "    }\n"
+                           "    area() { return this.w * this.h + " + n + "; }\n"
+                           "    scale(k) { return Shape" + n + "(this.w * k, this.h * k); }\n"
+                           "}\n"
+                           "var shape" + n + " = Shape" + n + "(" + std::to_string(i % 7 + 1) + ", 2);\n"
+                           "total = total + shape" + n + ".scale(2).area();\n";
+        workload.Work += 2;
+    }
+    workload.Unit = "instances";
+    return workload;
+}
+
+/*
+ * A short script that spends its time in loops: counting, nested, while, and over an array.
+ *  The loops run longer the larger the size, rather than the script growing.
+ */
+static Workload TightLoops(size_t bytes) {
+    size_t count = std::max<size_t>(bytes / 64, 16);
+    size_t side = 1;
+    while((side + 1) * (side + 1) <= count)
+        side++;
+
+    std::string n = std::to_string(count);
+    std::string s = std::to_string(side);
+    Workload workload { "loops", "var sum = 0;\n"
+                                 "for (var i = 0; i < " + n + "; i = i + 1) {\n"
+                                 "    sum = sum + i * 2;\n"
+                                 "}\n"
+                                 "for (var x = 0; x < " + s + "; x = x + 1) {\n"
+                                 "    for (var y = 0; y < " + s + "; y = y + 1) {\n"
+                                 "        if (x =? y) sum = sum + 1;\n"
+                                 "    }\n"
+                                 "}\n"
+                                 "var w = " + n + ";\n"
+                                 "while (w > 0) {\n"
+                                 "    w = w - 1;\n"
+                                 "}\n"
+                                 "var items = [];\n"
+                                 "for (var p = 0; p < " + n + "; p = p + 1) {\n"
+                                 "    items.push(p);\n"
+                                 "}\n"
+                                 "for (var q = 0; q < items.length; q = q + 1) {\n"
+                                 "    sum = sum + items[q];\n"
+                                 "}\n" };
+    workload.Work = count * 4 + side * side;
+    workload.Unit = "iterations";
+    return workload;
+}
+
+/*
+ * Replays tokens lexed beforehand, so that the parser is timed without the lexer.
+ */
+class TokenReplay : public TokenSource {
+public:
+    explicit TokenReplay(const std::vector<struct Token>& pTokens) : Tokens(pTokens) {}
+
+    void Next(struct Token& out) override {
+        out = Tokens[Position];
+        if(Position + 1 < Tokens.size())
+            Position++;
+    }
+
+private:
+    const std::vector<struct Token>& Tokens;
+    size_t Position = 0;
+};
+
+// Output goes nowhere, so that printing costs no more than the formatting of it.
+class NullSink : public OutputSink {
+public:
+    void Write(const char* data, size_t length) override { UNUSED(data); UNUSED(length); }
+};
+
+// A tree and the Arena its nodes live in, which must be the last to go.
+struct ParsedTree {
+    shared_ptr<Arena> Nodes = std::make_shared<Arena>();
+    std::vector<shared_ptr<Statement>> Statements;
+};
+
+struct Result {
+    std::string Name;
+    std::string Script;
+    const char* Stage;
+    size_t Bytes;
+    size_t Iterations;
+    double Nanoseconds;
+    size_t Items;
+    const char* Unit;
+    uint64_t Allocations;
+    uint64_t AllocatedBytes;
+
+    [[nodiscard]] double ItemsPerSecond() const { return (double) Items / (Nanoseconds / 1e9); }
+};
+
+/*
+ * Runs an op iterations times, and keeps the best time. What the op returns is destroyed after the
+ *  clock stops, so tearing down a tree or an interpreter is not counted as part of making it.
+ * The allocations are those of the last run; every run of an op allocates the same.
+ */
+template <typename F>
+static Result Measure(size_t iterations, F&& op) {
+    Result result {};
+    result.Iterations = iterations;
+    for(size_t i = 0; i < iterations; i++) {
+        uint64_t allocations = Allocations.load(std::memory_order_relaxed);
+        uint64_t bytes = AllocatedBytes.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        auto product = op();
+        double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        result.Allocations = Allocations.load(std::memory_order_relaxed) - allocations;
+        result.AllocatedBytes = AllocatedBytes.load(std::memory_order_relaxed) - bytes;
+        if(i == 0 || nanoseconds < result.Nanoseconds)
+            result.Nanoseconds = nanoseconds;
+    }
+    return result;
+}
+
+class Bench {
+public:
+    Bench(size_t pIterations, std::string pFilter) : Iterations(pIterations), Filter(std::move(pFilter)) {}
+
+    std::vector<Result> Results;
+
+    /**
+     * Every stage, each over what the one before made.
+     * @return false if the script did not get through a stage; the stages after it are not run.
+     */
+    bool Run(const Workload& workload) {
+        std::string_view source = workload.Source;
+
+        Lexer lexer(source);
+        std::vector<struct Token> tokens = lexer.ConsumeAllAndReturn();
+        if(lexer.ErrorState)
+            return Failed(workload, "lexing");
+
+        ParsedTree tree;
+        {
+            TokenReplay replay(tokens);
+            Parser parser(replay, tree.Nodes);
+            tree.Statements = parser.parse();
+            if(parser.ErrorState)
+                return Failed(workload, "parsing");
+        }
+        size_t nodes = tree.Nodes->Allocations();
+
+        auto resolver = std::make_shared<Resolver>();
+        try {
+            resolver->resolveAll(tree.Statements);
+        } catch (RuntimeError &) {
+            // Already reported by the Resolver.
+        }
+        if(resolver->ErrorState)
+            return Failed(workload, "resolving");
+
+        Stage(workload, "lexer", tokens.size(), "tokens", [&]() {
+            Lexer timed(source);
+            return timed.ConsumeAllAndReturn();
+        });
+
+        Stage(workload, "parser", nodes, "nodes", [&]() {
+            TokenReplay replay(tokens);
+            ParsedTree timed;
+            Parser parser(replay, timed.Nodes);
+            timed.Statements = parser.parse();
+            return timed;
+        });
+
+        // Resolving the same tree again stores the same depths in it.
+        Stage(workload, "resolver", nodes, "nodes", [&]() {
+            auto timed = std::make_shared<Resolver>();
+            timed->resolveAll(tree.Statements);
+            return timed;
+        });
+
+        // A file does what it does; all that is known of it is how many statements it has.
+        size_t work = workload.Work == 0 ? tree.Statements.size() : workload.Work;
+        bool failed = false;
+        Stage(workload, "interpreter", work, workload.Unit, [&]() {
+            auto interpreter = std::make_shared<Interpreter>(std::make_shared<ExecutionContext>());
+            interpreter->Output = std::make_shared<NullSink>();
+            interpreter->Interpret(tree.Statements);
+            failed = failed || interpreter->ErrorState;
+            return interpreter;
+        });
+
+        return !failed || Failed(workload, "running");
+    }
+
+    void Print() const {
+        printf("%-24s %14s %16s %-12s %14s %12s\n", "benchmark", "ns/op", "items/s", "", "bytes/op", "allocs/op");
+        for(const Result& result: Results) {
+            char rate[32] = "-";
+            if(result.Items != 0)
+                snprintf(rate, sizeof(rate), "%.0f", result.ItemsPerSecond());
+            printf("%-24s %14.0f %16s %-12s %14llu %12llu\n", result.Name.c_str(), result.Nanoseconds,
+                   rate, result.Unit, (unsigned long long) result.AllocatedBytes,
+                   (unsigned long long) result.Allocations);
+        }
+    }
+
+    // {"context": {...}, "benchmarks": [{"name", "script", "stage", ...}]}, to compare runs with.
+    void WriteJSON(std::ostream& out, const std::string& path) const {
+#ifdef __OPTIMIZE__
+        const char* optimized = "true";
+#else
+        const char* optimized = "false";
+#endif
+        out << "{\"context\": {\"source\": \"" << Escape(path.empty() ? "synthetic" : path) << "\", \"iterations\": "
+            << Iterations << ", \"optimized\": " << optimized << "},\n \"benchmarks\": [";
+        for(size_t i = 0; i < Results.size(); i++) {
+            const Result& result = Results[i];
+            out << (i == 0 ? "\n  " : ",\n  ")
+                << "{\"name\": \"" << Escape(result.Name) << "\", \"script\": \"" << Escape(result.Script)
+                << "\", \"stage\": \"" << result.Stage << "\", \"script_bytes\": " << result.Bytes
+                << ", \"iterations\": " << result.Iterations << ", \"ns_per_op\": " << (uint64_t) result.Nanoseconds
+                << ", \"items_per_op\": " << result.Items << ", \"item\": \"" << result.Unit
+                << "\", \"items_per_second\": ";
+            if(result.Items != 0)
+                out << (uint64_t) result.ItemsPerSecond();
+            else
+                out << "null";
+            out << ", \"bytes_allocated_per_op\": " << result.AllocatedBytes
+                << ", \"allocations_per_op\": " << result.Allocations << "}";
+        }
+        out << "\n ]}\n";
+    }
+
+private:
+    size_t Iterations;
+    std::string Filter;
+
+    template <typename F>
+    void Stage(const Workload& workload, const char* stage, size_t items, const char* unit, F&& op) {
+        std::string name = std::string(stage) + "/" + workload.Name;
+        if(name.find(Filter) == std::string::npos)
+            return;
+
+        Result result = Measure(Iterations, std::forward<F>(op));
+        result.Name = name;
+        result.Script = workload.Name;
+        result.Stage = stage;
+        result.Bytes = workload.Source.size();
+        result.Items = items;
+        result.Unit = unit;
+        Results.emplace_back(result);
+    }
+
+    static bool Failed(const Workload& workload, const char* stage) {
+        printf("%s: failed while %s; skipped.\n", workload.Name.c_str(), stage);
+        return false;
+    }
+
+    static std::string Escape(const std::string& text) {
+        std::string escaped;
+        for(char c: text) {
+            if(c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+};
+
+// A whole number in [minimum, maximum], or false for anything else.
+static bool ParseCount(const char* text, size_t minimum, size_t maximum, size_t& count) {
+    const char* end = text + strlen(text);
+    auto [last, error] = std::from_chars(text, end, count);
+    return error == std::errc() && last == end && count >= minimum && count <= maximum;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = 1;
+    size_t iterations = 5;
+    std::string filter;
+    std::string jsonPath;
+    std::string path;
+
+    for(int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(flag == "--size" && hasValue) {
+            if(!ParseCount(argv[++i], 1, 1024, megabytes)) {
+                printf("--size must be a whole number of megabytes from 1 to 1024, not %s\n", argv[i]);
+                return 1;
+            }
+        } else if(flag == "--iterations" && hasValue) {
+            if(!ParseCount(argv[++i], 1, SIZE_MAX, iterations)) {
+                printf("--iterations must be a whole number of at least 1, not %s\n", argv[i]);
+                return 1;
+            }
+        } else if(flag == "--filter" && hasValue) filter = argv[++i];
+        else if(flag == "--json" && hasValue) jsonPath = argv[++i];
+        else if(flag.rfind("--", 0) != 0) path = flag;
+        else {
+            printf("Unknown option %s\n", flag.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<Workload> workloads;
+    if(path.empty()) {
+        size_t bytes = megabytes * 1024 * 1024;
+        for(auto make: { DeepExpressions, LongStrings, ManyFunctions, ClassHeavy, TightLoops })
+            workloads.emplace_back(make(bytes));
+    } else {
+        SourceText source;
+        if(!source.Load(path)) {
+            printf("Unable to read %s\n", path.c_str());
+            return 1;
+        }
+        workloads.push_back({ "file", std::string(source.View()) });
+    }
+
+    Bench bench(iterations, filter);
+    for(const Workload& workload: workloads)
+        bench.Run(workload);
+
+    printf("%s, best of %zu\n", path.empty() ? "synthetic scripts" : path.c_str(), iterations);
+    bench.Print();
+
+    if(!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        bench.WriteJSON(out, path);
+        if(!out) {
+            printf("Unable to write %s\n", jsonPath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
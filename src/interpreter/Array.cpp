@@ -0,0 +1,99 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Array.hpp>
+#include <utility>
+
+Array::Array(std::vector<Object> elements) {
+    for(const Object& element : elements) {
+        if(element.Type != Object::NumType) {
+            Packed = false;
+            break;
+        }
+    }
+
+    if(Packed) {
+        Numbers.reserve(elements.size());
+        for(const Object& element : elements)
+            Numbers.push_back(element.NumData);
+    } else {
+        Elements = std::move(elements);
+    }
+}
+
+Object Array::at(size_t index) const {
+    if(Packed)
+        return Object::NewNum(Numbers[index]);
+    return Elements[index];
+}
+
+void Array::set(size_t index, const Object& value) {
+    if(Packed && value.Type != Object::NumType)
+        Box();
+
+    if(Packed) {
+        if(index == Numbers.size()) Numbers.push_back(value.NumData);
+        else Numbers[index] = value.NumData;
+    } else {
+        if(index == Elements.size()) Elements.push_back(value);
+        else Elements[index] = value;
+    }
+}
+
+void Array::push(const Object& value) {
+    set(length(), value);
+}
+
+Object Array::pop() {
+    if(length() == 0)
+        return Object::Null;
+
+    if(Packed) {
+        double last = Numbers.back();
+        Numbers.pop_back();
+        return Object::NewNum(last);
+    }
+
+    Object last = std::move(Elements.back());
+    Elements.pop_back();
+    return last;
+}
+
+std::string Array::ToString() const {
+    std::string builder("[");
+    for(size_t i = 0; i < length(); i++) {
+        if(i != 0) builder.append(", ");
+        builder.append(at(i).ToString());
+    }
+    builder.append("]");
+    return builder;
+}
+
+/*
+ * Convert packed storage into boxed storage, so that non-numbers may be stored.
+ */
+void Array::Box() {
+    Elements.reserve(Numbers.size());
+    for(double number : Numbers)
+        Elements.emplace_back(Object::NewNum(number));
+
+    Numbers.clear();
+    Numbers.shrink_to_fit();
+    Packed = false;
+}
+
+Object ArrayMethod::call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) {
+    UNUSED(interpreter);
+
+    switch(Method) {
+        case PUSH:
+            Target->push(arguments.at(0));
+            return Object::NewNum((double) Target->length());
+        case POP:
+            return Target->pop();
+    }
+
+    return Object::Null;
+}
@@ -0,0 +1,397 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Dictionary.hpp>
+#include <interpreter/Interpreter.hpp>
+#include <interpreter/Array.hpp>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FUSCO_DICT_SSE2
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *         H A S H I N G     * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+static uint64_t Mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t Rotate(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+/*
+ * Hashes a run of bytes, eight at a time.
+ */
+uint64_t HashBytes(const char* data, size_t length) {
+    const uint64_t C1 = 0x87c37b91114253d5ULL;
+    const uint64_t C2 = 0x4cf5ad432745937fULL;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (length * C1);
+
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        uint64_t k;
+        std::memcpy(&k, data + i, 8);
+        h ^= Rotate(k * C1, 31) * C2;
+        h = Rotate(h, 27) * 5 + 0x52dce729;
+    }
+
+    uint64_t tail = 0;
+    for(size_t shift = 0; i < length; i++, shift += 8)
+        tail |= (uint64_t) (unsigned char) data[i] << shift;
+    h ^= Rotate(tail * C1, 31) * C2;
+
+    return Mix(h);
+}
+
+uint64_t HashNumber(double number) {
+    // 0 and -0 compare equal, so they must hash equal.
+    if(number == 0) number = 0;
+
+    uint64_t bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+    return Mix(bits);
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *    S T R I N G   P O O L  * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * The slot of the string, which is put in found, or else the slot to put it in: the first whose
+ *  string has gone, or the empty slot that ended the probe.
+ */
+size_t StringPool::Probe(const std::string& text, uint64_t hash, shared_ptr<const InternedString>& found) const {
+    size_t mask = Slots.size() - 1;
+    size_t index = hash & mask;
+    size_t free = Slots.size();
+
+    while(Slots[index].Used) {
+        if(shared_ptr<const InternedString> interned = Slots[index].String.lock()) {
+            if(Slots[index].Hash == hash && interned->Text == text) {
+                found = std::move(interned);
+                return index;
+            }
+        } else if(free == Slots.size()) {
+            free = index;
+        }
+        index = (index + 1) & mask;
+    }
+
+    return free == Slots.size() ? index : free;
+}
+
+/*
+ * Makes a table for the strings still in use, with room for as many again; it shrinks if most have gone.
+ */
+void StringPool::Rebuild() {
+    std::vector<Slot> old = std::move(Slots);
+
+    size_t live = 0;
+    for(const Slot& slot : old)
+        live += slot.Used && !slot.String.expired();
+
+    size_t capacity = 64;
+    while(capacity < live * 4)
+        capacity *= 2;
+
+    Slots = std::vector<Slot>(capacity);
+    Used = 0;
+    for(Slot& slot : old) {
+        if(!slot.Used || slot.String.expired())
+            continue;
+
+        size_t index = slot.Hash & (capacity - 1);
+        while(Slots[index].Used)
+            index = (index + 1) & (capacity - 1);
+        Slots[index] = std::move(slot);
+        Used++;
+    }
+}
+
+shared_ptr<const InternedString> StringPool::Intern(const std::string& text) {
+    if((Used + 1) * 2 > Slots.size())
+        Rebuild();
+
+    uint64_t hash = HashBytes(text.data(), text.size());
+    shared_ptr<const InternedString> found;
+    size_t index = Probe(text, hash, found);
+    if(found != nullptr)
+        return found;
+
+    found = std::make_shared<const InternedString>(InternedString { text, hash });
+    if(!Slots[index].Used)
+        Used++;
+    Slots[index] = Slot { found, hash, true };
+    return found;
+}
+
+shared_ptr<const InternedString> StringPool::Find(const std::string& text) const {
+    shared_ptr<const InternedString> found;
+    if(!Slots.empty())
+        Probe(text, HashBytes(text.data(), text.size()), found);
+    return found;
+}
+
+size_t StringPool::size() const {
+    size_t live = 0;
+    for(const Slot& slot : Slots)
+        live += slot.Used && !slot.String.expired();
+    return live;
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *     D I C T I O N A R Y   * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+bool DictKey::operator==(const DictKey& other) const {
+    if(isString())
+        return Str == other.Str;
+    return !other.isString() && Num == other.Num;
+}
+
+Object DictKey::ToObject() const {
+    if(isString())
+        return Object::NewStr(Str->Text);
+    return Object::NewNum(Num);
+}
+
+static constexpr int8_t CtrlEmpty = -128;
+static constexpr int8_t CtrlDeleted = -2;
+
+static inline int8_t H2(uint64_t hash) { return (int8_t) (hash & 0x7F); }
+static inline uint64_t H1(uint64_t hash) { return hash >> 7; }
+
+/*
+ * Returns a bitmask of every control word in the group that equals the given value.
+ */
+static inline uint32_t MatchGroup(const int8_t* group, int8_t value) {
+#ifdef FUSCO_DICT_SSE2
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < 16; i++)
+        if(group[i] == value) mask |= 1u << i;
+    return mask;
+#endif
+}
+
+/*
+ * Returns a bitmask of every control word in the group that is empty or deleted.
+ * Both have the top bit set, and full words never do.
+ */
+static inline uint32_t MatchFree(const int8_t* group) {
+#ifdef FUSCO_DICT_SSE2
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return (uint32_t) _mm_movemask_epi8(ctrl);
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < 16; i++)
+        if(group[i] < 0) mask |= 1u << i;
+    return mask;
+#endif
+}
+
+static inline int LowestBit(uint32_t mask) {
+    return __builtin_ctz(mask);
+}
+
+Dictionary::Dictionary() {
+    Control.assign(GroupWidth, CtrlEmpty);
+    Slots.assign(GroupWidth, 0);
+}
+
+size_t Dictionary::Find(const DictKey& key) const {
+    size_t groupMask = Control.size() / GroupWidth - 1;
+    size_t group = H1(key.Hash) & groupMask;
+    int8_t tag = H2(key.Hash);
+
+    for(size_t probe = 1; probe <= groupMask + 1; probe++) {
+        const int8_t* ctrl = &Control[group * GroupWidth];
+
+        for(uint32_t match = MatchGroup(ctrl, tag); match != 0; match &= match - 1) {
+            size_t slot = group * GroupWidth + LowestBit(match);
+            if(Entries[Slots[slot]].Key == key)
+                return slot;
+        }
+
+        // An empty word means the key was never pushed past this group.
+        if(MatchGroup(ctrl, CtrlEmpty) != 0)
+            break;
+
+        group = (group + probe) & groupMask;
+    }
+
+    return SIZE_MAX;
+}
+
+void Dictionary::Place(uint64_t hash, uint32_t entry) {
+    size_t groupMask = Control.size() / GroupWidth - 1;
+    size_t group = H1(hash) & groupMask;
+
+    for(size_t probe = 1; ; probe++) {
+        uint32_t free = MatchFree(&Control[group * GroupWidth]);
+        if(free != 0) {
+            size_t slot = group * GroupWidth + LowestBit(free);
+            if(Control[slot] == CtrlEmpty) Used++;
+            Control[slot] = H2(hash);
+            Slots[slot] = entry;
+            return;
+        }
+
+        group = (group + probe) & groupMask;
+    }
+}
+
+/*
+ * Rebuild the index at the given capacity, and squeeze deleted entries out of the entry list.
+ */
+void Dictionary::Rehash(size_t capacity) {
+    if(Live != Entries.size()) {
+        std::vector<Entry> compacted;
+        compacted.reserve(Live);
+        for(Entry& entry : Entries)
+            if(entry.Alive) compacted.emplace_back(std::move(entry));
+        Entries = std::move(compacted);
+    }
+
+    Control.assign(capacity, CtrlEmpty);
+    Slots.assign(capacity, 0);
+    Used = 0;
+
+    for(size_t i = 0; i < Entries.size(); i++)
+        Place(Entries[i].Key.Hash, (uint32_t) i);
+}
+
+bool Dictionary::get(const DictKey& key, Object& value) const {
+    size_t slot = Find(key);
+    if(slot == SIZE_MAX)
+        return false;
+
+    value = Entries[Slots[slot]].Value;
+    return true;
+}
+
+void Dictionary::set(const DictKey& key, const Object& value) {
+    size_t slot = Find(key);
+    if(slot != SIZE_MAX) {
+        Entries[Slots[slot]].Value = value;
+        return;
+    }
+
+    // Keep the index at most 7/8 full. If most of that is deletion markers, rehash in place.
+    size_t capacity = Control.size();
+    if((Used + 1) * 8 > capacity * 7)
+        Rehash((Live + 1) * 16 > capacity * 7 ? capacity * 2 : capacity);
+
+    Entries.push_back(Entry { key, value, true });
+    Live++;
+    Place(key.Hash, (uint32_t) (Entries.size() - 1));
+}
+
+bool Dictionary::remove(const DictKey& key) {
+    size_t slot = Find(key);
+    if(slot == SIZE_MAX)
+        return false;
+
+    Entry& entry = Entries[Slots[slot]];
+    entry.Alive = false;
+    entry.Key = DictKey();
+    entry.Value = Object::Null;
+
+    Control[slot] = CtrlDeleted;
+    Live--;
+
+    if(Entries.size() > 32 && Live * 2 < Entries.size())
+        Rehash(Control.size());
+
+    return true;
+}
+
+std::vector<Object> Dictionary::keys() const {
+    std::vector<Object> result;
+    result.reserve(Live);
+    for(const Entry& entry : Entries)
+        if(entry.Alive) result.emplace_back(entry.Key.ToObject());
+    return result;
+}
+
+std::vector<Object> Dictionary::values() const {
+    std::vector<Object> result;
+    result.reserve(Live);
+    for(const Entry& entry : Entries)
+        if(entry.Alive) result.emplace_back(entry.Value);
+    return result;
+}
+
+std::string Dictionary::ToString() const {
+    std::string builder("{");
+    bool first = true;
+    for(const Entry& entry : Entries) {
+        if(!entry.Alive) continue;
+        if(!first) builder.append(", ");
+        first = false;
+        builder.append(entry.Key.ToObject().ToString()).append(": ").append(Object(entry.Value).ToString());
+    }
+    builder.append("}");
+    return builder;
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *       M E T H O D S       * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+size_t DictionaryMethod::arguments() {
+    switch(Method) {
+        case SET: return 2;
+        case GET:
+        case HAS:
+        case DELETE: return 1;
+        case KEYS:
+        case VALUES: return 0;
+    }
+    return 0;
+}
+
+Object DictionaryMethod::call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) {
+    Token cause;
+    cause.Type = LI_IDENTIFIER;
+    cause.Line = 0;
+    cause.Lexeme = "Dictionary method";
+
+    DictKey key;
+    Object value;
+
+    switch(Method) {
+        case GET:
+            if(interpreter->DictionaryKey(cause, arguments.at(0), key, false) && Target->get(key, value))
+                return value;
+            return Object::Null;
+        case SET:
+            interpreter->DictionaryKey(cause, arguments.at(0), key, true);
+            Target->set(key, arguments.at(1));
+            return arguments.at(1);
+        case HAS:
+            return Object::NewBool(interpreter->DictionaryKey(cause, arguments.at(0), key, false) && Target->get(key, value));
+        case DELETE:
+            return Object::NewBool(interpreter->DictionaryKey(cause, arguments.at(0), key, false) && Target->remove(key));
+        case KEYS:
+            return Object::NewArray(std::make_shared<Array>(Target->keys()));
+        case VALUES:
+            return Object::NewArray(std::make_shared<Array>(Target->values()));
+    }
+
+    return Object::Null;
+}
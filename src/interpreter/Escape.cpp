@@ -0,0 +1,260 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Escape.hpp>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define FUSCO_ESCAPE_X86
+#include <immintrin.h>
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *        T A B L E S        * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+// What each byte is written as; empty for a byte that is written as it is.
+using Replacements = std::array<std::string_view, 256>;
+
+static constexpr Replacements HtmlReplacements = []() {
+    Replacements replacements {};
+    replacements['&'] = "&amp;";
+    replacements['<'] = "&lt;";
+    replacements['>'] = "&gt;";
+    replacements['"'] = "&quot;";
+    replacements['\''] = "&#39;";
+    return replacements;
+}();
+
+// Without quotes, an attribute value ends at whitespace or >, and = or ` may confuse older parsers.
+static constexpr Replacements AttrReplacements = []() {
+    Replacements replacements = HtmlReplacements;
+    replacements[' '] = "&#32;";
+    replacements['\t'] = "&#9;";
+    replacements['\n'] = "&#10;";
+    replacements['\f'] = "&#12;";
+    replacements['\r'] = "&#13;";
+    replacements['='] = "&#61;";
+    replacements['`'] = "&#96;";
+    return replacements;
+}();
+
+static constexpr bool IsUnreserved(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+static constexpr std::array<std::array<char, 3>, 256> PercentCodes = []() {
+    constexpr char hex[] = "0123456789ABCDEF";
+    std::array<std::array<char, 3>, 256> codes {};
+    for(int c = 0; c < 256; c++)
+        codes[c] = { '%', hex[c >> 4], hex[c & 15] };
+    return codes;
+}();
+
+static constexpr Replacements UrlReplacements = []() {
+    Replacements replacements {};
+    for(int c = 0; c < 256; c++)
+        if(!IsUnreserved(c))
+            replacements[c] = std::string_view(PercentCodes[c].data(), 3);
+    return replacements;
+}();
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *        S C A L A R        * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * Every finder reads text[from] up to text[length - 1], and returns the offset of the first byte
+ *  that must be escaped, or length if none must.
+ */
+using Finder = size_t (*)(const char* text, size_t from, size_t length);
+
+static size_t FindScalar(const Replacements& replacements, const char* text, size_t from, size_t length) {
+    while(from < length && replacements[(unsigned char) text[from]].empty())
+        from++;
+    return from;
+}
+
+static size_t FindHtmlScalar(const char* text, size_t from, size_t length) {
+    return FindScalar(HtmlReplacements, text, from, length);
+}
+
+static size_t FindAttrScalar(const char* text, size_t from, size_t length) {
+    return FindScalar(AttrReplacements, text, from, length);
+}
+
+static size_t FindUrlScalar(const char* text, size_t from, size_t length) {
+    return FindScalar(UrlReplacements, text, from, length);
+}
+
+#ifdef FUSCO_ESCAPE_X86
+
+/*
+ * Each vector finder builds a mask with a bit set for every byte that must be escaped, and skips
+ *  whole blocks while none is; the last part block is left to the scalar version.
+ */
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *          S S E 2          * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+static __m128i HtmlMaskSSE2(__m128i block) {
+    __m128i markup = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('&')), _mm_cmpeq_epi8(block, _mm_set1_epi8('<'))),
+                                  _mm_cmpeq_epi8(block, _mm_set1_epi8('>')));
+    __m128i quotes = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\'')));
+    return _mm_or_si128(markup, quotes);
+}
+
+static __m128i AttrMaskSSE2(__m128i block) {
+    __m128i white = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+                                 _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+    __m128i other = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\f')), _mm_cmpeq_epi8(block, _mm_set1_epi8('='))),
+                                 _mm_cmpeq_epi8(block, _mm_set1_epi8('`')));
+    return _mm_or_si128(HtmlMaskSSE2(block), _mm_or_si128(white, other));
+}
+
+static __m128i UrlMaskSSE2(__m128i block) {
+    // Signed comparisons, so bytes over 0x7F are never letters or digits.
+    __m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), folded));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), block));
+    __m128i marks = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('-')), _mm_cmpeq_epi8(block, _mm_set1_epi8('.'))),
+                                 _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('_')), _mm_cmpeq_epi8(block, _mm_set1_epi8('~'))));
+    __m128i clean = _mm_or_si128(_mm_or_si128(letter, digit), marks);
+    return _mm_xor_si128(clean, _mm_set1_epi8(-1));
+}
+
+template <__m128i (*Mask)(__m128i), size_t (*Scalar)(const char*, size_t, size_t)>
+static size_t FindSSE2(const char* text, size_t from, size_t length) {
+    for(; from + 16 <= length; from += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+        unsigned escape = (unsigned) _mm_movemask_epi8(Mask(block));
+        if(escape != 0)
+            return from + (unsigned) __builtin_ctz(escape);
+    }
+
+    return Scalar(text, from, length);
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *          A V X 2          * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static __m256i HtmlMaskAVX2(__m256i block) {
+    __m256i markup = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('&')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('<'))),
+                                     _mm256_cmpeq_epi8(block, _mm256_set1_epi8('>')));
+    __m256i quotes = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\'')));
+    return _mm256_or_si256(markup, quotes);
+}
+
+AVX2 static __m256i AttrMaskAVX2(__m256i block) {
+    __m256i white = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+    __m256i other = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\f')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('='))),
+                                    _mm256_cmpeq_epi8(block, _mm256_set1_epi8('`')));
+    return _mm256_or_si256(HtmlMaskAVX2(block), _mm256_or_si256(white, other));
+}
+
+AVX2 static __m256i UrlMaskAVX2(__m256i block) {
+    __m256i folded = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), block));
+    __m256i marks = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('-')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('.'))),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('~'))));
+    __m256i clean = _mm256_or_si256(_mm256_or_si256(letter, digit), marks);
+    return _mm256_xor_si256(clean, _mm256_set1_epi8(-1));
+}
+
+template <__m256i (*Mask)(__m256i), size_t (*Narrower)(const char*, size_t, size_t)>
+AVX2 static size_t FindAVX2(const char* text, size_t from, size_t length) {
+    for(; from + 32 <= length; from += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + from));
+        unsigned escape = (unsigned) _mm256_movemask_epi8(Mask(block));
+        if(escape != 0)
+            return from + (unsigned) __builtin_ctz(escape);
+    }
+
+    return Narrower(text, from, length);
+}
+
+#undef AVX2
+
+#endif
+
+struct EscapeFinders {
+    Finder Html;
+    Finder Attr;
+    Finder Url;
+};
+
+static const EscapeFinders ScalarFinders = { FindHtmlScalar, FindAttrScalar, FindUrlScalar };
+#ifdef FUSCO_ESCAPE_X86
+static const EscapeFinders SSE2Finders = {
+    FindSSE2<HtmlMaskSSE2, FindHtmlScalar>, FindSSE2<AttrMaskSSE2, FindAttrScalar>, FindSSE2<UrlMaskSSE2, FindUrlScalar>
+};
+static const EscapeFinders AVX2Finders = {
+    FindAVX2<HtmlMaskAVX2, FindSSE2<HtmlMaskSSE2, FindHtmlScalar>>,
+    FindAVX2<AttrMaskAVX2, FindSSE2<AttrMaskSSE2, FindAttrScalar>>,
+    FindAVX2<UrlMaskAVX2, FindSSE2<UrlMaskSSE2, FindUrlScalar>>
+};
+#endif
+
+static const EscapeFinders& ChooseFinders() {
+    const char* forced = getenv("FUSCO_SCAN");
+    if(forced != nullptr && strcmp(forced, "scalar") == 0)
+        return ScalarFinders;
+
+#ifdef FUSCO_ESCAPE_X86
+    __builtin_cpu_init();
+    if(forced != nullptr && strcmp(forced, "sse2") == 0)
+        return SSE2Finders;
+
+    return __builtin_cpu_supports("avx2") ? AVX2Finders : SSE2Finders;
+#else
+    return ScalarFinders;
+#endif
+}
+
+static const EscapeFinders& Finders() {
+    static const EscapeFinders& finders = ChooseFinders();
+    return finders;
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *       E S C A P I N G     * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+static void Escape(const char* text, size_t length, OutputSink& out, Finder find, const Replacements& replacements) {
+    size_t from = 0;
+
+    while(from < length) {
+        size_t stop = find(text, from, length);
+        if(stop > from)
+            out.Write(text + from, stop - from);
+        if(stop == length)
+            return;
+
+        std::string_view replacement = replacements[(unsigned char) text[stop]];
+        out.Write(replacement.data(), replacement.size());
+        from = stop + 1;
+    }
+}
+
+void EscapeHtml(const char* text, size_t length, OutputSink& out) {
+    Escape(text, length, out, Finders().Html, HtmlReplacements);
+}
+
+void EscapeAttr(const char* text, size_t length, OutputSink& out) {
+    Escape(text, length, out, Finders().Attr, AttrReplacements);
+}
+
+void UrlEncode(const char* text, size_t length, OutputSink& out) {
+    Escape(text, length, out, Finders().Url, UrlReplacements);
+}
@@ -4,11 +4,15 @@
  ***********/
 
 #include <interpreter/Interpreter.hpp>
+#include <interpreter/Array.hpp>
+#include <interpreter/Native.hpp>
+#include <Trace.hpp>
+#include <cmath>
 #include <utility>
 
 Object Interpreter::lookupVariable(Token name, Expression<Object>* expr) {
-    if (Locals.find(expr) != Locals.end())
-        return Environment->getAt(Locals.at(expr), name.Lexeme);
+    if (expr->Depth >= 0)
+        return Environment->getAt(expr->Depth, name.Lexeme);
     else
         return Globals->get(name);
     
@@ -79,8 +83,8 @@ Object Interpreter::visitVariableExpression(VariableExpression<Object> &expr) {
 Object Interpreter::visitAssignmentExpression(AssignmentExpression<Object> &expr) {
     Object value = Evaluate(expr.Expr);
 
-    if (Locals.find(&expr) != Locals.end())
-        Environment->assignAt(Locals.at(&expr), expr.Name, value);
+    if (expr.Depth >= 0)
+        Environment->assignAt(expr.Depth, expr.Name, value);
     else
         Globals->assign(expr.Name, value);
 
@@ -99,14 +103,49 @@ Object Interpreter::visitUnaryExpression(UnaryExpression<Object> &expr) {
 }
 
 Object Interpreter::visitCallExpression(CallExpression<Object> &expr) {
-    Object callee = Evaluate(expr.Callee);
+    auto* get = dynamic_cast<GetExpression<Object>*>(expr.Callee.get());
+    if(get == nullptr)
+        return Call(Evaluate(expr.Callee), expr);
+
+    // An array's push and pop are called on the array directly, without binding an ArrayMethod to it.
+    Object obj = Evaluate(get->Obj);
+    if(obj.Type == Object::ArrayType && (get->Name.Lexeme == "push" || get->Name.Lexeme == "pop")) {
+        bool push = get->Name.Lexeme == "push";
+        size_t expected = push ? 1 : 0;
+        if(expr.Arguments.size() != expected)
+            throw Error(RuntimeError(expr.Parenthesis, "Expected " + std::to_string(expected) + " arguments, got "
+                                                       + std::to_string(expr.Arguments.size()) + "."));
+
+        Object value = push ? Evaluate(expr.Arguments[0]) : Object::Null;
+        ShadowFrame frame(Stack, get->Name.Lexeme, expr.Parenthesis.Line);
+        if(!push)
+            return obj.ArrayData->pop();
+        obj.ArrayData->push(value);
+        return Object::NewNum((double) obj.ArrayData->length());
+    }
+
+    return Call(GetProperty(obj, *get), expr);
+}
+
+Object Interpreter::Call(const Object& functionHolder, CallExpression<Object>& expr) {
+    // Natives take their arguments in place, from an array on the stack.
+    if(functionHolder.Type == Object::CallableType && expr.Arguments.size() <= Native::InlineArguments) {
+        auto* native = dynamic_cast<Native*>(functionHolder.CallableData.get());
+        if(native != nullptr && native->arguments() == expr.Arguments.size()) {
+            Object inlineArguments[Native::InlineArguments];
+            for(size_t i = 0; i < expr.Arguments.size(); i++)
+                inlineArguments[i] = Evaluate(expr.Arguments[i]);
+
+            ShadowFrame frame(Stack, native->name(), expr.Parenthesis.Line);
+            return native->invoke(*this, expr.Parenthesis, inlineArguments);
+        }
+    }
+
     std::vector<Object> arguments;
-    for(EXPR argument : expr.Arguments) {
+    for(const EXPR& argument : expr.Arguments) {
         arguments.emplace_back(Evaluate(argument));
     }
 
-    Object functionHolder = Evaluate(expr.Callee);
-
     if(functionHolder.Type != Object::CallableType && functionHolder.Type != Object::ClassType && functionHolder.Type != Object::MethodType) {
         throw Error(RuntimeError(expr.Parenthesis, "Unable to call non-function type."));
     }
@@ -121,6 +160,8 @@ Object Interpreter::visitCallExpression(CallExpression<Object> &expr) {
         throw Error(RuntimeError(expr.Parenthesis, message));
     }
 
+    ShadowFrame frame(Stack, function->name(), expr.Parenthesis.Line);
+    TraceSpan span(function->name());
     return function->call(shared_from_this(), arguments);
 }
 
@@ -138,10 +179,42 @@ Object Interpreter::visitLogicalExpression(LogicalExpression<Object> &expr) {
 
 
 Object Interpreter::visitGetExpression(GetExpression<Object> &expr) {
-    Object obj = Evaluate(expr.Obj);
+    return GetProperty(Evaluate(expr.Obj), expr);
+}
+
+Object Interpreter::GetProperty(const Object& obj, GetExpression<Object>& expr) {
     if(obj.Type == Object::ObjectTypes::InstanceType)
         return obj.InstanceData->get(expr.Name);
 
+    // Array members are dispatched natively, without a field lookup.
+    if(obj.Type == Object::ObjectTypes::ArrayType) {
+        if(expr.Name.Lexeme == "length")
+            return Object::NewNum((double) obj.ArrayData->length());
+        if(expr.Name.Lexeme == "push")
+            return Object::NewCallable(std::make_shared<ArrayMethod>(obj.ArrayData, ArrayMethod::PUSH));
+        if(expr.Name.Lexeme == "pop")
+            return Object::NewCallable(std::make_shared<ArrayMethod>(obj.ArrayData, ArrayMethod::POP));
+
+        throw Error(RuntimeError(expr.Name, "No such array property " + expr.Name.Lexeme));
+    }
+
+    if(obj.Type == Object::ObjectTypes::DictType) {
+        static const std::map<std::string, DictionaryMethod::Kind> methods = {
+            { "get", DictionaryMethod::GET }, { "set", DictionaryMethod::SET },
+            { "has", DictionaryMethod::HAS }, { "delete", DictionaryMethod::DELETE },
+            { "keys", DictionaryMethod::KEYS }, { "values", DictionaryMethod::VALUES }
+        };
+
+        if(expr.Name.Lexeme == "size")
+            return Object::NewNum((double) obj.DictData->size());
+
+        auto method = methods.find(expr.Name.Lexeme);
+        if(method != methods.end())
+            return Object::NewCallable(std::make_shared<DictionaryMethod>(obj.DictData, method->second));
+
+        throw Error(RuntimeError(expr.Name, "No such dictionary property " + expr.Name.Lexeme));
+    }
+
     throw Error(RuntimeError(expr.Name, "Unable to retrieve a property of a non-instance type."));
 }
 
@@ -159,7 +232,62 @@ Object Interpreter::visitThisExpression(ThisExpression<Object> &expr) {
     return lookupVariable(expr.Name, &expr);
 }
 
+Object Interpreter::visitArrayExpression(ArrayExpression<Object> &expr) {
+    std::vector<Object> elements;
+    elements.reserve(expr.Elements.size());
+    for(const EXPR& element : expr.Elements) {
+        elements.emplace_back(Evaluate(element));
+    }
+
+    return Object::NewArray(std::make_shared<Array>(std::move(elements)));
+}
+
+Object Interpreter::visitIndexExpression(IndexExpression<Object> &expr) {
+    Object obj = Evaluate(expr.Obj);
+    Object index = Evaluate(expr.Index);
+
+    if (obj.Type == Object::ObjectTypes::DictType) {
+        DictKey key;
+        Object value;
+        if (DictionaryKey(expr.Bracket, index, key, false) && obj.DictData->get(key, value))
+            return value;
+        return Object::Null;
+    }
+
+    if (obj.Type != Object::ObjectTypes::ArrayType)
+        throw Error(RuntimeError(expr.Bracket, "Unable to index a non-array type."));
+
+    return obj.ArrayData->at(CheckIndex(expr.Bracket, index, obj.ArrayData->length()));
+}
+
+Object Interpreter::visitIndexSetExpression(IndexSetExpression<Object> &expr) {
+    Object obj = Evaluate(expr.Obj);
+    Object index = Evaluate(expr.Index);
+
+    if (obj.Type == Object::ObjectTypes::DictType) {
+        DictKey key;
+        DictionaryKey(expr.Bracket, index, key, true);
+
+        Object value = Evaluate(expr.Value);
+        obj.DictData->set(key, value);
+        return value;
+    }
+
+    if (obj.Type != Object::ObjectTypes::ArrayType)
+        throw Error(RuntimeError(expr.Bracket, "Unable to index a non-array type."));
+
+    // Writing one past the end appends to the array.
+    size_t position = CheckIndex(expr.Bracket, index, obj.ArrayData->length() + 1);
+
+    Object value = Evaluate(expr.Value);
+    obj.ArrayData->set(position, value);
+    return value;
+}
+
 Object Interpreter::Evaluate(const shared_ptr<Expression<Object>>& expr) {
+#ifdef FUSCO_INSTRUMENT
+    HeatScope counted(Heat, RunningPath(), expr->Counts);
+#endif
     return expr->accept(shared_from_this());
 }
 
@@ -191,6 +319,10 @@ bool Interpreter::IsEqual(const Object& a, const Object& b) {
                 return a.NumData == b.NumData;
             case Object::StrType:
                 return a.StrData == b.StrData;
+            case Object::ArrayType:
+                return a.ArrayData == b.ArrayData;
+            case Object::DictType:
+                return a.DictData == b.DictData;
             default:
                 return false;
         }
@@ -214,4 +346,36 @@ void Interpreter::CheckOperands(const struct Token& operatorToken, const Object&
     }
 
     throw Error(RuntimeError(operatorToken, "Unknown syntax error."));
-}
\ No newline at end of file
+}
+
+size_t Interpreter::CheckIndex(const struct Token& bracket, const Object& index, size_t length) {
+    if(index.Type != Object::NumType || index.NumData < 0 || std::floor(index.NumData) != index.NumData)
+        throw Error(RuntimeError(bracket, "An array index must be a non-negative whole number."));
+
+    if(index.NumData >= (double) length)
+        throw Error(RuntimeError(bracket, "Array index " + std::to_string((size_t) index.NumData) + " is out of bounds."));
+
+    return (size_t) index.NumData;
+}
+
+/*
+ * Convert a value into a dictionary key.
+ * If create is false, and the key is a string that has never been used as a key before,
+ *  no dictionary can contain it; return false so that the lookup can be skipped.
+ */
+bool Interpreter::DictionaryKey(const struct Token& cause, const Object& key, DictKey& out, bool create) {
+    switch(key.Type) {
+        case Object::NumType:
+            out.Num = key.NumData;
+            out.Hash = HashNumber(key.NumData);
+            return true;
+        case Object::StrType:
+            out.Str = create ? Strings.Intern(key.StrData) : Strings.Find(key.StrData);
+            if(out.Str == nullptr)
+                return false;
+            out.Hash = out.Str->Hash;
+            return true;
+        default:
+            throw Error(RuntimeError(cause, "Dictionary keys must be strings or numbers."));
+    }
+}
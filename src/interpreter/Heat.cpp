@@ -0,0 +1,32 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Heat.hpp>
+
+void HeatMap::WriteJSON(std::ostream& out) const {
+    out << "{\"lines\": [";
+
+    bool first = true;
+    for(const auto& [path, file] : Files) {
+        std::string escaped;
+        for(char c : path) {
+            if(c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+
+        for(size_t line = 0; line < file.size(); line++) {
+            const LineHeat& heat = file[line];
+            if(heat.Count == 0)
+                continue;
+
+            out << (first ? "\n" : ",\n") << "  {\"path\": \"" << escaped << "\", \"line\": " << line
+                << ", \"count\": " << heat.Count << ", \"inclusive_ns\": " << heat.Nanoseconds << "}";
+            first = false;
+        }
+    }
+
+    out << (first ? "]}\n" : "\n]}\n");
+}
@@ -0,0 +1,72 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Memory.hpp>
+#include <interpreter/Interpreter.hpp>
+#include <cstdio>
+
+MemoryCounter MemoryCounters[MEM_CATEGORIES];
+
+const char* MemoryCategoryName(MemoryCategory category) {
+    switch(category) {
+        case MEM_STRINGS: return "strings";
+        case MEM_CONTEXTS: return "contexts";
+        case MEM_FUNCTIONS: return "functions";
+        case MEM_BOUND: return "boundMethods";
+        case MEM_INSTANCES: return "instances";
+        case MEM_CLASSES: return "classes";
+        case MEM_NODES: return "nodes";
+        case MEM_TOKENS: return "tokens";
+        case MEM_CATEGORIES: break;
+    }
+    return "unknown";
+}
+
+void WriteMemoryTable(std::ostream& out) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-14s %10s %10s %12s %12s %12s %14s\n", "category", "live", "peak", "total",
+             "live bytes", "peak bytes", "total bytes");
+    out << line;
+
+    for(int category = 0; category < MEM_CATEGORIES; category++) {
+        const MemoryCounter& counter = MemoryCounters[category];
+        snprintf(line, sizeof(line), "%-14s %10llu %10llu %12llu %12llu %12llu %14llu\n",
+                 MemoryCategoryName((MemoryCategory) category),
+                 (unsigned long long) counter.Live.load(), (unsigned long long) counter.Peak.load(),
+                 (unsigned long long) counter.Total.load(), (unsigned long long) counter.LiveBytes.load(),
+                 (unsigned long long) counter.PeakBytes.load(), (unsigned long long) counter.TotalBytes.load());
+        out << line;
+    }
+}
+
+#ifdef FUSCO_INSTRUMENT
+Object MemoryStats::call(shared_ptr<Interpreter> interpreter, std::vector<Object> arguments) {
+    UNUSED(arguments);
+
+    auto key = [&interpreter](const std::string& name) {
+        DictKey made;
+        made.Str = interpreter->Strings.Intern(name);
+        made.Hash = made.Str->Hash;
+        return made;
+    };
+
+    auto stats = std::make_shared<Dictionary>();
+    for(int category = 0; category < MEM_CATEGORIES; category++) {
+        const MemoryCounter& counter = MemoryCounters[category];
+
+        auto entry = std::make_shared<Dictionary>();
+        entry->set(key("live"), Object::NewNum((double) counter.Live.load()));
+        entry->set(key("peak"), Object::NewNum((double) counter.Peak.load()));
+        entry->set(key("total"), Object::NewNum((double) counter.Total.load()));
+        entry->set(key("liveBytes"), Object::NewNum((double) counter.LiveBytes.load()));
+        entry->set(key("peakBytes"), Object::NewNum((double) counter.PeakBytes.load()));
+        entry->set(key("totalBytes"), Object::NewNum((double) counter.TotalBytes.load()));
+
+        stats->set(key(MemoryCategoryName((MemoryCategory) category)), Object::NewDictionary(entry));
+    }
+
+    return Object::NewDictionary(stats);
+}
+#endif
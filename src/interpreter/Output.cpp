@@ -0,0 +1,127 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Output.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Write two pieces of data to a file descriptor, in order, retrying on partial writes.
+ * On POSIX systems both pieces go out in one writev call where possible.
+ */
+static void WriteFully(int fd, const char* first, size_t firstLength, const char* second, size_t secondLength) {
+#ifdef _WIN32
+    const char* pieces[2] = { first, second };
+    size_t lengths[2] = { firstLength, secondLength };
+    for(int i = 0; i < 2; i++) {
+        while(lengths[i] > 0) {
+            int written = _write(fd, pieces[i], (unsigned int) lengths[i]);
+            if(written < 0) return;
+            pieces[i] += written;
+            lengths[i] -= written;
+        }
+    }
+#else
+    struct iovec vectors[2] = {
+        { const_cast<char*>(first), firstLength },
+        { const_cast<char*>(second), secondLength }
+    };
+    struct iovec* next = vectors;
+    int count = 2;
+
+    while(count > 0) {
+        if(next->iov_len == 0) {
+            next++; count--;
+            continue;
+        }
+
+        ssize_t written = writev(fd, next, count);
+        if(written < 0) {
+            if(errno == EINTR) continue;
+            return;
+        }
+
+        while(count > 0 && (size_t) written >= next->iov_len) {
+            written -= next->iov_len;
+            next++; count--;
+        }
+
+        if(count > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + written;
+            next->iov_len -= written;
+        }
+    }
+#endif
+}
+
+FdSink::FdSink(int pFd, size_t pCapacity) : Fd(pFd), Capacity(pCapacity), Buffer(pCapacity), Used(0) {}
+
+FdSink::~FdSink() {
+    Flush();
+}
+
+void FdSink::Write(const char* data, size_t length) {
+    if(Used + length <= Capacity) {
+        std::memcpy(Buffer.data() + Used, data, length);
+        Used += length;
+        return;
+    }
+
+    // Big writes skip the copy, and go out together with whatever is buffered.
+    if(length >= Capacity / 2) {
+        WriteOut(data, length);
+        return;
+    }
+
+    WriteOut(nullptr, 0);
+    std::memcpy(Buffer.data(), data, length);
+    Used = length;
+}
+
+void FdSink::Flush() {
+    if(Used != 0)
+        WriteOut(nullptr, 0);
+}
+
+void FdSink::WriteOut(const char* data, size_t length) {
+    // Anything already written to the standard streams must come first.
+    if(Fd == 1 || Fd == 2) {
+        std::cout.flush();
+        std::fflush(Fd == 1 ? stdout : stderr);
+    }
+
+    WriteFully(Fd, Buffer.data(), Used, data, length);
+    Used = 0;
+}
+
+void CallbackSink::Write(const char* data, size_t length) {
+    if(Buffer.size() + length <= Capacity) {
+        Buffer.append(data, length);
+        return;
+    }
+
+    Flush();
+    if(length >= Capacity / 2)
+        Target(data, length);
+    else
+        Buffer.append(data, length);
+}
+
+void CallbackSink::Flush() {
+    if(Buffer.empty())
+        return;
+
+    Target(Buffer.data(), Buffer.size());
+    Buffer.clear();
+}
@@ -0,0 +1,168 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Profiler.hpp>
+#include <interpreter/Types.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+// The Profiler that is sampling, and the thread it samples.
+static std::atomic<Profiler*> ActiveProfiler { nullptr };
+#ifndef _WIN32
+static pthread_t ProfiledThread;
+#endif
+
+// Top level code, outside of any function.
+static const std::string TopLevel = "main";
+
+Profiler::~Profiler() {
+    Stop();
+}
+
+bool Profiler::Start() {
+#ifdef _WIN32
+    return false;
+#else
+    Profiler* none = nullptr;
+    if(Running || !ActiveProfiler.compare_exchange_strong(none, this))
+        return false;
+
+    if(Buffer == nullptr)
+        Buffer.reset(new ScriptFrame[BufferFrames]);
+    ProfiledThread = pthread_self();
+
+    struct sigaction action {};
+    action.sa_handler = OnSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    struct itimerval timer {};
+    timer.it_interval.tv_sec = (time_t) (Interval / 1000000);
+    timer.it_interval.tv_usec = (suseconds_t) (Interval % 1000000);
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    Running = true;
+    return true;
+#endif
+}
+
+void Profiler::Stop() {
+#ifndef _WIN32
+    if(!Running)
+        return;
+
+    struct itimerval timer {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+
+    ActiveProfiler.store(nullptr);
+    Running = false;
+#endif
+}
+
+void Profiler::OnSignal(int signal) {
+    UNUSED(signal);
+#ifndef _WIN32
+    int saved = errno;
+    Profiler* profiler = ActiveProfiler.load(std::memory_order_acquire);
+    if(profiler != nullptr && pthread_equal(pthread_self(), ProfiledThread))
+        profiler->Record();
+    errno = saved;
+#endif
+}
+
+void Profiler::Record() {
+    size_t depth = std::min(Stack.Depth.load(std::memory_order_acquire), ShadowStack::Capacity);
+    size_t used = Used.load(std::memory_order_relaxed);
+
+    if(used + depth + 1 > BufferFrames) {
+        Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Buffer[used] = { nullptr, depth };
+    std::copy(Stack.Frames, Stack.Frames + depth, Buffer.get() + used + 1);
+    Used.store(used + depth + 1, std::memory_order_release);
+    SampleCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename F>
+void Profiler::ForEachSample(F&& visit) const {
+    size_t used = Used.load(std::memory_order_acquire);
+    for(size_t at = 0; at < used; at += Buffer[at].Line + 1)
+        visit(Buffer.get() + at + 1, Buffer[at].Line);
+}
+
+void Profiler::WriteCollapsed(std::ostream& out) const {
+    std::map<std::string, size_t> stacks;
+
+    ForEachSample([&stacks](const ScriptFrame* frames, size_t depth) {
+        std::string stack = TopLevel;
+        for(size_t i = 0; i < depth; i++)
+            stack.append(";").append(*frames[i].Name).append(":").append(std::to_string(frames[i].Line));
+        stacks[stack]++;
+    });
+
+    for(const auto& stack : stacks)
+        out << stack.first << " " << stack.second << "\n";
+}
+
+void Profiler::WriteTable(std::ostream& out) const {
+    struct Times {
+        std::string Name;
+        size_t Self = 0;
+        size_t Total = 0;
+    };
+    std::map<std::string, Times> functions;
+
+    ForEachSample([&functions](const ScriptFrame* frames, size_t depth) {
+        const std::string& leaf = depth == 0 ? TopLevel : *frames[depth - 1].Name;
+        functions[leaf].Self++;
+
+        // A recursive function is only counted once per sample.
+        std::set<std::string> seen = { TopLevel };
+        for(size_t i = 0; i < depth; i++)
+            seen.insert(*frames[i].Name);
+        for(const std::string& name : seen)
+            functions[name].Total++;
+    });
+
+    std::vector<Times> rows;
+    for(auto& function : functions) {
+        function.second.Name = function.first;
+        rows.emplace_back(function.second);
+    }
+    std::sort(rows.begin(), rows.end(), [](const Times& a, const Times& b) {
+        return a.Self != b.Self ? a.Self > b.Self : a.Total > b.Total;
+    });
+
+    size_t samples = SampleCount.load();
+    double milliseconds = (double) Interval / 1000.0;
+    char line[256];
+
+    snprintf(line, sizeof(line), "%zu samples every %zuus, %zu dropped\n", samples, Interval, Dropped.load());
+    out << line;
+    snprintf(line, sizeof(line), "%10s %7s %10s %7s  %s\n", "self ms", "self%", "total ms", "total%", "function");
+    out << line;
+
+    for(const Times& row : rows) {
+        snprintf(line, sizeof(line), "%10.1f %6.1f%% %10.1f %6.1f%%  ", (double) row.Self * milliseconds,
+                 samples == 0 ? 0.0 : 100.0 * (double) row.Self / (double) samples, (double) row.Total * milliseconds,
+                 samples == 0 ? 0.0 : 100.0 * (double) row.Total / (double) samples);
+        out << line << row.Name << "\n";
+    }
+}
@@ -5,33 +5,115 @@
 
 #include <iostream>
 #include <interpreter/Interpreter.hpp>
+#include <Program.hpp>
+#include <Trace.hpp>
 #include <utility>
 
-void Interpreter::resolve(Expression<Object>* expr, int depth) {
-    Locals[expr] = depth;
-}
-
 void Interpreter::Interpret(const std::vector<shared_ptr<Statement>>& statements) {
+    RunningScope running(Output.get());
     try {
         for(const auto& value: statements) {
             Execute(value);
         }
     } catch (RuntimeError &e) {
-        std::cout << e.Message << ": " << e.Cause.Lexeme << std::endl;
+        Output->Flush();
+        *Reports << e.Message << ": " << e.Cause.Lexeme << std::endl;
+    }
+
+    Output->Flush();
+}
+
+/*
+ * Call a global function by name.
+ */
+Object Interpreter::Invoke(const std::string& name, const std::vector<Object>& arguments) {
+    Token token;
+    token.Type = LI_IDENTIFIER;
+    token.Line = 0;
+    token.Lexeme = name;
+
+    RunningScope running(Output.get());
+    try {
+        Object function = Globals->get(token);
+        if(function.Type != Object::CallableType && function.Type != Object::MethodType)
+            throw Error(RuntimeError(token, "Unable to call non-function type."));
+
+        return Invoke(function.CallableData, arguments);
+    } catch (RuntimeError &e) {
+        Output->Flush();
+        *Reports << e.Message << ": " << e.Cause.Lexeme << std::endl;
+    }
+
+    return Object::Null;
+}
+
+/*
+ * Call a function from outside of any script, such as the render function of a template.
+ * Runtime errors are reported rather than thrown, and set ErrorState. The output is flushed afterwards.
+ */
+Object Interpreter::Invoke(const shared_ptr<Callable>& function, const std::vector<Object>& arguments) {
+    RunningScope running(Output.get());
+    try {
+        ShadowFrame frame(Stack, function->name(), 0);
+        TraceSpan span(function->name());
+        Object result = function->call(shared_from_this(), arguments);
+        Output->Flush();
+        return result;
+    } catch (RuntimeError &e) {
+        ErrorState = true;
+        Output->Flush();
+        *Reports << e.Message << ": " << e.Cause.Lexeme << std::endl;
     }
+
+    return Object::Null;
 }
 
 void Interpreter::Execute(const shared_ptr<Statement>& stmt) {
+#ifdef FUSCO_INSTRUMENT
+    HeatScope counted(Heat, RunningPath(), stmt->Counts);
+#endif
     stmt->accept(shared_from_this());
 }
 
+#ifdef FUSCO_INSTRUMENT
+const std::string& Interpreter::RunningPath() const {
+    static const std::string None;
+    return RunningProgram != nullptr && *RunningProgram != nullptr ? (*RunningProgram)->Path : None;
+}
+#endif
+
 void Interpreter::visitExpression(ExpressionStatement &stmt) {
     Evaluate(stmt.Expr);
 }
 
 void Interpreter::visitPrint(PrintStatement &stmt) {
     Object value = Evaluate(stmt.Expr);
-    std::cout << "% " << Stringify(value) << std::endl;
+    Output->Write(PrintPrefix);
+    Output->Write(Stringify(value));
+    Output->Write(PrintSuffix);
+}
+
+void Interpreter::visitText(TextStatement &stmt) {
+    Output->Write(stmt.Text);
+}
+
+void Interpreter::visitEmit(EmitStatement &stmt) {
+    // <%= escapeHtml(value) %> and the like escape straight into the output.
+    if(auto* call = dynamic_cast<CallExpression<Object>*>(stmt.Expr.get())) {
+        Object callee = Evaluate(call->Callee);
+        auto* escaper = callee.Type == Object::CallableType ? dynamic_cast<Escaper*>(callee.CallableData.get()) : nullptr;
+
+        if(escaper != nullptr && call->Arguments.size() == 1) {
+            Object value = Evaluate(call->Arguments[0]);
+            ShadowFrame frame(Stack, escaper->name(), call->Parenthesis.Line);
+            escaper->Write(value, *Output);
+        } else {
+            Output->Write(Stringify(Call(callee, *call)));
+        }
+        return;
+    }
+
+    Output->Write(Stringify(Evaluate(stmt.Expr)));
 }
 
 void Interpreter::visitVariable(VariableStatement &stmt) {
@@ -58,7 +140,8 @@ void Interpreter::visitWhile(WhileStatement &stmt) {
 }
 
 void Interpreter::visitFunc(FuncStatement &stmt) {
-    shared_ptr<Function> func = std::make_shared<Function>(std::make_shared<FuncStatement>(stmt), Environment, false);
+    // The function refers to its declaration in the tree, rather than a copy, so that it can be traced back to it.
+    shared_ptr<Function> func = std::make_shared<Function>(&stmt, Environment, false, RunningProgram == nullptr ? nullptr : *RunningProgram);
     Environment->define(stmt.Name, Object::NewCallable(func));
 }
 
@@ -74,8 +157,9 @@ void Interpreter::visitClass(ClassStatement &stmt) {
     Environment->define(stmt.name, Object::Null);
 
     std::map<std::string, shared_ptr<Function>> methods;
+    shared_ptr<const CompiledProgram> program = RunningProgram == nullptr ? nullptr : *RunningProgram;
     for (const shared_ptr<FuncStatement>& func : stmt.functions) {
-        shared_ptr<Function> method = std::make_shared<Function>(func, Environment, func->Name.Lexeme == stmt.name.Lexeme);
+        shared_ptr<Function> method = std::make_shared<Function>(func.get(), Environment, func->Name.Lexeme == stmt.name.Lexeme, program);
         methods.emplace(func->Name.Lexeme, method);
     }
 
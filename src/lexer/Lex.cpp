@@ -3,6 +3,9 @@
  *  FUSCO  *
  ***********/
 #include <lexer/Lex.hpp>
+#include <lexer/Scan.hpp>
+#include <lexer/Tables.hpp>
+#include <charconv>
 
 
 /**
@@ -68,24 +71,15 @@ int Lexer::FindChar() {
 
     Char = NextChar();
 
-    while(Char == ' ' || Char == '\t' || Char == '\n' || Char == '\r') {
+    if(LexTables::ClassOf(Char) == LexTables::CC_SPACE) {
+        // NextChar never leaves anything in the overread buffer, so the rest of the run can be skipped in place.
+        SrcOffset = ScanKernels::Active().SkipWhitespace(SrcText.data(), SrcOffset, SrcText.length(), Line);
         Char = NextChar();
     }
 
     return Char;
 }
 
-/*
- * Allows the conversion between ASCII, hex and numerals.
- * @param String: The set of all valid results
- * @param Char: The ASCII character to convert
- * @return the ASCII character in int form, if in the set of valid results. -1 if not.
- */
-
-int Lexer::FindDigitFromPos(std::string String, char Char) {
-    return String.find_first_of(Char);
-}
-
 /*
  * Facilitates the easy checking of expected tokens.
  *  NOTE: there is (soon to be) an optional variant of this function that
@@ -111,8 +105,7 @@ void Lexer::VerifyToken(int Type, std::string TokenExpected) {
 
 /*
  * Facilitates the parsing of integer literals from the file.
- * Currently only supports the decimal numbers, despite the
- *  FindDigitFromPos function allowing conversion.
+ * Currently only supports the decimal numbers.
  *
  * The functon loops over the characters, multiplying by 10 and adding
  *  the new value on top, until a non-numeric character is found.
@@ -124,18 +117,33 @@ void Lexer::VerifyToken(int Type, std::string TokenExpected) {
  *
  */
 
-double Lexer::ReadNumber(int Char) {
-    int CurrentChar = 0;
-    int IntegerValue = 0;
+int Lexer::ReadNumber(int Char) {
+    // Char was just read by NextChar, so the rest of the digits are in place after it.
+    // The value wraps around as an int would, as it always has.
+    unsigned IntegerValue = (unsigned) (Char - '0');
+    size_t Offset = SrcOffset;
 
-    while((CurrentChar = FindDigitFromPos("0123456789", Char)) >= 0) {
-        IntegerValue = IntegerValue * 10 + CurrentChar;
-        Char = NextChar();
-    }
+    while(Offset < SrcText.length() && LexTables::ClassOf(SrcText[Offset]) == LexTables::CC_DIGIT)
+        IntegerValue = IntegerValue * 10 + (unsigned) (SrcText[Offset++] - '0');
 
-    ReturnCharToStream(Char);
+    SrcOffset = Offset;
+    ReturnCharToStream(NextChar());
 
-    return IntegerValue;
+    return (int) IntegerValue;
+}
+
+/*
+ * Numbers are read as ints, and their lexeme is the double they are held as, printed as std::to_string would.
+ * An int is exactly representable as a double, so that is the int and six zeroes.
+ */
+void Lexer::SetNumber(int Number) {
+    char Digits[16];
+    char* End = std::to_chars(Digits, Digits + sizeof(Digits), Number).ptr;
+
+    CurrentToken.Value = Object::NewNum((double) Number);
+    CurrentToken.Lexeme.assign(Digits, End);
+    CurrentToken.Lexeme.append(".000000");
+    CurrentToken.Type = LI_NUMBER;
 }
 
 /*
@@ -154,24 +162,18 @@ double Lexer::ReadNumber(int Char) {
  * @return the parsed identifier
  *
  */
-std::string Lexer::ReadIdentifier(int Char, int Limit) {
-    int ind = 0;
-    std::string Temp;
-
-    // This defines the valid chars in a keyword/variable/function.
-    while(isalpha(Char) || isdigit(Char) || Char == '_') {
-        if (ind >= Limit - 1) {
-            Error("Identifier too long");
-        } else {
-            Temp += Char;
-        }
-
-        Char = NextChar();
-    }
+std::string_view Lexer::ReadIdentifier(int Char, int Limit) {
+    // Letters, digits and underscores are the valid chars in a keyword/variable/function.
+    // Char was just read by NextChar, so the rest of the name is in place after it.
+    // The limit has never been enforced.
+    UNUSED(Char); UNUSED(Limit);
+    size_t Start = SrcOffset - 1;
+    size_t End = ScanKernels::Active().SkipIdentifier(SrcText.data(), SrcOffset, SrcText.length());
 
     // At this point, we've reached a non-keyword character
-    ReturnCharToStream(Char);
-    return Temp;
+    SrcOffset = End;
+    ReturnCharToStream(NextChar());
+    return SrcText.substr(Start, End - Start);
 }
 
 /*
@@ -219,120 +221,84 @@ int Lexer::ReadCharLiteral() {
  * To read a String Literal, it is a simple matter of reading Char Literals until
  *  the String termination token is identified - the last quotation mark.
  *
- * @param Buffer: The buffer into which to write the string. (usually CurrentIdentifer, a lexer global defined for this purpose)
+ * @param Buffer: The buffer into which to write the string. (usually the lexeme of the current token, so its space is reused)
  *
  */
-std::string Lexer::ReadStringLiteral() {
-    char CurrentChar = ReadCharLiteral();
-    std::string Temp;
+void Lexer::ReadStringLiteral(std::string& Buffer) {
+    for(;;) {
+        // Everything up to the next quote or escape is copied as it is.
+        size_t Start = SrcOffset;
+        SrcOffset = ScanKernels::Active().FindStringEnd(SrcText.data(), SrcOffset, SrcText.length(), Line);
+        Buffer.append(SrcText.substr(Start, SrcOffset - Start));
+
+        int CurrentChar = ReadCharLiteral();
+        if(CurrentChar == '"')
+            break;
 
-    while(CurrentChar != '"') {
-        Temp += CurrentChar;
-        CurrentChar = ReadCharLiteral();
-    }
+        if(CurrentChar == EOF) {
+            Error("Unterminated string.");
+            break;
+        }
 
-    return Temp;
+        Buffer += (char) CurrentChar;
+    }
 }
 
 /*
  * Keywords are source-code tokens / strings that are reserved for the compiler.
  *  They cannot be used as identifers on their own.
  *
- * This function is where all of the keywords are added, and where most aliases are going to be stored.
+ * The keywords, and any aliases of them, are listed in Tables.hpp.
  *
- * It uses a switch on the first character of the input string as an optimisation - rather than checking each
- *  keyword against the String individually, it only needs to compare a single number. This can be optimised into
- *   a hash table by the compiler for further optimisation, making this one of the fastest ways to switch
- *    on a full string.
+ * They are looked up in a perfect hash built at compile time (see Tables.hpp), so a name is compared
+ *  against a single keyword at most, and nothing is copied to do it.
  *
  * @param Str: The keyword input to try to parse
  * @return the token expressed in terms of values of the TokenTypes enum
  *
  */
-int Lexer::ReadKeyword(std::string Str) {
-    switch(Str.at(0)) {
-        case 'a':
-            if(Str.compare("and") == 0)
-                return KW_AND;
-            break;
-
-        case 'c':
-            if(Str.compare("class") == 0)
-                return KW_CLASS;
-            break;
-
-        case 'e':
-            if(Str.compare("else") == 0)
-                return KW_ELSE;
-            if(Str.compare("extends") == 0)
-                return KW_EXTENDS;
-            break;
-
-        case 'f':
-            if(Str.compare("for") == 0)
-                return KW_FOR;
-            if(Str.compare("false") == 0)
-                return KW_FALSE;
-            if(Str.compare("func") == 0)
-                return KW_FUNC;
-            break;
-        case 'i':
-        /*
-            if(!Str.compare("i8"))
-                return TY_CHAR;
-            if(!Str.compare("i32"))
-                return TY_INT;
-            if(!Str.compare("i64"))
-                return TY_LONG;
-
-            if(!Str.compare("int"))
-                return TY_INT; */
-
-            if(Str.compare("if") == 0)
-                return KW_IF;
-
-            break;
-
-        case 'o':
-            if(Str.compare("or") == 0)
-                return KW_OR;
-            break;
-
-        case 'p':
-            if(Str.compare("print") == 0)
-                return KW_PRINT;
-            break;
-
-        case 'r':
-            if(Str.compare("return") == 0)
-                return KW_RETURN;
-            break;
-
-        case 's':
-            if(Str.compare("super") == 0)
-                return KW_SUPER;
-            break;
-
-        case 't':
-            if(Str.compare("this") == 0)
-                return KW_THIS;
-            if(Str.compare("true") == 0)
-                return KW_TRUE;
-            break;
-
-        case 'v':
-            if(Str.compare("var") == 0)
-                return KW_VAR;
-            break;
+int Lexer::ReadKeyword(std::string_view Str) {
+    return LexTables::FindKeyword(Str);
+}
 
-        case 'w':
-            if(Str.compare("while") == 0)
-                return KW_WHILE;
-            break;
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *      T E M P L A T E S    * * * *
+ * * * * * * * * * * * * * * * * * * * * */
 
+/*
+ * Templates are markup, with code islands:
+ *  <% statements %> runs code, and <%= expression %> writes the value of the expression.
+ *
+ * Markup is read in one piece, up to the start of the next island, and becomes a single TPL_TEXT token.
+ * An expression island is wrapped in TPL_EMIT and TPL_EMIT_END tokens; a code island has no
+ *  tokens of its own, so that code may open a block in one island and close it in another.
+ *
+ * @return whether a TPL_TEXT token was written into CurrentToken.
+ */
+bool Lexer::ReadMarkup() {
+    size_t End = SrcText.find("<%", SrcOffset);
+    if(End == std::string::npos)
+        End = SrcText.length();
+
+    size_t Start = SrcOffset;
+    Line += ScanKernels::Active().CountLines(SrcText.data(), Start, End);
+    SrcOffset = End;
+
+    if(End < SrcText.length()) {
+        SrcOffset += 2;
+        InMarkup = false;
+        if(SrcOffset < SrcText.length() && SrcText[SrcOffset] == '=') {
+            SrcOffset++;
+            PendingEmit = true;
+        }
     }
 
-    return 0;
+    if(End == Start)
+        return false;
+
+    CurrentToken.Type = TPL_TEXT;
+    CurrentToken.Lexeme = std::string(SrcText.substr(Start, End - Start));
+    return true;
 }
 
 /* * * * * * * * * * * * * * * * * * * * *
@@ -350,189 +316,115 @@ int Lexer::ReadKeyword(std::string Str) {
  *
  * This function may be the main bottleneck in the lexer.
  *
+ * A character that starts no token is reported and skipped, so a token never carries the type of the one before it.
  */
 void Lexer::Advance() {
+    do {
+        Unrecognized = false;
+        Scan();
+    } while(Unrecognized);
+}
+
+void Lexer::Scan() {
     int Char, TokenType;
     struct Token* Token = &CurrentToken;
-    Token->Lexeme = "";
+    Token->Lexeme.clear();
     Token->Line = Line;
+    // Only literals carry a value; nothing else may inherit the last one.
+    if(Token->Value.Type != Object::NullType)
+        Token->Value = Object::Null;
+
+    if(InMarkup && ReadMarkup())
+        return;
+
+    if(PendingEmit) {
+        PendingEmit = false;
+        InEmit = true;
+        Token->Lexeme = "<%=";
+        Token->Type = TPL_EMIT;
+        return;
+    }
 
     Char = FindChar();
+    // The token starts past the whitespace before it, which may have ended a line.
+    Token->Line = Line;
+    Token->Offset = SrcOffset - 1;
 
-    switch(Char) {
-        case EOF:
-            Token->Type = LI_EOF;
-            return;
-
-        case '.':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_PERIOD;
-            break;
+    if(Char == EOF) {
+        Token->Type = LI_EOF;
+        return;
+    }
 
-        case '+':
-            // + can be either "+" or "++".
-            Char = NextChar();
-            if(Char == '+') {
-                Token->Lexeme = "++";
-                Token->Type = PPMM_PLUS;
-            } else {
-                Token->Type = AR_PLUS;
-                Token->Lexeme = "+";
-                ReturnCharToStream(Char);
+    switch(LexTables::ClassOf(Char)) {
+        case LexTables::CC_OPERATOR: {
+            // The longest operator wins; the character after one that may be longer is given back if it is not.
+            uint8_t Op = LexTables::Starts[(uint8_t) Char];
+            if(LexTables::Operators[Op].Extends) {
+                Char = NextChar();
+                if(uint8_t Longer = LexTables::Transitions[Op][(uint8_t) Char])
+                    Op = Longer;
+                else
+                    ReturnCharToStream(Char);
             }
-            break;
 
-        case '-':
-            // - can be either "-" or "--"
-            Char = NextChar();
-            if(Char == '-') {
-                Token->Lexeme = "--";
-                Token->Type = PPMM_MINUS;
-            } else {
-                Token->Type = AR_MINUS;
-                Token->Lexeme = "-";
-                ReturnCharToStream(Char);
-            }
-            break;
-
-        case '*':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = AR_ASTERISK;
-            break;
-
-        case '/':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = AR_RSLASH;
-            break;
-
-        case ',':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_COMMA;
+            Token->Type = LexTables::Operators[Op].Type;
+            Token->Lexeme.assign(LexTables::Operators[Op].Lexeme);
             break;
+        }
 
-        case '=':
-            Char = NextChar();
-            // If the next char is =, we have ==, the compare equality token.
-            if(Char == '?') {
-                Token->Lexeme = "=?";
-                Token->Type = CMP_EQUAL;
-            // if the next char is >, we have =>, the greater than or equal token.
-            } else if(Char == '>') {
-                Token->Lexeme = "=>";
-                Token->Type = CMP_GREAT_EQUAL;
-            // If none of the above match, we have = and an extra char. Return the char and set the token
-            } else {
-                ReturnCharToStream(Char);
-                Token->Lexeme = "=";
-                Token->Type = LI_EQUAL;
-            }
-            break;
+        case LexTables::CC_APOSTROPHE:
+            SetNumber(ReadCharLiteral());
 
-        case '!':
-            Char = NextChar();
-            // If the next char is =, we have !=, the compare inequality operator.
-            if(Char == '=') {
-                Token->Lexeme = "!=";
-                Token->Type = CMP_INEQ;
-            // Otherwise, we have a spare char
-            } else {
-                ReturnCharToStream(Char);
-                Token->Lexeme = "!";
-                Token->Type = BOOL_EXCLAIM;
-            }
+            if(NextChar() != '\'')
+                Error("Expected ' at the end of a character.");
             break;
 
-        case '<':
-            Char = NextChar();
-            // If the next char is =, we have <=, the less than or equal comparator.
-            if(Char == '=') {
-                Token->Lexeme = "<=";
-                Token->Type = CMP_LESS_EQUAL;
-            } else {
+        case LexTables::CC_PERCENT:
+            // %> ends a code island in a template.
+            if(TemplateMode) {
+                Char = NextChar();
+                if(Char == '>') {
+                    InMarkup = true;
+                    if(InEmit) {
+                        InEmit = false;
+                        Token->Lexeme = "%>";
+                        Token->Type = TPL_EMIT_END;
+                        break;
+                    }
+
+                    Advance();
+                    return;
+                }
                 ReturnCharToStream(Char);
-                Token->Lexeme = "<";
-                Token->Type = CMP_LESS;
             }
-            break;
 
-        case '>':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = CMP_GREATER;
+            Error("Unrecognized character " + std::to_string('%'));
+            Unrecognized = true;
             break;
 
-        case ';':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_SEMICOLON;
-            break;
-
-        case '(':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_LPAREN;
-            break;
-
-        case ')':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_RPAREN;
-            break;
-
-        case '{':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_LBRACE;
-            break;
-
-        case '}':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_RBRACE;
-            break;
-
-        case '[':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_LBRAS;
+        case LexTables::CC_QUOTE:
+            ReadStringLiteral(Token->Lexeme);
+            Token->Type = LI_STRING;
             break;
 
-        case ']':
-            Token->Lexeme = std::to_string(Char);
-            Token->Type = LI_RBRAS;
+        case LexTables::CC_DIGIT:
+            SetNumber(ReadNumber(Char));
             break;
 
-        case '\'':
-            Token->Value = Object::NewNum((double) ReadCharLiteral());
-            Token->Lexeme = std::to_string(Token->Value.NumData);
-            Token->Type = LI_NUMBER;
+        case LexTables::CC_NAME: { // This is what defines what a variable/function/keyword can START with.
+            std::string_view Name = ReadIdentifier(Char, 255);
 
-            if(NextChar() != '\'')
-                Error("Expected ' at the end of a character.");
-            break;
+            if(!(TokenType = ReadKeyword(Name)))
+                TokenType = LI_IDENTIFIER;
 
-        case '"':
-            CurrentIdentifier = ReadStringLiteral();
-            Token->Lexeme = CurrentIdentifier;
-            Token->Type = LI_STRING;
+            Token->Type = TokenType;
+            Token->Lexeme.assign(Name);
             break;
+        }
 
         default:
-            if(isdigit(Char)) {
-                Token->Value = Object::NewNum(ReadNumber(Char));
-                Token->Lexeme = std::to_string(Token->Value.NumData);
-                Token->Type = LI_NUMBER;
-                break;
-
-            } else if(isalpha(Char) || Char == '_') { // This is what defines what a variable/function/keyword can START with.
-                CurrentIdentifier = ReadIdentifier(Char, 255);
-
-                if((TokenType = ReadKeyword(CurrentIdentifier))) {
-                    Token->Type = TokenType;
-                    Token->Lexeme = CurrentIdentifier;
-                    break;
-                }
-
-                Token->Type = LI_IDENTIFIER;
-                Token->Lexeme = CurrentIdentifier;
-                break;
-            }
-
-
             Error("Unrecognized character " + std::to_string(Char));
+            Unrecognized = true;
     }
 }
 
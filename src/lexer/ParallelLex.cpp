@@ -0,0 +1,174 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <lexer/ParallelLex.hpp>
+#include <algorithm>
+
+/*
+ * Lexes a chunk ahead of time, without reporting anything; a chunk that fails is lexed again
+ *  when it is reached, by a Lexer that does report.
+ */
+class QuietLexer : public Lexer {
+public:
+    using Lexer::Lexer;
+
+protected:
+    void Report(size_t Line, const std::string& Where, const std::string& Message) override {
+        UNUSED(Line); UNUSED(Where); UNUSED(Message);
+    }
+};
+
+ParallelLexer::ParallelLexer(std::string_view Source, size_t Threads) : SrcText(Source) {
+    if(Threads == 0)
+        Threads = std::max(1u, std::thread::hardware_concurrency());
+    Window = Threads * 2;
+
+    Split();
+
+    for(size_t i = 0; i < Threads && i < Chunks.size(); i++)
+        Workers.emplace_back([this]() { Work(); });
+}
+
+ParallelLexer::~ParallelLexer() {
+    {
+        std::lock_guard<std::mutex> guard(Lock);
+        Stopping = true;
+    }
+    Progress.notify_all();
+
+    for(std::thread& worker : Workers)
+        worker.join();
+}
+
+/*
+ * Walks the script once, following string and character literals exactly as the Lexer reads them,
+ *  and counting lines as NextChar does.
+ */
+void ParallelLexer::Split() {
+    size_t length = SrcText.size();
+    size_t begin = 0;
+    int beginLine = 0;
+    int lines = 0;
+    size_t i = 0;
+
+    while(i < length) {
+        size_t target = begin + ChunkSize;
+
+        while(i < length) {
+            char c = SrcText[i];
+
+            if(c == '"') {
+                // A string runs to the next quote. A backslash takes the character after it, but an
+                //  escaped quote still ends the string, since ReadCharLiteral gives back a plain quote.
+                for(i++; i < length; i++) {
+                    if(SrcText[i] == '\\' && i + 1 < length) i++;
+                    if(SrcText[i] == '\n') lines++;
+                    if(SrcText[i] == '"') break;
+                }
+                i++;
+                continue;
+            }
+
+            if(c == '\'') {
+                // A character is the quote, one character or an escape pair, and one more character.
+                size_t end = std::min(length, i + (i + 1 < length && SrcText[i + 1] == '\\' ? 4 : 3));
+                lines += (int) std::count(SrcText.begin() + (ptrdiff_t) i, SrcText.begin() + (ptrdiff_t) end, '\n');
+                i = end;
+                continue;
+            }
+
+            if(c == '\n') lines++;
+            i++;
+
+            if(i >= target && (c == ';' || c == '{' || c == '}'))
+                break;
+        }
+
+        i = std::min(i, length);
+        Chunks.push_back({ begin, i, beginLine, {} });
+        begin = i;
+        beginLine = lines;
+    }
+
+    if(Chunks.empty())
+        Chunks.push_back({ 0, 0, 0, {} });
+}
+
+void ParallelLexer::Work() {
+    std::unique_lock<std::mutex> guard(Lock);
+
+    for(;;) {
+        Progress.wait(guard, [this]() { return Stopping || Claimed >= Chunks.size() || Claimed < Reading + Window; });
+        if(Stopping || Claimed >= Chunks.size())
+            return;
+
+        Chunk& chunk = Chunks[Claimed++];
+        guard.unlock();
+        LexChunk(chunk, false);
+        guard.lock();
+
+        chunk.Lexed = true;
+        Progress.notify_all();
+    }
+}
+
+void ParallelLexer::LexChunk(Chunk& chunk, bool report) {
+    std::string_view text = SrcText.substr(chunk.Begin, chunk.End - chunk.Begin);
+    std::unique_ptr<Lexer> lexer = report ? std::make_unique<Lexer>(text, false, chunk.Line)
+                                          : std::make_unique<QuietLexer>(text, false, chunk.Line);
+
+    std::vector<struct Token> tokens;
+    struct Token token;
+    do {
+        lexer->Next(token);
+        token.Offset += chunk.Begin;
+        tokens.emplace_back(token);
+    } while(token.Type != LI_EOF);
+
+    // Only the last chunk ends the stream.
+    if(&chunk != &Chunks.back())
+        tokens.pop_back();
+
+    chunk.Tokens = std::move(tokens);
+    chunk.Failed = lexer->ErrorState;
+    if(report && chunk.Failed)
+        ErrorState = true;
+}
+
+void ParallelLexer::Next(struct Token& out) {
+    for(;;) {
+        Chunk& chunk = Chunks[Reading];
+
+        if(Position == 0) {
+            {
+                std::unique_lock<std::mutex> guard(Lock);
+                Progress.wait(guard, [&chunk]() { return chunk.Lexed; });
+            }
+
+            if(chunk.Failed) {
+                LexChunk(chunk, true);
+                chunk.Failed = false;
+            }
+        }
+
+        if(Position < chunk.Tokens.size()) {
+            // LI_EOF closes the last chunk, and is given again on every call.
+            if(chunk.Tokens[Position].Type == LI_EOF)
+                out = chunk.Tokens[Position];
+            else
+                out = std::move(chunk.Tokens[Position++]);
+            return;
+        }
+
+        // This chunk is done with; let the workers move on past it.
+        std::vector<struct Token>().swap(chunk.Tokens);
+        {
+            std::lock_guard<std::mutex> guard(Lock);
+            Reading++;
+        }
+        Progress.notify_all();
+        Position = 0;
+    }
+}
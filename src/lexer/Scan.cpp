@@ -0,0 +1,269 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <lexer/Scan.hpp>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define FUSCO_SCAN_X86
+#include <immintrin.h>
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *        S C A L A R        * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+static bool IsWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool IsIdentifier(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static size_t SkipWhitespaceScalar(const char* text, size_t from, size_t length, int& lines) {
+    for(; from < length && IsWhitespace(text[from]); from++)
+        if(text[from] == '\n') lines++;
+    return from;
+}
+
+static size_t SkipIdentifierScalar(const char* text, size_t from, size_t length) {
+    while(from < length && IsIdentifier(text[from]))
+        from++;
+    return from;
+}
+
+static size_t FindStringEndScalar(const char* text, size_t from, size_t length, int& lines) {
+    for(; from < length && text[from] != '"' && text[from] != '\\'; from++)
+        if(text[from] == '\n') lines++;
+    return from;
+}
+
+static int CountLinesScalar(const char* text, size_t from, size_t length) {
+    int lines = 0;
+    for(; from < length; from++)
+        if(text[from] == '\n') lines++;
+    return lines;
+}
+
+#ifdef FUSCO_SCAN_X86
+
+/*
+ * Each vector kernel builds a mask with a bit set for every byte that continues the run, takes
+ *  whole blocks while every bit is set, and leaves the last part block to the scalar version.
+ * Most runs end at their first byte - a single space between tokens - so that is checked before any block is loaded.
+ */
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *          S S E 2          * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+static unsigned NewlinesBefore(unsigned newlines, unsigned end) {
+    return (unsigned) __builtin_popcount(newlines & ((1u << end) - 1));
+}
+
+static size_t SkipWhitespaceSSE2(const char* text, size_t from, size_t length, int& lines) {
+    if(from < length && !IsWhitespace(text[from]))
+        return from;
+
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+
+    for(; from + 16 <= length; from += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+        __m128i newline = _mm_cmpeq_epi8(block, lf);
+        __m128i white = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(block, cr), newline));
+
+        unsigned newlines = (unsigned) _mm_movemask_epi8(newline);
+        unsigned other = ~(unsigned) _mm_movemask_epi8(white) & 0xFFFFu;
+        if(other != 0) {
+            unsigned end = (unsigned) __builtin_ctz(other);
+            lines += (int) NewlinesBefore(newlines, end);
+            return from + end;
+        }
+
+        lines += __builtin_popcount(newlines);
+    }
+
+    return SkipWhitespaceScalar(text, from, length, lines);
+}
+
+static size_t SkipIdentifierSSE2(const char* text, size_t from, size_t length) {
+    if(from < length && !IsIdentifier(text[from]))
+        return from;
+
+    // Signed comparisons, so bytes over 0x7F are never letters.
+    const __m128i lower = _mm_set1_epi8(0x20), a = _mm_set1_epi8('a' - 1), z = _mm_set1_epi8('z' + 1);
+    const __m128i zero = _mm_set1_epi8('0' - 1), nine = _mm_set1_epi8('9' + 1), underscore = _mm_set1_epi8('_');
+
+    for(; from + 16 <= length; from += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+        __m128i folded = _mm_or_si128(block, lower);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, a), _mm_cmpgt_epi8(z, folded));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, zero), _mm_cmpgt_epi8(nine, block));
+        __m128i name = _mm_or_si128(_mm_or_si128(letter, digit), _mm_cmpeq_epi8(block, underscore));
+
+        unsigned other = ~(unsigned) _mm_movemask_epi8(name) & 0xFFFFu;
+        if(other != 0)
+            return from + (unsigned) __builtin_ctz(other);
+    }
+
+    return SkipIdentifierScalar(text, from, length);
+}
+
+static size_t FindStringEndSSE2(const char* text, size_t from, size_t length, int& lines) {
+    if(from < length && (text[from] == '"' || text[from] == '\\'))
+        return from;
+
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), lf = _mm_set1_epi8('\n');
+
+    for(; from + 16 <= length; from += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+        unsigned newlines = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(block, lf));
+        unsigned stop = (unsigned) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)));
+        if(stop != 0) {
+            unsigned end = (unsigned) __builtin_ctz(stop);
+            lines += (int) NewlinesBefore(newlines, end);
+            return from + end;
+        }
+
+        lines += __builtin_popcount(newlines);
+    }
+
+    return FindStringEndScalar(text, from, length, lines);
+}
+
+static int CountLinesSSE2(const char* text, size_t from, size_t length) {
+    const __m128i lf = _mm_set1_epi8('\n');
+    int lines = 0;
+
+    for(; from + 16 <= length; from += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+        lines += __builtin_popcount((unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(block, lf)));
+    }
+
+    return lines + CountLinesScalar(text, from, length);
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *          A V X 2          * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static size_t SkipWhitespaceAVX2(const char* text, size_t from, size_t length, int& lines) {
+    if(from < length && !IsWhitespace(text[from]))
+        return from;
+
+    const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t'), cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+
+    for(; from + 32 <= length; from += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + from));
+        __m256i newline = _mm256_cmpeq_epi8(block, lf);
+        __m256i white = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), newline));
+
+        unsigned newlines = (unsigned) _mm256_movemask_epi8(newline);
+        unsigned other = ~(unsigned) _mm256_movemask_epi8(white);
+        if(other != 0) {
+            unsigned end = (unsigned) __builtin_ctz(other);
+            lines += (int) NewlinesBefore(newlines, end);
+            return from + end;
+        }
+
+        lines += __builtin_popcount(newlines);
+    }
+
+    return SkipWhitespaceSSE2(text, from, length, lines);
+}
+
+AVX2 static size_t SkipIdentifierAVX2(const char* text, size_t from, size_t length) {
+    if(from < length && !IsIdentifier(text[from]))
+        return from;
+
+    const __m256i lower = _mm256_set1_epi8(0x20), a = _mm256_set1_epi8('a' - 1), z = _mm256_set1_epi8('z' + 1);
+    const __m256i zero = _mm256_set1_epi8('0' - 1), nine = _mm256_set1_epi8('9' + 1), underscore = _mm256_set1_epi8('_');
+
+    for(; from + 32 <= length; from += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + from));
+        __m256i folded = _mm256_or_si256(block, lower);
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, a), _mm256_cmpgt_epi8(z, folded));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(block, zero), _mm256_cmpgt_epi8(nine, block));
+        __m256i name = _mm256_or_si256(_mm256_or_si256(letter, digit), _mm256_cmpeq_epi8(block, underscore));
+
+        unsigned other = ~(unsigned) _mm256_movemask_epi8(name);
+        if(other != 0)
+            return from + (unsigned) __builtin_ctz(other);
+    }
+
+    return SkipIdentifierSSE2(text, from, length);
+}
+
+AVX2 static size_t FindStringEndAVX2(const char* text, size_t from, size_t length, int& lines) {
+    if(from < length && (text[from] == '"' || text[from] == '\\'))
+        return from;
+
+    const __m256i quote = _mm256_set1_epi8('"'), backslash = _mm256_set1_epi8('\\'), lf = _mm256_set1_epi8('\n');
+
+    for(; from + 32 <= length; from += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + from));
+        unsigned newlines = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, lf));
+        unsigned stop = (unsigned) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)));
+        if(stop != 0) {
+            unsigned end = (unsigned) __builtin_ctz(stop);
+            lines += (int) NewlinesBefore(newlines, end);
+            return from + end;
+        }
+
+        lines += __builtin_popcount(newlines);
+    }
+
+    return FindStringEndSSE2(text, from, length, lines);
+}
+
+AVX2 static int CountLinesAVX2(const char* text, size_t from, size_t length) {
+    const __m256i lf = _mm256_set1_epi8('\n');
+    int lines = 0;
+
+    for(; from + 32 <= length; from += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + from));
+        lines += __builtin_popcount((unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, lf)));
+    }
+
+    return lines + CountLinesSSE2(text, from, length);
+}
+
+#undef AVX2
+
+#endif
+
+static const ScanKernels ScalarKernels = { "scalar", SkipWhitespaceScalar, SkipIdentifierScalar, FindStringEndScalar, CountLinesScalar };
+#ifdef FUSCO_SCAN_X86
+static const ScanKernels SSE2Kernels = { "sse2", SkipWhitespaceSSE2, SkipIdentifierSSE2, FindStringEndSSE2, CountLinesSSE2 };
+static const ScanKernels AVX2Kernels = { "avx2", SkipWhitespaceAVX2, SkipIdentifierAVX2, FindStringEndAVX2, CountLinesAVX2 };
+#endif
+
+static const ScanKernels& ChooseKernels() {
+    const char* forced = getenv("FUSCO_SCAN");
+    if(forced != nullptr && strcmp(forced, "scalar") == 0)
+        return ScalarKernels;
+
+#ifdef FUSCO_SCAN_X86
+    // Every x86-64 processor has SSE2.
+    __builtin_cpu_init();
+    if(forced != nullptr && strcmp(forced, "sse2") == 0)
+        return SSE2Kernels;
+
+    return __builtin_cpu_supports("avx2") ? AVX2Kernels : SSE2Kernels;
+#else
+    return ScalarKernels;
+#endif
+}
+
+const ScanKernels& ScanKernels::Active() {
+    static const ScanKernels& kernels = ChooseKernels();
+    return kernels;
+}
@@ -0,0 +1,207 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <ParallelParse.hpp>
+#include <algorithm>
+#include <iterator>
+
+/*
+ * Parses a range ahead of time, without reporting anything; a range that fails is parsed again
+ *  when it is reached, by a Parser that does report.
+ */
+class QuietParser : public Parser {
+public:
+    using Parser::Parser;
+
+    void Report(size_t Line, const std::string& Where, const std::string& Message) override {
+        UNUSED(Line); UNUSED(Where); UNUSED(Message);
+    }
+};
+
+/*
+ * The tokens of one range, followed by LI_EOF. They are copied out, since they are parsed again if
+ *  this range, or one before it, fails.
+ */
+class RangeSource : public TokenSource {
+public:
+    explicit RangeSource(const std::vector<struct Token>& pTokens) : Tokens(pTokens) {
+        End.Type = LI_EOF;
+        End.Line = Tokens.back().Line;
+        End.Offset = Tokens.back().Offset;
+    }
+
+    void Next(struct Token& out) override {
+        out = Position < Tokens.size() ? Tokens[Position++] : End;
+    }
+
+private:
+    const std::vector<struct Token>& Tokens;
+    size_t Position = 0;
+    struct Token End;
+};
+
+/*
+ * Tokens that were already read, and then the rest of the source.
+ */
+class ReplaySource : public TokenSource {
+public:
+    ReplaySource(std::vector<struct Token> pTokens, TokenSource& pRest) : Tokens(std::move(pTokens)), Rest(pRest) {}
+
+    void Next(struct Token& out) override {
+        if(Position < Tokens.size())
+            out = std::move(Tokens[Position++]);
+        else
+            Rest.Next(out);
+    }
+
+private:
+    std::vector<struct Token> Tokens;
+    size_t Position = 0;
+    TokenSource& Rest;
+};
+
+ParallelParser::ParallelParser(TokenSource& pSource, shared_ptr<Arena> pNodes, DeferredSource* pDeferred, size_t Threads)
+    : source(pSource), Nodes(std::move(pNodes)), Deferred(pDeferred) {
+    if(Threads == 0)
+        Threads = std::max(1u, std::thread::hardware_concurrency());
+    Window = Threads * 2;
+
+    for(size_t i = 0; i < Threads; i++) {
+        shared_ptr<Arena> nodes = Nodes == nullptr ? nullptr : Nodes->Spawn();
+        Workers.emplace_back([this, nodes]() { Work(nodes); });
+    }
+}
+
+ParallelParser::~ParallelParser() {
+    Stop();
+}
+
+void ParallelParser::Stop() {
+    {
+        std::lock_guard<std::mutex> guard(Lock);
+        Stopping = true;
+    }
+    Progress.notify_all();
+
+    for(std::thread& worker : Workers)
+        worker.join();
+    Workers.clear();
+}
+
+static bool StartsDeclaration(int type) {
+    return type == KW_FUNC || type == KW_CLASS || type == KW_VAR;
+}
+
+std::vector<shared_ptr<Statement>> ParallelParser::parse() {
+    std::vector<shared_ptr<Statement>> statements;
+    int depth = 0;
+    size_t countedOffset = 0;
+    size_t countedLines = 0;
+    bool failed = false;
+
+    struct Token token;
+    source.Next(token);
+    Tokens++;
+
+    while(token.Type != LI_EOF && !failed) {
+        Range range;
+        range.Tokens.reserve(RangeTokens * 2);
+        range.Offset = token.Offset;
+        if(Deferred != nullptr) {
+            std::string_view text = Deferred->Text;
+            countedLines += std::count(text.begin() + (ptrdiff_t) countedOffset, text.begin() + (ptrdiff_t) range.Offset, '\n');
+            countedOffset = range.Offset;
+            range.Lines = countedLines;
+        }
+
+        do {
+            switch(token.Type) {
+                case LI_LPAREN: case LI_LBRAS: case LI_LBRACE: depth++; break;
+                case LI_RPAREN: case LI_RBRAS: case LI_RBRACE: depth--; break;
+                default: break;
+            }
+
+            range.Tokens.emplace_back(std::move(token));
+            source.Next(token);
+            Tokens++;
+        } while(token.Type != LI_EOF && !(range.Tokens.size() >= RangeTokens && depth == 0 && StartsDeclaration(token.Type)));
+
+        {
+            std::lock_guard<std::mutex> guard(Lock);
+            Ranges.emplace_back(std::move(range));
+        }
+        Progress.notify_one();
+
+        if(Ranges.size() >= Window)
+            failed = !MergeFront(statements);
+    }
+
+    while(!failed && !Ranges.empty())
+        failed = !MergeFront(statements);
+
+    Stop();
+    if(!failed)
+        return statements;
+
+    // Parse the failed range, and everything after it, again; this time reporting errors as they are found.
+    std::vector<struct Token> rest;
+    for(Range& range : Ranges)
+        rest.insert(rest.end(), std::make_move_iterator(range.Tokens.begin()), std::make_move_iterator(range.Tokens.end()));
+    rest.emplace_back(std::move(token));
+
+    ReplaySource replay(std::move(rest), source);
+    Parser parser(replay, Nodes, Deferred);
+    parser.CountLinesFrom(Ranges.front().Offset, Ranges.front().Lines);
+
+    std::vector<shared_ptr<Statement>> remaining = parser.parse();
+    statements.insert(statements.end(), remaining.begin(), remaining.end());
+    ErrorState = true;
+    return statements;
+}
+
+bool ParallelParser::MergeFront(std::vector<shared_ptr<Statement>>& statements) {
+    Range& range = Ranges.front();
+    {
+        std::unique_lock<std::mutex> guard(Lock);
+        Progress.wait(guard, [&range]() { return range.Parsed; });
+    }
+
+    if(range.Failed)
+        return false;
+
+    statements.insert(statements.end(), range.Statements.begin(), range.Statements.end());
+
+    std::lock_guard<std::mutex> guard(Lock);
+    Ranges.pop_front();
+    Merged++;
+    return true;
+}
+
+void ParallelParser::Work(const shared_ptr<Arena>& nodes) {
+    std::unique_lock<std::mutex> guard(Lock);
+
+    for(;;) {
+        Progress.wait(guard, [this]() { return Stopping || Claimed < Merged + Ranges.size(); });
+        if(Stopping)
+            return;
+
+        Range& range = Ranges[Claimed++ - Merged];
+        guard.unlock();
+        ParseRange(range, nodes);
+        guard.lock();
+
+        range.Parsed = true;
+        Progress.notify_all();
+    }
+}
+
+void ParallelParser::ParseRange(Range& range, const shared_ptr<Arena>& nodes) {
+    RangeSource tokens(range.Tokens);
+    QuietParser parser(tokens, nodes, Deferred);
+    parser.CountLinesFrom(range.Offset, range.Lines);
+
+    range.Statements = parser.parse();
+    range.Failed = parser.ErrorState;
+}
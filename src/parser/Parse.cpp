@@ -4,6 +4,8 @@
  ***********/
 
 #include <Parse.hpp>
+#include <Program.hpp>
+#include <algorithm>
 
 std::vector<shared_ptr<Statement>> Parser::parse() {
     std::vector<shared_ptr<Statement>> statements;
@@ -15,6 +17,19 @@ std::vector<shared_ptr<Statement>> Parser::parse() {
     return statements;
 }
 
+std::vector<shared_ptr<Statement>> Parser::parseTemplate(const std::string& name) {
+    std::vector<shared_ptr<Statement>> body = parse();
+
+    Token renderName;
+    renderName.Type = LI_IDENTIFIER;
+    renderName.Line = 0;
+    renderName.Lexeme = name;
+
+    std::vector<shared_ptr<Statement>> statements;
+    statements.emplace_back(node<FuncStatement>(renderName.Line, renderName, std::vector<Token>(), body));
+    return statements;
+}
+
 shared_ptr<Statement> Parser::declaration() {
     try {
         if(matchAny(KW_CLASS)) return classDeclaration();
@@ -23,8 +38,8 @@ shared_ptr<Statement> Parser::declaration() {
 
         return statement();
     } catch (RuntimeError &e) {
-        //recover();
         Error(e);
+        recover();
         return nullptr;
     }
 }
@@ -38,7 +53,7 @@ shared_ptr<Statement> Parser::varDeclaration() {
     }
 
     verify(LI_SEMICOLON, "Expected a semicolon after a variable declaration.");
-    return std::make_shared<VariableStatement>(name, initializer);
+    return node<VariableStatement>(name.Line, name, initializer);
 }
 
 shared_ptr<Statement> Parser::statement() {
@@ -47,7 +62,12 @@ shared_ptr<Statement> Parser::statement() {
     if(matchAny(KW_WHILE)) return whileStatement();
     if(matchAny(KW_PRINT)) return printStatement();
     if(matchAny(KW_RETURN)) return returnStatement();
-    if(matchAny(LI_LBRACE)) return std::make_shared<BlockStatement>(block());
+    if(matchAny(LI_LBRACE)) {
+        size_t line = previous().Line;
+        return node<BlockStatement>(line, block());
+    }
+    if(matchAny(TPL_TEXT)) return node<TextStatement>(previous().Line, previous().Lexeme);
+    if(matchAny(TPL_EMIT)) return emitStatement();
 
     return expressionStatement();
 }
@@ -61,7 +81,7 @@ shared_ptr<Statement> Parser::returnStatement() {
 
     verify(LI_SEMICOLON, "Expected ; after return.");
 
-    return std::make_shared<ReturnStatement>(keyword, value);
+    return node<ReturnStatement>(keyword.Line, keyword, value);
 }
 
 std::vector<shared_ptr<Statement>> Parser::block() {
@@ -76,13 +96,23 @@ std::vector<shared_ptr<Statement>> Parser::block() {
 }
 
 shared_ptr<Statement> Parser::printStatement() {
+    size_t line = previous().Line;
     EXPR value = expression();
     verify(LI_SEMICOLON, "Expected ';' after an expression to print");
 
-    return std::make_shared<PrintStatement>(value);
+    return node<PrintStatement>(line, value);
+}
+
+shared_ptr<Statement> Parser::emitStatement() {
+    size_t line = previous().Line;
+    EXPR value = expression();
+    verify(TPL_EMIT_END, "Expected '%>' after an expression island.");
+
+    return node<EmitStatement>(line, value);
 }
 
 shared_ptr<Statement> Parser::ifStatement() {
+    size_t line = previous().Line;
     verify(LI_LPAREN, "Expected a ( after if.");
     EXPR Condition = expression();
     verify(LI_RPAREN, "Expected a ) after the condition in if.");
@@ -93,10 +123,12 @@ shared_ptr<Statement> Parser::ifStatement() {
     if(matchAny(KW_ELSE))
         Else = statement();
 
-    return std::make_shared<IfStatement>(Condition, Then, Else);
+    return node<IfStatement>(line, Condition, Then, Else);
 }
 
 shared_ptr<Statement> Parser::forStatement() {
+    // Everything the loop is rewritten into starts on the line of the for.
+    size_t line = previous().Line;
     verify(LI_LPAREN, "Expected '(' after for.");
     shared_ptr<Statement> initializer;
 
@@ -125,40 +157,42 @@ shared_ptr<Statement> Parser::forStatement() {
     if(increment != nullptr) {
         std::vector<shared_ptr<Statement>> stmts;
         stmts.emplace_back(body);
-        stmts.emplace_back(std::make_shared<ExpressionStatement>(increment));
-        body = std::make_shared<BlockStatement>(stmts);
+        stmts.emplace_back(node<ExpressionStatement>(line, increment));
+        body = node<BlockStatement>(line, stmts);
     }
 
     if(condition == nullptr) {
-        condition = std::make_shared<LiteralExpression<Object>>(Object::NewBool(true));
+        condition = node<LiteralExpression<Object>>(line, Object::NewBool(true));
     }
-    body = std::make_shared<WhileStatement>(condition, body);
+    body = node<WhileStatement>(line, condition, body);
 
     if(initializer != nullptr) {
         std::vector<shared_ptr<Statement>> stmts;
         stmts.emplace_back(initializer);
         stmts.emplace_back(body);
-        body = std::make_shared<BlockStatement>(stmts);
+        body = node<BlockStatement>(line, stmts);
     }
 
     return body;
 }
 
 shared_ptr<Statement> Parser::whileStatement() {
+    size_t line = previous().Line;
     verify(LI_LPAREN, "Expected a ( after while.");
     EXPR condition = expression();
     verify(LI_RPAREN, "Expected a ) after the condition in while.");
 
     shared_ptr<Statement> body = statement();
 
-    return std::make_shared<WhileStatement>(condition, body);
+    return node<WhileStatement>(line, condition, body);
 }
 
 shared_ptr<Statement> Parser::expressionStatement() {
+    size_t line = peek().Line;
     EXPR value = expression();
     verify(LI_SEMICOLON, "Expected ';' after an expression.");
 
-    return std::make_shared<ExpressionStatement>(value);
+    return node<ExpressionStatement>(line, value);
 }
 
 shared_ptr<FuncStatement> Parser::function(std::string type) {
@@ -177,11 +211,43 @@ shared_ptr<FuncStatement> Parser::function(std::string type) {
     }
 
     verify(LI_RPAREN, std::string("Expected ( after ").append(type).append(" parameters."));
-    verify(LI_LBRACE, std::string("Expected { before ").append(type).append(" body."));
+    Token brace = verify(LI_LBRACE, std::string("Expected { before ").append(type).append(" body."));
+
+    if(Deferred != nullptr)
+        return deferFunction(name, parameters, brace);
 
     std::vector<shared_ptr<Statement>> body = block();
 
-    return std::make_shared<FuncStatement>(name, parameters, body);
+    return node<FuncStatement>(name.Line, name, parameters, body);
+}
+
+shared_ptr<FuncStatement> Parser::deferFunction(const Token& name, const std::vector<Token>& parameters, const Token& brace) {
+    // Skip to the matching brace. Nothing in between is looked at until the function is called.
+    size_t depth = 1;
+    while(!endOfStream()) {
+        int type = peek().Type;
+        if(type == LI_LBRACE) depth++;
+        if(type == LI_RBRACE && --depth == 0) break;
+        advance();
+    }
+
+    Token end = verify(LI_RBRACE, "Unclosed block statement");
+
+    size_t begin = brace.Offset + 1;
+    std::string_view text = Deferred->Text;
+    CountedLines += std::count(text.begin() + (ptrdiff_t) CountedOffset, text.begin() + (ptrdiff_t) begin, '\n');
+    CountedOffset = begin;
+
+    // Several parsers may record bodies at once; see ParallelParser.
+    std::unique_lock<std::mutex> guard(Deferred->Lock);
+    DeferredBody& body = Deferred->Bodies.emplace_back();
+    guard.unlock();
+
+    body.Source = Deferred;
+    body.Text = std::string(text.substr(begin, end.Offset - begin));
+    body.Line = CountedLines;
+
+    return node<FuncStatement>(name.Line, name, parameters, std::vector<shared_ptr<Statement>>(), &body);
 }
 
 shared_ptr<ClassStatement> Parser::classDeclaration() {
@@ -203,7 +269,7 @@ shared_ptr<ClassStatement> Parser::classDeclaration() {
 
     verify(LI_RBRACE, "Expected a block end for a class.");
 
-    return std::make_shared<ClassStatement>(name, functions, std::make_shared<VariableExpression<Object>>(superName));
+    return node<ClassStatement>(name.Line, name, functions, node<VariableExpression<Object>>(name.Line, superName));
 }
 
 EXPR Parser::expression() {
@@ -219,9 +285,11 @@ EXPR Parser::assignment() {
 
         if(auto var = dynamic_cast<VariableExpression<Object>*>(expr.get()); var != nullptr) {
             Token name = var->Name;
-            return std::make_shared<AssignmentExpression<Object>>(name, value);
+            return node<AssignmentExpression<Object>>(equals.Line, name, value);
         } else if(auto get = dynamic_cast<GetExpression<Object>*>(expr.get()); get != nullptr) {
-            return std::make_shared<SetExpression<Object>>(get->Obj, get->Name, value);
+            return node<SetExpression<Object>>(equals.Line, get->Obj, get->Name, value);
+        } else if(auto index = dynamic_cast<IndexExpression<Object>*>(expr.get()); index != nullptr) {
+            return node<IndexSetExpression<Object>>(equals.Line, index->Obj, index->Bracket, index->Index, value);
         }
 
         Error(equals, std::string("Cannot assign an r-value"));
@@ -236,7 +304,7 @@ EXPR Parser::orExpr() {
     while(matchAny(KW_OR)) {
         Token operatorToken = previous();
         EXPR right = andExpr();
-        expr = std::make_shared<LogicalExpression<Object>>(expr, operatorToken, right);
+        expr = node<LogicalExpression<Object>>(operatorToken.Line, expr, operatorToken, right);
     }
 
     return expr;
@@ -248,7 +316,7 @@ EXPR Parser::andExpr() {
     while(matchAny(KW_AND)) {
         Token operatorToken = previous();
         EXPR right = equality();
-        expr = std::make_shared<LogicalExpression<Object>>(expr, operatorToken, right);
+        expr = node<LogicalExpression<Object>>(operatorToken.Line, expr, operatorToken, right);
     }
 
     return expr;
@@ -260,7 +328,7 @@ EXPR Parser::equality() {
     while(matchAny(CMP_INEQ, CMP_EQUAL)) {
         struct Token operatorToken = previous();
         EXPR right = comparison();
-        expr = std::make_shared<BinaryExpression<Object>>(expr, operatorToken, right);
+        expr = node<BinaryExpression<Object>>(operatorToken.Line, expr, operatorToken, right);
     }
 
     return expr;
@@ -272,7 +340,7 @@ EXPR Parser::comparison() {
     while(matchAny(CMP_GREATER, CMP_GREAT_EQUAL, CMP_LESS, CMP_LESS_EQUAL)) {
         struct Token operatorToken = previous();
         EXPR right = term();
-        expr = std::make_shared<BinaryExpression<Object>>(expr, operatorToken, right);
+        expr = node<BinaryExpression<Object>>(operatorToken.Line, expr, operatorToken, right);
     }
 
     return expr;
@@ -284,7 +352,7 @@ EXPR Parser::term() {
     while(matchAny(AR_MINUS, AR_PLUS)) {
         struct Token operatorToken = previous();
         EXPR right = factor();
-        expr = std::make_shared<BinaryExpression<Object>>(expr, operatorToken, right);
+        expr = node<BinaryExpression<Object>>(operatorToken.Line, expr, operatorToken, right);
     }
 
     return expr;
@@ -296,7 +364,7 @@ EXPR Parser::factor() {
     while(matchAny(AR_ASTERISK, AR_RSLASH)) {
         struct Token operatorToken = previous();
         EXPR right = unary();
-        expr = std::make_shared<BinaryExpression<Object>>(expr, operatorToken, right);
+        expr = node<BinaryExpression<Object>>(operatorToken.Line, expr, operatorToken, right);
     }
 
     return expr;
@@ -306,7 +374,7 @@ EXPR Parser::unary() {
     if(matchAny(BOOL_EXCLAIM, AR_MINUS)) {
         struct Token operatorToken = previous();
         EXPR right = unary();
-        return std::make_shared<UnaryExpression<Object>>(operatorToken, right);
+        return node<UnaryExpression<Object>>(operatorToken.Line, operatorToken, right);
     }
 
     return call();
@@ -320,7 +388,12 @@ EXPR Parser::call() {
             expr = finishCall(expr);
         } else if (matchAny(LI_PERIOD)) {
             Token name = verify(LI_IDENTIFIER, "Expected a property to retrieve.");
-            expr = std::make_shared<GetExpression<Object>>(expr, name);
+            expr = node<GetExpression<Object>>(name.Line, expr, name);
+        } else if (matchAny(LI_LBRAS)) {
+            Token bracket = previous();
+            EXPR index = expression();
+            verify(LI_RBRAS, "Expected ']' after an index.");
+            expr = node<IndexExpression<Object>>(bracket.Line, expr, bracket, index);
         } else {
             break;
         }
@@ -330,6 +403,7 @@ EXPR Parser::call() {
 }
 
 EXPR Parser::finishCall(EXPR callee) {
+    size_t line = previous().Line;
     std::vector<EXPR> arguments;
 
     if(!check(LI_RPAREN)) {
@@ -342,28 +416,43 @@ EXPR Parser::finishCall(EXPR callee) {
 
     Token parenthesis = verify(LI_RPAREN, "Expected ')' after argument list.");
 
-    return std::make_shared<CallExpression<Object>>(callee, parenthesis, arguments);
+    return node<CallExpression<Object>>(line, callee, parenthesis, arguments);
 }
 
 EXPR Parser::primary() {
-    if(matchAny(KW_FALSE)) return std::make_shared<LiteralExpression<Object>>(Object::NewBool(false));
-    if(matchAny(KW_TRUE)) return std::make_shared<LiteralExpression<Object>>(Object::NewBool(true));
-    if(matchAny(KW_NULL)) return std::make_shared<LiteralExpression<Object>>(Object::Null);
-    if(matchAny(KW_THIS)) return std::make_shared<ThisExpression<Object>>(tokens[currentToken - 1]);
+    if(matchAny(KW_FALSE)) return node<LiteralExpression<Object>>(previous().Line, Object::NewBool(false));
+    if(matchAny(KW_TRUE)) return node<LiteralExpression<Object>>(previous().Line, Object::NewBool(true));
+    if(matchAny(KW_NULL)) return node<LiteralExpression<Object>>(previous().Line, Object::Null);
+    if(matchAny(KW_THIS)) return node<ThisExpression<Object>>(previous().Line, previous());
 
     if(matchAny(LI_NUMBER))
-        return std::make_shared<LiteralExpression<Object>>(previous().Value);
+        return node<LiteralExpression<Object>>(previous().Line, previous().Value);
 
     if(matchAny(LI_STRING))
-        return std::make_shared<LiteralExpression<Object>>(Object::NewStr(previous().Lexeme));
+        return node<LiteralExpression<Object>>(previous().Line, Object::NewStr(previous().Lexeme));
 
     if(matchAny(LI_IDENTIFIER))
-        return std::make_shared<VariableExpression<Object>>(previous());
+        return node<VariableExpression<Object>>(previous().Line, previous());
 
     if(matchAny(LI_LPAREN)) {
+        size_t line = previous().Line;
         EXPR expr = expression();
         verify(LI_RPAREN, "Expected ')' after expression");
-        return std::make_shared<GroupingExpression<Object>>(expr);
+        return node<GroupingExpression<Object>>(line, expr);
+    }
+
+    if(matchAny(LI_LBRAS)) {
+        Token bracket = previous();
+        std::vector<EXPR> elements;
+
+        if(!check(LI_RBRAS)) {
+            do {
+                elements.emplace_back(expression());
+            } while (matchAny(LI_COMMA));
+        }
+
+        verify(LI_RBRAS, "Expected ']' after array elements.");
+        return node<ArrayExpression<Object>>(bracket.Line, bracket, elements);
     }
 
     throw error(peek(), "Expected an expression");
@@ -433,10 +522,13 @@ struct Token Parser::advance() {
     return previous();
 }
 
-struct Token Parser::peek() {
-    return tokens.at(currentToken);
+const struct Token& Parser::peek() {
+    while(pulledTokens <= currentToken)
+        source.Next(tokens[pulledTokens++ % Lookahead]);
+
+    return tokens[currentToken % Lookahead];
 }
 
 struct Token Parser::previous() {
-    return tokens.at(currentToken - 1);
+    return tokens[(currentToken - 1) % Lookahead];
 }
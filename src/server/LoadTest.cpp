@@ -0,0 +1,183 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <server/Server.hpp>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+
+/*
+ * One keep-alive connection of the load test.
+ */
+class LoadConnection {
+public:
+    explicit LoadConnection(const LoadTestOptions& pOptions) : Options(pOptions) {}
+
+    ~LoadConnection() {
+        if(Socket >= 0) close(Socket);
+    }
+
+    bool Connect() {
+        if(Socket >= 0) close(Socket);
+        Pending.clear();
+
+        Socket = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(Options.Port);
+        inet_pton(AF_INET, Options.Host.c_str(), &address.sin_addr);
+
+        int yes = 1;
+        setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        return connect(Socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    /**
+     * Send one request, and read the whole response.
+     * @return the size of the response body, or -1 if the request failed.
+     */
+    long Fetch() {
+        TimedOut = false;
+        Deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(Options.Timeout));
+
+        std::string request = "GET " + Options.Path + " HTTP/1.1\r\nHost: " + Options.Host + "\r\n\r\n";
+        if(send(Socket, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t) request.size())
+            return -1;
+
+        size_t headEnd;
+        while((headEnd = Pending.find("\r\n\r\n")) == std::string::npos)
+            if(!Fill()) return -1;
+
+        std::string head = Pending.substr(0, headEnd);
+        Pending.erase(0, headEnd + 4);
+
+        if(head.compare(0, 12, "HTTP/1.1 200") != 0)
+            return -1;
+
+        KeepAlive = head.find("Connection: close") == std::string::npos;
+
+        size_t lengthAt = head.find("Content-Length: ");
+        if(lengthAt != std::string::npos)
+            return Take(std::stoul(head.substr(lengthAt + 16))) ? (long) std::stoul(head.substr(lengthAt + 16)) : -1;
+
+        // Chunked body
+        long body = 0;
+        while(true) {
+            size_t lineEnd;
+            while((lineEnd = Pending.find("\r\n")) == std::string::npos)
+                if(!Fill()) return -1;
+
+            size_t chunk = std::stoul(Pending.substr(0, lineEnd), nullptr, 16);
+            Pending.erase(0, lineEnd + 2);
+            if(!Take(chunk + 2)) return -1;
+            body += (long) chunk;
+
+            if(chunk == 0) return body;
+        }
+    }
+
+    bool KeepAlive = true;
+    // Set when the last Fetch failed for want of a response in time.
+    bool TimedOut = false;
+
+private:
+    const LoadTestOptions& Options;
+    int Socket = -1;
+    std::string Pending;
+    std::chrono::steady_clock::time_point Deadline;
+
+    bool Fill() {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(Deadline - std::chrono::steady_clock::now()).count();
+        struct pollfd ready { Socket, POLLIN, 0 };
+        if(left <= 0 || poll(&ready, 1, (int) left) == 0) {
+            TimedOut = true;
+            return false;
+        }
+
+        char buffer[16 * 1024];
+        ssize_t count = recv(Socket, buffer, sizeof(buffer), 0);
+        if(count <= 0) return false;
+        Pending.append(buffer, count);
+        return true;
+    }
+
+    bool Take(size_t length) {
+        while(Pending.size() < length)
+            if(!Fill()) return false;
+        Pending.erase(0, length);
+        return true;
+    }
+};
+
+int RunLoadTest(const LoadTestOptions& options) {
+    LatencyHistogram latency;
+    std::atomic<uint64_t> bytes { 0 };
+    std::atomic<uint64_t> errors { 0 };
+    std::atomic<uint64_t> timeouts { 0 };
+    std::atomic<uint64_t> stalled { 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.Seconds));
+
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < options.Connections; i++) {
+        threads.emplace_back([&]() {
+            LoadConnection connection(options);
+            bool connected = connection.Connect();
+            uint64_t served = 0;
+
+            while(std::chrono::steady_clock::now() < deadline) {
+                if(!connected) {
+                    errors++;
+                    connected = connection.Connect();
+                    continue;
+                }
+
+                auto sent = std::chrono::steady_clock::now();
+                long body = connection.Fetch();
+                auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent).count();
+
+                if(body < 0) {
+                    (connection.TimedOut ? timeouts : errors)++;
+                    connected = connection.Connect();
+                    continue;
+                }
+
+                latency.Record((uint64_t) micros);
+                bytes += (uint64_t) body;
+                served++;
+
+                if(!connection.KeepAlive)
+                    connected = connection.Connect();
+            }
+
+            if(served == 0)
+                stalled++;
+        });
+    }
+
+    for(auto& thread : threads)
+        thread.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t requests = latency.Count();
+
+    std::cout << requests << " requests over " << options.Connections << " connections in " << seconds << "s, "
+              << errors.load() << " errors, " << timeouts.load() << " timed out after " << options.Timeout << "s, "
+              << stalled.load() << " connections stalled with no response" << std::endl;
+    std::cout << "Throughput: " << (double) requests / seconds << " req/s, "
+              << (double) bytes.load() / seconds / (1024 * 1024) << " MiB/s" << std::endl;
+    std::cout << "Latency of the completed requests: " << latency.Summary() << std::endl;
+
+    return requests > 0 ? 0 : 1;
+}
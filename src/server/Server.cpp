@@ -0,0 +1,825 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <server/Server.hpp>
+#include <Engine.hpp>
+#include <Source.hpp>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *     H I S T O G R A M     * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+size_t LatencyHistogram::IndexOf(uint64_t value) {
+    if(value < SubBuckets)
+        return value;
+
+    int top = 63 - __builtin_clzll(value);
+    int shift = top - 4;
+    return (shift + 1) * SubBuckets + ((value >> shift) & (SubBuckets - 1));
+}
+
+uint64_t LatencyHistogram::ValueOf(size_t index) {
+    if(index < SubBuckets)
+        return index;
+
+    size_t shift = index / SubBuckets - 1;
+    return (SubBuckets + index % SubBuckets) << shift;
+}
+
+void LatencyHistogram::Record(uint64_t micros) {
+    Counts[IndexOf(micros)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = Maximum.load(std::memory_order_relaxed);
+    while(micros > max && !Maximum.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for(size_t i = 0; i < Buckets; i++)
+        Counts[i].fetch_add(other.Counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    uint64_t max = other.Max();
+    if(max > Max()) Maximum.store(max, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Count() const {
+    uint64_t total = 0;
+    for(const auto& count : Counts)
+        total += count.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t LatencyHistogram::Percentile(double percent) const {
+    uint64_t total = Count();
+    if(total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t) ((percent / 100.0) * (double) total);
+    if(rank >= total) rank = total - 1;
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < Buckets; i++) {
+        seen += Counts[i].load(std::memory_order_relaxed);
+        if(seen > rank)
+            return std::min(ValueOf(i), Max());
+    }
+
+    return Max();
+}
+
+std::string LatencyHistogram::Summary() const {
+    std::ostringstream out;
+    out << "p50 " << Percentile(50) << "us, p90 " << Percentile(90) << "us, p99 " << Percentile(99)
+        << "us, p99.9 " << Percentile(99.9) << "us, max " << Max() << "us";
+    return out.str();
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *       S T R E A M I N G   * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * Sends rendered output to the client with chunked transfer encoding.
+ * The response head is held back, and sent in the same writev as the first chunk.
+ */
+class SocketSink : public OutputSink {
+public:
+    explicit SocketSink(size_t pCapacity = 16 * 1024) : Capacity(pCapacity) {
+        Buffer.reserve(Capacity);
+    }
+
+    void Begin(int client, std::string head) {
+        Client = client;
+        Head = std::move(head);
+        Failed = false;
+        Sent = 0;
+    }
+
+    void Write(const char* data, size_t length) override {
+        if(Buffer.size() + length > Capacity) {
+            Flush();
+            if(length >= Capacity / 2) {
+                SendChunk(data, length);
+                return;
+            }
+        }
+        Buffer.append(data, length);
+    }
+
+    void Flush() override {
+        if(Buffer.empty()) return;
+        SendChunk(Buffer.data(), Buffer.size());
+        Buffer.clear();
+    }
+
+    // Flush the last of the output, and terminate the chunked body.
+    bool End() {
+        Flush();
+        SendChunk(nullptr, 0);
+        return !Failed;
+    }
+
+    /**
+     * Give up on the response, without terminating the body, so that a client can tell it from one
+     *  that was complete.
+     * @return whether nothing of it was sent yet, so another response may be sent in its place.
+     */
+    bool Abort() {
+        bool unsent = !Head.empty();
+        Buffer.clear();
+        Head.clear();
+        return unsent;
+    }
+
+    size_t Sent = 0;
+
+private:
+    size_t Capacity;
+    std::string Buffer;
+    std::string Head;
+    int Client = -1;
+    bool Failed = false;
+
+    void SendChunk(const char* data, size_t length) {
+        if(Failed) return;
+
+        char size[24];
+        int sizeLength = snprintf(size, sizeof(size), "%zx\r\n", length);
+
+        struct iovec vectors[4] = {
+            { const_cast<char*>(Head.data()), Head.size() },
+            { size, (size_t) sizeLength },
+            { const_cast<char*>(data), length },
+            { const_cast<char*>("\r\n"), 2 }
+        };
+
+        Failed = !SendAll(vectors, 4);
+        Sent += Head.size() + sizeLength + length + 2;
+        Head.clear();
+    }
+
+    bool SendAll(struct iovec* next, int count) {
+        while(count > 0) {
+            if(next->iov_len == 0) { next++; count--; continue; }
+
+            struct msghdr message {};
+            message.msg_iov = next;
+            message.msg_iovlen = count;
+
+            ssize_t written = sendmsg(Client, &message, MSG_NOSIGNAL);
+            if(written < 0) {
+                if(errno == EINTR) continue;
+                return false;
+            }
+
+            while(count > 0 && (size_t) written >= next->iov_len) {
+                written -= next->iov_len;
+                next++; count--;
+            }
+            if(count > 0) {
+                next->iov_base = static_cast<char*>(next->iov_base) + written;
+                next->iov_len -= written;
+            }
+        }
+        return true;
+    }
+};
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *    C O N N E C T I O N S  * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * The open connections of one process, between their requests.
+ *
+ * No worker keeps a connection for longer than a request: a keep-alive connection is parked here until
+ *  its next request arrives, and then whichever worker is free serves it. A client that holds its
+ *  connection open with nothing to send so never keeps anyone else waiting. A connection left idle for
+ *  IdleSeconds is closed.
+ *
+ * The listener and every parked connection share one epoll set, which every worker of the process waits
+ *  on. A parked connection is armed for a single event, so only one worker ever claims it. One parked
+ *  with a whole request already read has nothing to wait for, and is queued as ready instead.
+ */
+class ConnectionPool {
+public:
+    static constexpr int IdleSeconds = 5;
+
+    explicit ConnectionPool(int pListener);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * Wait up to timeout milliseconds for a connection with a request to serve.
+     * @param pending: set to what was already read from it.
+     * @return the connection, or -1 if there is none yet.
+     */
+    int Next(int timeout, std::string& pending);
+
+    // Hand back a connection between requests, with whatever was read past the last one.
+    void Park(int client, std::string pending);
+
+private:
+    struct Parked {
+        std::string Pending;
+        std::chrono::steady_clock::time_point Since;
+        uint32_t Generation;
+    };
+
+    // What an event is for, when it is not a parked connection.
+    static constexpr uint64_t ListenerEvent = UINT64_MAX;
+    static constexpr uint64_t WakeupEvent = UINT64_MAX - 1;
+
+    int Listener;
+    int Events;
+    int Wakeup; // An eventfd that counts the Ready connections, so that a waiting worker wakes for them.
+
+    std::mutex Lock;
+    std::unordered_map<int, Parked> Idle;
+    std::deque<std::pair<int, std::string>> Ready;
+    // Tells an event for a connection from one left over for an earlier connection with the same fd.
+    uint32_t Generation = 0;
+    std::chrono::steady_clock::time_point Swept;
+
+    void Sweep();
+};
+
+ConnectionPool::ConnectionPool(int pListener) : Listener(pListener) {
+    Events = epoll_create1(EPOLL_CLOEXEC);
+    Wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+    if(Events < 0 || Wakeup < 0)
+        perror("epoll");
+
+    struct epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = ListenerEvent;
+    epoll_ctl(Events, EPOLL_CTL_ADD, Listener, &event);
+    event.data.u64 = WakeupEvent;
+    epoll_ctl(Events, EPOLL_CTL_ADD, Wakeup, &event);
+}
+
+ConnectionPool::~ConnectionPool() {
+    for(const auto& parked : Idle)
+        close(parked.first);
+    for(const auto& ready : Ready)
+        close(ready.first);
+    close(Wakeup);
+    close(Events);
+}
+
+int ConnectionPool::Next(int timeout, std::string& pending) {
+    Sweep();
+
+    struct epoll_event event {};
+    if(epoll_wait(Events, &event, 1, timeout) <= 0)
+        return -1;
+
+    if(event.data.u64 == ListenerEvent) {
+        // Every worker may have woken for it; the rest find nothing to accept.
+        int client = accept4(Listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if(client < 0)
+            return -1;
+
+        int yes = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        // Bounds the wait for the rest of a request once its first bytes have arrived.
+        struct timeval wait { IdleSeconds, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+
+        Park(client, std::string());
+        return -1;
+    }
+
+    if(event.data.u64 == WakeupEvent) {
+        uint64_t one;
+        if(read(Wakeup, &one, sizeof(one)) != sizeof(one))
+            return -1;
+
+        std::lock_guard<std::mutex> guard(Lock);
+        int client = Ready.front().first;
+        pending = std::move(Ready.front().second);
+        Ready.pop_front();
+        return client;
+    }
+
+    int client = (int) (uint32_t) event.data.u64;
+    std::lock_guard<std::mutex> guard(Lock);
+    auto parked = Idle.find(client);
+    if(parked == Idle.end() || parked->second.Generation != (uint32_t) (event.data.u64 >> 32))
+        return -1;
+
+    epoll_ctl(Events, EPOLL_CTL_DEL, client, nullptr);
+    pending = std::move(parked->second.Pending);
+    Idle.erase(parked);
+    return client;
+}
+
+void ConnectionPool::Park(int client, std::string pending) {
+    if(pending.find("\r\n\r\n") != std::string::npos) {
+        {
+            std::lock_guard<std::mutex> guard(Lock);
+            Ready.emplace_back(client, std::move(pending));
+        }
+        uint64_t one = 1;
+        if(write(Wakeup, &one, sizeof(one)) != sizeof(one))
+            perror("eventfd");
+        return;
+    }
+
+    // Registered under the lock, so that the connection is in Idle before any worker can claim it.
+    std::lock_guard<std::mutex> guard(Lock);
+    uint32_t generation = ++Generation;
+    Idle[client] = { std::move(pending), std::chrono::steady_clock::now(), generation };
+
+    struct epoll_event event {};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.u64 = ((uint64_t) generation << 32) | (uint32_t) client;
+    if(epoll_ctl(Events, EPOLL_CTL_ADD, client, &event) < 0) {
+        Idle.erase(client);
+        close(client);
+    }
+}
+
+// Close every connection that has been idle for too long, at most once a second.
+void ConnectionPool::Sweep() {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard(Lock);
+    if(now - Swept < std::chrono::seconds(1))
+        return;
+    Swept = now;
+
+    for(auto parked = Idle.begin(); parked != Idle.end();) {
+        if(now - parked->second.Since < std::chrono::seconds(IdleSeconds)) {
+            ++parked;
+            continue;
+        }
+        epoll_ctl(Events, EPOLL_CTL_DEL, parked->first, nullptr);
+        close(parked->first);
+        parked = Idle.erase(parked);
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * *
+ * * * *         S E R V E R       * * * *
+ * * * * * * * * * * * * * * * * * * * * */
+
+struct RenderServer::Worker {
+    std::thread Thread;
+    std::unique_ptr<Engine> Runtime;
+    std::shared_ptr<SocketSink> Sink;
+    WorkerStats Own;
+    WorkerStats* Stats = &Own; // Elsewhere when the worker is a forked process.
+    std::string Pending; // Bytes read past the end of the last request.
+    bool Ready = false;
+
+    void Start() {
+        Sink = std::make_shared<SocketSink>();
+        Runtime = std::make_unique<Engine>(Sink);
+        Runtime->GetInterpreter()->PrintPrefix = "";
+    }
+};
+
+static std::atomic<bool>* SignalStop = nullptr;
+static std::atomic<bool>* SignalReload = nullptr;
+
+static void OnStopSignal(int signal) {
+    UNUSED(signal);
+    if(SignalStop != nullptr) SignalStop->store(true);
+}
+
+static void OnReloadSignal(int signal) {
+    UNUSED(signal);
+    if(SignalReload != nullptr) SignalReload->store(true);
+}
+
+static void InstallSignals(std::atomic<bool>* stop, std::atomic<bool>* reload) {
+    SignalStop = stop;
+    SignalReload = reload;
+    std::signal(SIGINT, OnStopSignal);
+    std::signal(SIGTERM, OnStopSignal);
+    std::signal(SIGHUP, OnReloadSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+}
+
+/*
+ * Every .html file under the root is a route. An index.html also answers for its directory.
+ */
+bool RenderServer::FindRoutes() {
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    fs::path root = fs::path(Options.Root);
+    for(fs::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error)) {
+        if(!it->is_regular_file() || it->path().extension() != ".html")
+            continue;
+
+        std::string file = it->path().string();
+        std::string url = "/" + fs::relative(it->path(), root).generic_string();
+        if(Programs.Load(file, true) == nullptr) {
+            std::cout << "Unable to compile " << file << std::endl;
+            return false;
+        }
+
+        Routes[url] = file;
+        if(it->path().filename() == "index.html")
+            Routes[url.substr(0, url.size() - std::string("index.html").size())] = file;
+    }
+
+    if(error) {
+        std::cout << "Unable to read " << Options.Root << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    if(Routes.empty()) {
+        std::cout << "No templates found under " << Options.Root << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool RenderServer::Listen() {
+    Listener = socket(AF_INET, SOCK_STREAM, 0);
+    if(Listener < 0) {
+        perror("socket");
+        return false;
+    }
+
+    int yes = 1;
+    setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(Options.Port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(Listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 || listen(Listener, 1024) < 0) {
+        perror("bind");
+        close(Listener);
+        return false;
+    }
+
+    // Every worker polls the same socket; whichever loses the race to accept must not block.
+    fcntl(Listener, F_SETFL, fcntl(Listener, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+int RenderServer::Serve() {
+    if(Options.Threads == 0) Options.Threads = 1;
+    if(!FindRoutes() || !Listen())
+        return 1;
+
+    if(Options.Prefork > 0) {
+        // The prelude runs here, in the Engine that every child inherits.
+        Worker prototype;
+        prototype.Start();
+        if(!Options.Prelude.empty() && !prototype.Runtime->RunFile(Options.Prelude)) {
+            close(Listener);
+            return 1;
+        }
+
+        // Templates are never pre-parsed, but the prelude is; its bodies are compiled here, once.
+        prototype.Runtime->CompleteAll();
+        return ServeForks(prototype);
+    }
+
+    // The routes are already compiled. The prelude is run once, and every worker starts from a snapshot
+    //  of the globals it left behind; only if that cannot be taken does each worker run it for itself.
+    std::string prelude;
+    shared_ptr<const Snapshot> snapshot;
+    if(!Options.Prelude.empty()) {
+        Engine first(std::make_shared<BufferSink>());
+        if(!first.RunFile(Options.Prelude)) {
+            close(Listener);
+            return 1;
+        }
+
+        snapshot = first.TakeSnapshot();
+        SourceText text;
+        if(snapshot == nullptr && text.Load(Options.Prelude))
+            prelude = std::string(text.View());
+    }
+
+    return ServeThreads(snapshot, prelude);
+}
+
+int RenderServer::ServeThreads(const shared_ptr<const Snapshot>& snapshot, const std::string& prelude) {
+    std::vector<std::unique_ptr<Worker>> workers;
+    for(size_t i = 0; i < Options.Threads; i++) {
+        workers.emplace_back(std::make_unique<Worker>());
+        Worker& worker = *workers.back();
+        worker.Thread = std::thread([&worker, &prelude, &snapshot]() {
+            worker.Start();
+            if(snapshot != nullptr)
+                worker.Ready = worker.Runtime->Restore(snapshot);
+            else
+                worker.Ready = prelude.empty() || worker.Runtime->Run(prelude);
+        });
+    }
+
+    bool ready = true;
+    for(auto& worker : workers) {
+        worker->Thread.join();
+        ready = ready && worker->Ready;
+    }
+
+    if(!ready) {
+        std::cout << "Unable to run the prelude." << std::endl;
+        close(Listener);
+        return 1;
+    }
+
+    InstallSignals(&Stopping, &Reloading);
+
+    std::cout << "Serving " << Routes.size() << " routes on http://127.0.0.1:" << Options.Port
+              << " with " << workers.size() << " workers" << std::endl;
+
+    ConnectionPool connections(Listener);
+    auto start = std::chrono::steady_clock::now();
+    for(auto& worker : workers)
+        worker->Thread = std::thread([this, &worker, &connections]() { Work(*worker, connections); });
+
+    for(auto& worker : workers)
+        worker->Thread.join();
+
+    close(Listener);
+    InstallSignals(nullptr, nullptr);
+
+    std::vector<const WorkerStats*> stats;
+    for(const auto& worker : workers)
+        stats.emplace_back(worker->Stats);
+
+    Report(stats, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
+
+/*
+ * Fork a process for every worker, each serving from its own copy of the prototype.
+ * The statistics live in a shared mapping, so that the parent can report on all of them.
+ */
+int RenderServer::ServeForks(Worker& prototype) {
+    size_t count = Options.Prefork;
+    void* mapped = mmap(nullptr, sizeof(WorkerStats) * count, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(mapped == MAP_FAILED) {
+        perror("mmap");
+        close(Listener);
+        return 1;
+    }
+
+    auto* stats = static_cast<WorkerStats*>(mapped);
+    for(size_t i = 0; i < count; i++)
+        new (&stats[i]) WorkerStats();
+
+    InstallSignals(&Stopping, &Reloading);
+
+    std::cout << "Serving " << Routes.size() << " routes on http://127.0.0.1:" << Options.Port
+              << " with " << count << " processes" << std::endl;
+
+    // Nothing buffered may be inherited, or every child would write it again.
+    std::cout.flush();
+    fflush(stdout);
+
+    std::vector<pid_t> children(count, -1);
+    auto spawn = [&](size_t slot) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            prototype.Stats = &stats[slot];
+            ConnectionPool connections(Listener);
+            Work(prototype, connections);
+            _exit(0);
+        }
+
+        if(pid < 0) perror("fork");
+        children[slot] = pid;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < count; i++)
+        spawn(i);
+
+    while(!Stopping) {
+        if(Reloading.exchange(false))
+            for(pid_t child : children)
+                if(child > 0) kill(child, SIGHUP);
+
+        int status;
+        pid_t exited = waitpid(-1, &status, WNOHANG);
+        if(exited <= 0) {
+            usleep(100 * 1000);
+            continue;
+        }
+
+        for(size_t i = 0; i < count; i++) {
+            if(children[i] != exited) continue;
+            std::cout << "Worker " << exited << " exited; starting another." << std::endl;
+            spawn(i);
+        }
+    }
+
+    for(pid_t child : children)
+        if(child > 0) kill(child, SIGTERM);
+    for(pid_t child : children)
+        if(child > 0) waitpid(child, nullptr, 0);
+
+    close(Listener);
+    InstallSignals(nullptr, nullptr);
+
+    std::vector<const WorkerStats*> all;
+    for(size_t i = 0; i < count; i++)
+        all.emplace_back(&stats[i]);
+
+    Report(all, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    for(size_t i = 0; i < count; i++)
+        stats[i].~WorkerStats();
+    munmap(mapped, sizeof(WorkerStats) * count);
+    return 0;
+}
+
+void RenderServer::Work(Worker& worker, ConnectionPool& connections) {
+    while(!Stopping) {
+        int client = connections.Next(250, worker.Pending);
+        if(client < 0)
+            continue;
+
+        // One request, then back to the pool, so that every connection takes its turn.
+        if(ServeConnection(worker, client))
+            connections.Park(client, std::move(worker.Pending));
+        else
+            close(client);
+        worker.Pending.clear();
+    }
+}
+
+static bool SendText(int client, const std::string& text) {
+    size_t sent = 0;
+    while(sent < text.size()) {
+        ssize_t written = send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if(written <= 0) return false;
+        sent += written;
+    }
+    return true;
+}
+
+// The largest request body that is read, and skipped; anything larger is refused.
+static constexpr size_t MaxRequestBody = 1024 * 1024;
+
+/*
+ * The value of a Content-Length header: digits only, around any whitespace.
+ * @return false if it is anything else, or does not fit.
+ */
+static bool ParseLength(const std::string& value, size_t& length) {
+    size_t begin = value.find_first_not_of(" \t");
+    size_t end = value.find_last_not_of(" \t\r");
+    if(begin == std::string::npos || end < begin)
+        return false;
+
+    const char* last = value.data() + end + 1;
+    auto [stop, error] = std::from_chars(value.data() + begin, last, length);
+    return error == std::errc() && stop == last;
+}
+
+/*
+ * Read and answer one request.
+ * @return whether the connection should be kept open for another.
+ */
+bool RenderServer::ServeConnection(Worker& worker, int client) {
+    std::string& request = worker.Pending;
+    size_t headEnd;
+    char buffer[8192];
+
+    while((headEnd = request.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+        if(count <= 0 || request.size() > 64 * 1024)
+            return false;
+        request.append(buffer, count);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::string head = request.substr(0, headEnd);
+    request.erase(0, headEnd + 4);
+
+    std::istringstream lines(head);
+    std::string method, target, version;
+    lines >> method >> target >> version;
+
+    bool keepAlive = version == "HTTP/1.1";
+    for(std::string line; std::getline(lines, line);) {
+        for(char& c : line) c = (char) tolower(c);
+        if(line.rfind("connection:", 0) == 0)
+            keepAlive = line.find("close") == std::string::npos && (keepAlive || line.find("keep-alive") != std::string::npos);
+        // Request bodies are not used, but must be skipped to find the next request.
+        if(line.rfind("content-length:", 0) == 0) {
+            size_t length;
+            if(!ParseLength(line.substr(15), length)) {
+                SendText(client, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+                return false;
+            }
+            if(length > MaxRequestBody) {
+                SendText(client, "HTTP/1.1 413 Payload Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+                return false;
+            }
+            while(request.size() < length) {
+                ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+                if(count <= 0) return false;
+                request.append(buffer, count);
+            }
+            request.erase(0, length);
+        }
+    }
+
+    std::string connection = keepAlive ? "keep-alive" : "close";
+    std::string path = target.substr(0, target.find('?'));
+
+    if(method != "GET") {
+        SendText(client, "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: " + connection + "\r\n\r\n");
+        return keepAlive;
+    }
+
+    if(path == "/__stats") {
+        std::string body = std::to_string(worker.Stats->Requests.load()) + " requests on this worker; " + worker.Stats->Latency.Summary() + "\n";
+        SendText(client, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(body.size())
+                         + "\r\nConnection: " + connection + "\r\n\r\n" + body);
+        return keepAlive;
+    }
+
+    auto route = Routes.find(path);
+    if(route == Routes.end()) {
+        SendText(client, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: " + connection + "\r\n\r\n");
+        return keepAlive;
+    }
+
+    if(Reloading.exchange(false))
+        Programs.Clear();
+
+    // Only by path, never hashing the file again; edits are picked up on SIGHUP.
+    shared_ptr<const CompiledProgram> program = Programs.Find(route->second);
+    if(program == nullptr)
+        program = Programs.Load(route->second, true);
+
+    if(program == nullptr) {
+        SendText(client, "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: " + connection + "\r\n\r\n");
+        return keepAlive;
+    }
+
+    worker.Sink->Begin(client, "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nTransfer-Encoding: chunked\r\nConnection: "
+                                + connection + "\r\n\r\n");
+    bool delivered;
+    if(worker.Runtime->Render(program)) {
+        delivered = worker.Sink->End();
+    } else {
+        // Cut off a response already under way, so that it does not pass for a whole one.
+        if(worker.Sink->Abort())
+            SendText(client, "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        delivered = false;
+    }
+
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    worker.Stats->Latency.Record((uint64_t) micros);
+    worker.Stats->Requests.fetch_add(1, std::memory_order_relaxed);
+    worker.Stats->Bytes.fetch_add(worker.Sink->Sent, std::memory_order_relaxed);
+
+    return delivered && keepAlive;
+}
+
+void RenderServer::Report(const std::vector<const WorkerStats*>& stats, double seconds) {
+    LatencyHistogram total;
+    uint64_t requests = 0, bytes = 0;
+
+    for(const WorkerStats* worker : stats) {
+        total.Merge(worker->Latency);
+        requests += worker->Requests.load();
+        bytes += worker->Bytes.load();
+    }
+
+    std::cout << std::endl << "Served " << requests << " requests in " << seconds << "s ("
+              << (seconds > 0 ? (double) requests / seconds : 0) << " req/s, "
+              << (seconds > 0 ? (double) bytes / seconds / (1024 * 1024) : 0) << " MiB/s)" << std::endl;
+    std::cout << "Render latency: " << total.Summary() << std::endl;
+}
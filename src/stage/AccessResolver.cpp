@@ -40,14 +40,14 @@ void Resolver::declare(Token name) {
 void Resolver::define(Token name) {
     if(scopes.empty()) return;
 
-    scopes.back().emplace(name.Lexeme, true);
+    scopes.back()[name.Lexeme] = true;
 }
 
 
 void Resolver::resolveLocal(Expression<Object>* expr, const Token& name) {
     for (int i = scopes.size() - 1; i >= 0; i--) {
         if(scopes.at(i).find(name.Lexeme) != scopes.at(i).end()) {
-            interpreter->resolve(expr, scopes.size() - i - 1);
+            expr->Depth = scopes.size() - i - 1;
             return;
         }
     }
@@ -117,15 +117,33 @@ void Resolver::visitClass(ClassStatement &stmt) {
 }
 
 void Resolver::resolveFunction(FuncStatement &stmt, FunctionType type) {
+    // A body that has not been parsed is resolved along with its parsing, in the scopes it is declared in here.
+    if(DeferredBody* deferred = stmt.Deferred.load(std::memory_order_acquire); deferred != nullptr) {
+        deferred->Scopes = scopes;
+        deferred->Class = currentClass;
+        deferred->Type = type;
+        return;
+    }
+
+    resolveBody(stmt.Params, stmt.Body, type);
+}
+
+void Resolver::resolveDeferred(FuncStatement &stmt, const std::vector<std::shared_ptr<Statement>>& body, const DeferredBody& deferred) {
+    scopes = deferred.Scopes;
+    currentClass = deferred.Class;
+    resolveBody(stmt.Params, body, deferred.Type);
+}
+
+void Resolver::resolveBody(const std::vector<Token>& params, const std::vector<std::shared_ptr<Statement>>& body, FunctionType type) {
     FunctionType enclosingType = currentFunction;
     currentFunction = type;
 
     beginScope();
-    for(const Token& param : stmt.Params) {
+    for(const Token& param : params) {
         declare(param);
         define(param);
     }
-    resolveAll(stmt.Body);
+    resolveAll(body);
     endScope();
 
     currentFunction = enclosingType;
@@ -141,6 +159,14 @@ void Resolver::visitReturn(ReturnStatement &stmt) {
         resolve(stmt.Value);
 }
 
+void Resolver::visitText(TextStatement &stmt) {
+    UNUSED(stmt);
+}
+
+void Resolver::visitEmit(EmitStatement &stmt) {
+    resolve(stmt.Expr);
+}
+
 Object Resolver::visitBinaryExpression(BinaryExpression<Object> &expr) {
     resolve(expr.left);
     resolve(expr.right);
@@ -159,8 +185,10 @@ Object Resolver::visitLiteralExpression(LiteralExpression<Object> &expr) {
 }
 
 Object Resolver::visitVariableExpression(VariableExpression<Object> &expr) {
-    if(!scopes.empty() && !scopes.back().at(expr.Name.Lexeme)) {
-        throw Error(RuntimeError(expr.Name, "Attempted to read a variable in its own initializer"));
+    if(!scopes.empty()) {
+        auto it = scopes.back().find(expr.Name.Lexeme);
+        if(it != scopes.back().end() && !it->second)
+            throw Error(RuntimeError(expr.Name, "Attempted to read a variable in its own initializer"));
     }
 
     resolveLocal(&expr, expr.Name);
@@ -218,3 +246,23 @@ Object Resolver::visitThisExpression(ThisExpression<Object> &expr) {
     return Object::Null;
 }
 
+Object Resolver::visitArrayExpression(ArrayExpression<Object> &expr) {
+    for (const std::shared_ptr<Expression<Object>>& element : expr.Elements) {
+        resolve(element);
+    }
+
+    return Object::Null;
+}
+
+Object Resolver::visitIndexExpression(IndexExpression<Object> &expr) {
+    resolve(expr.Obj);
+    resolve(expr.Index);
+    return Object::Null;
+}
+
+Object Resolver::visitIndexSetExpression(IndexSetExpression<Object> &expr) {
+    resolve(expr.Value);
+    resolve(expr.Obj);
+    resolve(expr.Index);
+    return Object::Null;
+}
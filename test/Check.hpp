@@ -0,0 +1,21 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#pragma once
+#include <cstdio>
+
+/*
+ * What the tests check with. Each test is a program of its own, run by ctest; a failed check is
+ *  reported with where it was, and the program exits non-zero at the end.
+ */
+static int Failures = 0;
+
+#define CHECK(condition)                                                                     \
+    do {                                                                                     \
+        if(!(condition)) {                                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);            \
+            Failures++;                                                                      \
+        }                                                                                    \
+    } while(0)
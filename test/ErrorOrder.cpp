@@ -0,0 +1,71 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Engine.hpp>
+#include <sstream>
+#include "Check.hpp"
+
+/*
+ * Errors come after what the script printed before them, though the output is buffered and errors
+ *  are not, whichever stage reports them.
+ */
+static std::string Run(const std::string& source) {
+    std::ostringstream log;
+    std::streambuf* console = std::cout.rdbuf(log.rdbuf());
+    {
+        Engine engine(std::make_shared<CallbackSink>([](const char* data, size_t length) {
+            std::cout.write(data, (std::streamsize) length);
+        }));
+        engine.Run(source);
+    }
+    std::cout.rdbuf(console);
+    return log.str();
+}
+
+static bool Before(const std::string& log, const std::string& first, const std::string& second) {
+    size_t a = log.find(first);
+    size_t b = log.find(second);
+    return a != std::string::npos && b != std::string::npos && a < b;
+}
+
+int main() {
+    // From the ExecutionContext.
+    std::string log = Run("print \"before\";\nprint missing;\n");
+    CHECK(Before(log, "before", "Unable to find variable missing"));
+
+    // From the parser, compiling a body on its first call.
+    log = Run("print \"before\";\nfunc broken() { var = ; }\nbroken();\n");
+    CHECK(Before(log, "before", "Error"));
+
+    // From a call of a missing function through Invoke.
+    std::ostringstream invoked;
+    std::streambuf* console = std::cout.rdbuf(invoked.rdbuf());
+    {
+        Engine engine(std::make_shared<CallbackSink>([](const char* data, size_t length) {
+            std::cout.write(data, (std::streamsize) length);
+        }));
+        engine.Run("func greet() { print \"before\"; missing(); }\n");
+        engine.GetInterpreter()->Invoke("greet", {});
+    }
+    std::cout.rdbuf(console);
+    CHECK(Before(invoked.str(), "before", "Unable to find variable missing"));
+
+    // A template that fails at runtime reports the failure, and the report goes to Reports, not the page.
+    std::ostringstream page, reports;
+    Common::Reports = &reports;
+    {
+        Engine engine(std::make_shared<CallbackSink>([&page](const char* data, size_t length) {
+            page.write(data, (std::streamsize) length);
+        }));
+        CHECK(!engine.Render("<p><%= undefinedVar %></p>"));
+    }
+    Common::Reports = &std::cout;
+    CHECK(page.str() == "<p>");
+    CHECK(reports.str().find("Unable to find variable undefinedVar") != std::string::npos);
+
+    if(Failures != 0)
+        printf("%s\n", log.c_str());
+    return Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Engine.hpp>
+#include <interpreter/Heat.hpp>
+#include <cstdlib>
+#include <sstream>
+#include "Check.hpp"
+
+/*
+ * A line is counted against the script it is in: the same line of two scripts is kept apart, and in an
+ *  instrumented build, a function of the prelude called from a template counts against the prelude.
+ */
+int main() {
+    HeatMap heat;
+    for(const char* path : { "a.fus", "b.fus", "a.fus" }) {
+        HeatMap::FileHeat& file = heat.File(path);
+        HeatMap::Enter(file, 3);
+        HeatMap::Leave(file, 3);
+    }
+
+    std::ostringstream lines;
+    heat.WriteJSON(lines);
+    CHECK(lines.str().find("{\"path\": \"a.fus\", \"line\": 3, \"count\": 2,") != std::string::npos);
+    CHECK(lines.str().find("{\"path\": \"b.fus\", \"line\": 3, \"count\": 1,") != std::string::npos);
+
+#ifdef FUSCO_INSTRUMENT
+    setenv("FUSCO_NO_CACHE", "1", 1);
+
+    Engine engine(std::make_shared<BufferSink>());
+    CHECK(engine.Execute(CompileProgram("func twice(x) {\n    return x * 2;\n}\n", "prelude.fus", false)));
+    CHECK(engine.Render(CompileProgram("<p>\n<%= twice(2) %>\n</p>\n", "page.html", true)));
+
+    std::ostringstream report;
+    engine.GetInterpreter()->Heat.WriteJSON(report);
+    std::string json = report.str();
+
+    CHECK(json.find("{\"path\": \"prelude.fus\", \"line\": 1, \"count\": 4,") != std::string::npos);
+    CHECK(json.find("{\"path\": \"page.html\", \"line\": 1, \"count\": ") != std::string::npos);
+
+    if(Failures != 0)
+        printf("%s\n", json.c_str());
+#endif
+
+    return Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <ParallelParse.hpp>
+#include <interpreter/Interpreter.hpp>
+#include <algorithm>
+#include <sstream>
+#include "Check.hpp"
+
+/*
+ * The ParallelParser gives the same tree as a single Parser, at any number of threads, and reports
+ *  the same errors when a range in the middle of the script fails.
+ */
+
+// A script of at least the given size, with every kind of top-level declaration and statement, and
+//  braces in strings to throw off anything that matches them by their text.
+static std::string Script(size_t bytes) {
+    std::string source = "var total = 0;\n";
+    for(size_t i = 0; source.size() < bytes; i++) {
+        std::string n = std::to_string(i);
+        source += "func f" + n + "(a, b) {\n    var c = (a + b) * " + n + ";\n    if (c > 10) { return c - 1; }\n"
+                  "    return \"}\" + c;\n}\n"
+                  "class C" + n + " {\n    C" + n + "(v) { this.v = [v, [v * 2, \"{\"]]; }\n    get() { return this.v[0]; }\n}\n"
+                  "var v" + n + " = f" + n + "(" + n + ", (1 + 2));\n"
+                  "for (var i = 0; i < 2; i = i + 1) { total = total + i; }\n"
+                  "while (total > 100) total = total - 1;\n"
+                  "print total;\n";
+    }
+    return source;
+}
+
+struct Parsed {
+    std::string Tree;
+    std::string Reports;
+    bool Failed = false;
+    size_t Ranges = 0;
+    std::vector<std::pair<std::string, size_t>> Bodies;
+};
+
+// Parse with a single Parser if threads is 0, or with a ParallelParser on that many threads.
+static Parsed Parse(const std::string& source, size_t threads, bool defer) {
+    Parsed parsed;
+    std::ostringstream reports;
+    Common::Reports = &reports;
+
+    auto nodes = std::make_shared<Arena>();
+    DeferredSource deferred;
+    deferred.Nodes = nodes;
+    deferred.Text = source;
+
+    Lexer tokens(source);
+    std::vector<shared_ptr<Statement>> statements;
+    if(threads == 0) {
+        Parser parser(tokens, nodes, defer ? &deferred : nullptr);
+        statements = parser.parse();
+        parsed.Failed = parser.ErrorState;
+    } else {
+        ParallelParser parser(tokens, nodes, defer ? &deferred : nullptr, threads);
+        statements = parser.parse();
+        parsed.Failed = parser.ErrorState;
+        parsed.Ranges = parser.RangeCount();
+    }
+    Common::Reports = &std::cout;
+    parsed.Reports = reports.str();
+
+    // Workers record bodies as they go, so only what was recorded is compared, not in what order.
+    for(const DeferredBody& body : deferred.Bodies)
+        parsed.Bodies.emplace_back(body.Text, body.Line);
+    std::sort(parsed.Bodies.begin(), parsed.Bodies.end());
+
+    // A tree with errors in it has holes where they were, which cannot be printed.
+    if(parsed.Failed)
+        return parsed;
+
+    std::ostringstream tree;
+    std::streambuf* console = std::cout.rdbuf(tree.rdbuf());
+    std::make_shared<TreePrinter>()->print(statements);
+    std::cout.rdbuf(console);
+    parsed.Tree = tree.str();
+    return parsed;
+}
+
+int main() {
+    std::string source = Script(1024 * 1024);
+
+    for(bool defer : { false, true }) {
+        Parsed expected = Parse(source, 0, defer);
+        CHECK(!expected.Failed);
+        for(size_t threads : { 1, 2, 3, 4, 8 }) {
+            Parsed parsed = Parse(source, threads, defer);
+            CHECK(parsed.Ranges > 1);
+            CHECK(!parsed.Failed);
+            CHECK(parsed.Tree == expected.Tree);
+            CHECK(parsed.Bodies == expected.Bodies);
+        }
+    }
+
+    // A syntax error in a middle range: that range and every one after it are parsed again, reporting.
+    size_t middle = source.find("var v", source.size() / 2);
+    std::string broken = source.substr(0, middle) + "var = ;\n" + source.substr(middle);
+    size_t line = (size_t) std::count(broken.begin(), broken.begin() + (ptrdiff_t) middle, '\n');
+
+    Parsed expected = Parse(broken, 0, true);
+    CHECK(expected.Failed);
+    CHECK(expected.Reports.rfind("[line " + std::to_string(line) + "]", 0) == 0);
+    for(size_t threads : { 1, 2, 3, 4, 8 }) {
+        Parsed parsed = Parse(broken, threads, true);
+        CHECK(parsed.Failed);
+        CHECK(parsed.Reports == expected.Reports);
+    }
+
+    std::ostringstream reports;
+    Common::Reports = &reports;
+    CHECK(CompileProgram(broken, "", false) == nullptr);
+    Common::Reports = &std::cout;
+    CHECK(reports.str().find("[line " + std::to_string(line) + "]") != std::string::npos);
+
+    return Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Engine.hpp>
+#include "Check.hpp"
+
+/*
+ * An Engine keeps a program only while something the program declared is reachable, so an embedder
+ *  running snippets one after another does not keep every one of them.
+ */
+int main() {
+    auto engine = std::make_unique<Engine>(std::make_shared<BufferSink>());
+
+    std::vector<std::weak_ptr<const CompiledProgram>> snippets;
+    for(size_t i = 0; i < 100; i++) {
+        shared_ptr<const CompiledProgram> program = CompileProgram("print " + std::to_string(i) + ";", "", false);
+        CHECK(engine->Execute(program));
+        snippets.emplace_back(program);
+    }
+    for(const auto& snippet : snippets)
+        CHECK(snippet.expired());
+
+    // Running the same program again keeps it once.
+    std::weak_ptr<const CompiledProgram> library;
+    {
+        shared_ptr<const CompiledProgram> program = CompileProgram(
+            "class Counter { Counter() { this.n = 0; } next() { this.n = this.n + 1; return this.n; } }\n"
+            "func twice(x) { return x * 2; }\n", "", false);
+        CHECK(engine->Execute(program));
+        library = program;
+    }
+    CHECK(!library.expired());
+    CHECK(engine->Call("twice", { Object::NewNum(21) }).NumData == 42);
+
+    // A snapshot keeps what the prelude declared, and so does every Engine restored from it.
+    shared_ptr<const Snapshot> snapshot = engine->TakeSnapshot();
+    CHECK(snapshot != nullptr && snapshot->Programs.size() == 1);
+
+    auto restored = std::make_unique<Engine>(std::make_shared<BufferSink>());
+    CHECK(restored->Restore(snapshot));
+    snapshot = nullptr;
+    engine = nullptr;
+    CHECK(!library.expired());
+    CHECK(restored->Call("twice", { Object::NewNum(4) }).NumData == 8);
+
+    restored = nullptr;
+    CHECK(library.expired());
+
+    // A template recompiled, as after a reload, replaces the one before it in an Engine that renders both.
+    auto renderer = std::make_unique<Engine>(std::make_shared<BufferSink>());
+    std::weak_ptr<const CompiledProgram> before;
+    for(size_t i = 0; i < 10; i++) {
+        shared_ptr<const CompiledProgram> page = CompileProgram("<p><%= " + std::to_string(i) + " %></p>", "", true);
+        CHECK(renderer->Render(page));
+        if(i > 0)
+            CHECK(before.expired());
+        before = page;
+    }
+
+    return Failures == 0 ? 0 : 1;
+}
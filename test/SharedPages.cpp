@@ -0,0 +1,97 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <Engine.hpp>
+#include "Check.hpp"
+
+#ifdef __linux__
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * How many pages of the extents are shared with another process, and how many are this one's own,
+ *  going by /proc/self/pagemap: a page mapped by one process only is marked exclusive.
+ */
+static bool CountPages(const std::vector<std::pair<const char*, const char*>>& extents, uint64_t& shared, uint64_t& own) {
+    int pagemap = open("/proc/self/pagemap", O_RDONLY);
+    if(pagemap < 0)
+        return false;
+
+    const uint64_t Present = 1ull << 63, Exclusive = 1ull << 56;
+    long page = sysconf(_SC_PAGESIZE);
+    for(const auto& [begin, end] : extents) {
+        for(const char* at = begin; at < end; at += page) {
+            uint64_t entry = 0;
+            off_t offset = (off_t) (reinterpret_cast<uintptr_t>(at) / page * sizeof(entry));
+            if(pread(pagemap, &entry, sizeof(entry), offset) != sizeof(entry)) {
+                close(pagemap);
+                return false;
+            }
+            if(entry & Present)
+                (entry & Exclusive ? own : shared)++;
+        }
+    }
+
+    close(pagemap);
+    return true;
+}
+
+/*
+ * A forked child that runs a program, calling every function and making instances of every class,
+ *  leaves the pages of its tree shared with the parent: nothing it does writes to a node.
+ */
+int main() {
+    std::string source = "var total = 0;\n";
+    for(size_t i = 0; i < 300; i++) {
+        std::string n = std::to_string(i);
+        source += "func f" + n + "(a) { var b = a * " + n + "; if (b > 10) { return b - 1; } return b; }\n"
+                  "class C" + n + " { C" + n + "(v) { this.v = v; } get() { return this.v + f" + n + "(2); } }\n";
+    }
+    source += "func run() {\n";
+    for(size_t i = 0; i < 300; i++)
+        source += "    total = total + C" + std::to_string(i) + "(" + std::to_string(i) + ").get();\n";
+    source += "}\n";
+
+    Engine engine(std::make_shared<BufferSink>());
+    shared_ptr<const CompiledProgram> program = CompileProgram(source, "", false);
+    CHECK(program != nullptr && program->Deferred != nullptr);
+    CHECK(engine.Execute(program));
+    engine.CompleteAll();
+
+    std::vector<std::pair<const char*, const char*>> extents = program->Nodes->Extents();
+
+    int results[2];
+    CHECK(pipe(results) == 0);
+    pid_t child = fork();
+    if(child == 0) {
+        for(size_t i = 0; i < 20; i++)
+            engine.Call("run");
+
+        uint64_t counts[2] = { 0, 0 };
+        bool read = CountPages(extents, counts[0], counts[1]);
+        if(read && write(results[1], counts, sizeof(counts)) == sizeof(counts))
+            _exit(0);
+        _exit(1);
+    }
+
+    uint64_t counts[2] = { 0, 0 };
+    CHECK(read(results[0], counts, sizeof(counts)) == sizeof(counts));
+    int status = 0;
+    waitpid(child, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    printf("tree pages in the child: %llu shared, %llu private\n", (unsigned long long) counts[0], (unsigned long long) counts[1]);
+    CHECK(counts[0] > 0);
+    CHECK(counts[1] == 0);
+
+    return Failures == 0 ? 0 : 1;
+}
+#else
+int main() {
+    return 0;
+}
+#endif
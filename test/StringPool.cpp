@@ -0,0 +1,38 @@
+/***********
+ * GEMWIRE *
+ *  FUSCO  *
+ ***********/
+
+#include <interpreter/Dictionary.hpp>
+#include "Check.hpp"
+
+/*
+ * The pool keeps strings only while a key holds them, so one that sees many distinct keys does not
+ *  keep them all.
+ */
+int main() {
+    StringPool pool;
+
+    std::vector<shared_ptr<const InternedString>> keys;
+    for(size_t i = 0; i < 1000; i++)
+        keys.emplace_back(pool.Intern("key" + std::to_string(i)));
+    CHECK(pool.size() == 1000);
+    CHECK(pool.Intern("key7") == keys[7]);
+    CHECK(pool.Find("key999") == keys[999]);
+
+    size_t grown = pool.capacity();
+    shared_ptr<const InternedString> kept = keys[500];
+    keys.clear();
+    CHECK(pool.size() == 1);
+    CHECK(pool.Find("key1") == nullptr);
+    CHECK(pool.Find("key500") == kept);
+
+    // Keys made and dropped one at a time reuse the slots of those gone, and the table shrinks.
+    for(size_t i = 0; i < 100000; i++)
+        CHECK(pool.Intern("request" + std::to_string(i)) != nullptr);
+    CHECK(pool.size() == 1);
+    CHECK(pool.capacity() < grown);
+    CHECK(pool.Intern("key500") == kept);
+
+    return Failures == 0 ? 0 : 1;
+}